@@ -1,20 +1,52 @@
+#include <chrono>
+
 #include "log.h"
 
+namespace {
+
+/* 线程退出时标记自己的环，由flush线程取完剩余日志后回收 */
+struct ring_holder {
+    std::shared_ptr<log_ring> ring;
+
+    ~ring_holder() {
+        if(ring) {
+            ring->close();
+        }
+    }
+};
+
+thread_local ring_holder t_ring;
+
+}
+
 
 Log::Log() {
     cur_row = 0;
     cur_day_file_total = 0;
+    cur_today = 0;
+    max_row_per_file = 0;
     log_level = LOG_LEVEL::INFO;
+    inited = false;
 
     async_flag = false;
+    overflow_policy = OVERFLOW_DROP;
+    ring_capacity = MIN_RING_LEN;
+    next_owner = 0;
+    running = false;
+    sleepers = 0;
+    wakeup_flag = false;
+    dropped_count = 0;
 
-    line_buf = nullptr;
     _fp = nullptr;
 }
 
 Log::~Log() {
     if(async_flag || (!log_write_thread_vec.empty())) {
-        log_block_queue->stop();
+        running = false;
+        {
+            std::lock_guard<std::mutex> locker(wake_mutex);
+            wake_cond.notify_all();
+        }
         for(unsigned i = 0; i < log_write_thread_vec.size(); ++i) {
             if(log_write_thread_vec[i].joinable()) {
                 log_write_thread_vec[i].join();
@@ -27,10 +59,6 @@ Log::~Log() {
         fflush(_fp);
         fclose(_fp);
     }
-
-    if(line_buf != nullptr) {
-        delete []line_buf;
-    }
 }
 
 
@@ -40,156 +68,256 @@ Log *Log::get_instance() {
 }
 
 void Log::init(const char* path, int max_row, LOG_LEVEL level, 
-    bool async_, int queue_capacity, int thread_num) {
+    bool async_, int queue_capacity, int thread_num, LOG_OVERFLOW overflow) {
     
     max_row_per_file = max_row;
     cur_day_file_total = 0;
     log_level = level;
     dir_name = path;
 
-    line_buf = new char[LOG_BUFFER_LEN];
-    memset(line_buf, '\0', LOG_BUFFER_LEN);
-
     // get fd by log name
     std::time_t timer = std::time(nullptr);
-    std::tm *sysTime = std::localtime(&timer);
-    char file_name[LOG_NAME_LEN] = {0};
-    snprintf(file_name, LOG_NAME_LEN - 1, "%s/application_%04d_%02d_%02d.log_%02d", 
-            path, sysTime->tm_year + 1900, sysTime->tm_mon + 1, sysTime->tm_mday, cur_day_file_total);
-    cur_today = sysTime->tm_mday;
+    std::tm sys_time;
+    localtime_r(&timer, &sys_time);
+    cur_today = sys_time.tm_mday;
     {
         std::lock_guard<std::mutex> locker(_mutex);
-        if(_fp) { 
-            fflush(_fp);
-            fclose(_fp);
-        }
-
-        _fp = fopen(file_name, "a");
-        if(_fp == nullptr) {
-            mkdir(path, 0777);
-            _fp = fopen(file_name, "a");
-        } 
+        cur_row = 0;
+        open_file(sys_time);
         assert(_fp != nullptr);
     }
 
     // async config
     if(async_) {
         async_flag = true;
-        std::unique_ptr<blocking_queue<std::string>> temp_queue(new blocking_queue<std::string>(queue_capacity));
-        log_block_queue = std::move(temp_queue);
-        for(unsigned i = 0; i < thread_num; ++i) {
-            log_write_thread_vec.push_back(std::thread(&Log::async_flush, this));
+        overflow_policy = overflow;
+        ring_capacity = static_cast<size_t>(queue_capacity) * AVG_LINE_LEN;
+        if(ring_capacity < MIN_RING_LEN) {
+            ring_capacity = MIN_RING_LEN;
+        }
+        if(thread_num <= 0) {
+            thread_num = 1;
+        }
+        running = true;
+        for(int i = 0; i < thread_num; ++i) {
+            log_write_thread_vec.push_back(std::thread(&Log::async_flush, this, i));
         }
     } else {
         async_flag = false;
     }
+    inited = true;
 }
 
 
 void Log::write(LOG_LEVEL level, const char *format, ...) {
-    if(level < log_level) {
+    if(level < log_level || !inited.load(std::memory_order_acquire)) {
         return;
     }
 
+    static thread_local char line_buf[LOG_BUFFER_LEN];
+    int n = format_prefix(line_buf, level);
+    va_list valst;
+    va_start(valst, format);
+    int m = vsnprintf(line_buf + n, LOG_BUFFER_LEN - n - 1, format, valst);
+    va_end(valst);
+    if(m < 0) {
+        m = 0;
+    } else if(m > LOG_BUFFER_LEN - n - 2) {
+        m = LOG_BUFFER_LEN - n - 2;      // 超长截断
+    }
+    line_buf[n + m] = '\n';
+    uint32_t len = n + m + 1;
 
-    // 按照日期分片
-    // std::time_t timer = std::time(nullptr);
-    // std::tm *sysTime = std::localtime(&timer);
-    struct timeval now = {0, 0};
-    gettimeofday(&now, nullptr);
-    std::time_t timer = now.tv_sec;
-    std::tm *sysTime = localtime(&timer);
-    {
-        std::lock_guard<std::mutex> locker(_mutex);
-        if(cur_today != sysTime->tm_mday) {
-            cur_today = sysTime->tm_mday;
-            cur_row = 0;
-            cur_day_file_total = 0;
-            char file_name[LOG_NAME_LEN] = {0};
-            snprintf(file_name, LOG_NAME_LEN - 1, "%s/application_%04d_%02d_%02d.log_%02d", 
-                dir_name, sysTime->tm_year + 1900, sysTime->tm_mon + 1, sysTime->tm_mday, cur_day_file_total);
-
-            fflush(_fp);
-            fclose(_fp);
-            _fp = fopen(file_name, "a");
+    if(!async_flag) {
+        write_batch(line_buf, &len, 1);
+        return;
+    }
+
+    log_ring* ring = local_ring();
+    while(!ring->push(line_buf, len)) {
+        if(overflow_policy == OVERFLOW_DROP || !running.load(std::memory_order_relaxed)) {
+            dropped_count.fetch_add(1, std::memory_order_relaxed);
+            return;
         }
+        wakeup_flush();
+        std::this_thread::yield();
     }
+    wakeup_flush();
+}
+
+uint64_t Log::dropped() const {
+    return dropped_count.load(std::memory_order_relaxed);
+}
 
-    // 按照行数分片
-    {
-        std::lock_guard<std::mutex> locker(_mutex);
-        if(cur_row >= max_row_per_file) {
-            cur_row = 0;
-            cur_day_file_total++;
-            char file_name[LOG_NAME_LEN] = {0};
-            snprintf(file_name, LOG_NAME_LEN - 1, "%s/application_%04d_%02d_%02d.log_%02d", 
-                dir_name, sysTime->tm_year + 1900, sysTime->tm_mon + 1, sysTime->tm_mday, cur_day_file_total);
 
-            fflush(_fp);
-            fclose(_fp);
-            _fp = fopen(file_name, "a");
+/**
+ * private method
+ */
+
+void Log::async_flush(int index) {
+    std::vector<char> batch(FLUSH_BATCH_LEN);
+    std::vector<uint32_t> lens;
+    while(true) {
+        /* 先读取running再取日志，保证退出前最后一轮能取完所有环 */
+        bool stopping = !running.load(std::memory_order_acquire);
+        if(drain(index, batch, lens) > 0) {
+            write_batch(batch.data(), lens.data(), lens.size());
+            continue;
+        }
+        if(stopping) {
+            break;
         }
+        std::unique_lock<std::mutex> locker(wake_mutex);
+        sleepers.fetch_add(1);
+        /* 写日志的线程不持有wake_mutex通知，超时兜底可能丢失的唤醒 */
+        wake_cond.wait_for(locker, std::chrono::milliseconds(50),
+                           [this]{ return wakeup_flag.load() || !running.load(); });
+        sleepers.fetch_sub(1);
+        wakeup_flag.store(false);
     }
+}
 
-    // 写入文件
-    {
-        std::lock_guard<std::mutex> locker(_mutex);
-        std::string line_str;
-        va_list valst;
-        va_start(valst, format);
-
-        const char* level_prefix = get_level_title(level);
-        int n = snprintf(line_buf, 48, "%d-%02d-%02d %02d:%02d:%02d.%06ld %s ",
-                     sysTime->tm_year + 1900, sysTime->tm_mon + 1, sysTime->tm_mday,
-                     sysTime->tm_hour, sysTime->tm_min, sysTime->tm_sec, now.tv_usec, level_prefix);
-
-        int m = vsnprintf(line_buf + n, LOG_BUFFER_LEN - 1, format, valst);
-        line_buf[n + m] = '\n';
-        line_buf[n + m + 1] = '\0';
-        line_str = line_buf;
-
-        if(async_flag) {
-            log_block_queue->push(line_str);
-        } else {
-            fputs(line_str.c_str(), _fp);
-            fflush(_fp);
-            cur_row++;
+size_t Log::drain(int index, std::vector<char>& batch, std::vector<uint32_t>& lens) {
+    lens.clear();
+    size_t used = 0;
+    std::lock_guard<std::mutex> locker(ring_mutex);
+    for(size_t i = 0; i < rings.size(); ) {
+        if(rings[i].owner != index) {
+            ++i;
+            continue;
+        }
+        log_ring* ring = rings[i].ring.get();
+        bool closed = ring->is_closed();
+        int len;
+        while((len = ring->pop(batch.data() + used, batch.size() - used)) > 0) {
+            lens.push_back(len);
+            used += len;
         }
-        va_end(valst);
+        if(len < 0) {
+            break;                  // 本批已满
+        }
+        if(closed && ring->empty()) {
+            rings.erase(rings.begin() + i);
+            continue;
+        }
+        ++i;
     }
-
+    return lens.size();
 }
 
+void Log::write_batch(const char* data, const uint32_t* lens, size_t num) {
+    std::time_t timer = std::time(nullptr);
+    std::tm sys_time;
+    localtime_r(&timer, &sys_time);
 
-void Log::async_flush() {
-    std::string str("");
-    while(!log_block_queue->is_finish()) {
-        if(log_block_queue->pop(str)) {
-            std::lock_guard<std::mutex> locker(_mutex);
-            fputs(str.c_str(), _fp);
-            fflush(_fp);
+    std::lock_guard<std::mutex> locker(_mutex);
+    // 按照日期分片
+    if(cur_today != sys_time.tm_mday) {
+        cur_today = sys_time.tm_mday;
+        cur_row = 0;
+        cur_day_file_total = 0;
+        open_file(sys_time);
+    }
+    // 按照行数分片，同一文件内的连续日志合并为一次fwrite
+    size_t i = 0;
+    while(i < num && _fp != nullptr) {
+        if(cur_row >= max_row_per_file) {
+            cur_row = 0;
+            cur_day_file_total++;
+            open_file(sys_time);
+            continue;
+        }
+        size_t bytes = 0;
+        while(i < num && cur_row < max_row_per_file) {
+            bytes += lens[i++];
             cur_row++;
         }
+        fwrite(data, 1, bytes, _fp);
+        data += bytes;
+    }
+    if(_fp != nullptr) {
+        fflush(_fp);
+    }
+}
+
+void Log::open_file(const std::tm& sys_time) {
+    char file_name[LOG_NAME_LEN] = {0};
+    snprintf(file_name, LOG_NAME_LEN - 1, "%s/application_%04d_%02d_%02d.log_%02d", 
+            dir_name.c_str(), sys_time.tm_year + 1900, sys_time.tm_mon + 1, sys_time.tm_mday, cur_day_file_total);
+    if(_fp) {
+        fflush(_fp);
+        fclose(_fp);
+    }
+    _fp = fopen(file_name, "a");
+    if(_fp == nullptr) {
+        mkdir(dir_name.c_str(), 0777);
+        _fp = fopen(file_name, "a");
     }
 }
 
+log_ring* Log::local_ring() {
+    if(!t_ring.ring) {
+        t_ring.ring = std::make_shared<log_ring>(ring_capacity);
+        std::lock_guard<std::mutex> locker(ring_mutex);
+        ring_slot slot = {t_ring.ring, next_owner++ % static_cast<int>(log_write_thread_vec.size())};
+        rings.push_back(slot);
+    }
+    return t_ring.ring.get();
+}
+
+void Log::wakeup_flush() {
+    if(sleepers.load(std::memory_order_relaxed) > 0 && !wakeup_flag.exchange(true)) {
+        wake_cond.notify_all();
+    }
+}
+
+int Log::format_prefix(char* buf, LOG_LEVEL level) {
+    /* "YYYY-MM-DD hh:mm:ss"按线程缓存，秒数变化时才重新计算 */
+    static thread_local time_t cached_sec = -1;
+    static thread_local char cached_time[32];
+    static thread_local int cached_len = 0;
+
+    struct timeval now = {0, 0};
+    gettimeofday(&now, nullptr);
+    if(now.tv_sec != cached_sec) {
+        std::tm sys_time;
+        localtime_r(&now.tv_sec, &sys_time);
+        cached_len = snprintf(cached_time, sizeof(cached_time), "%d-%02d-%02d %02d:%02d:%02d",
+                              sys_time.tm_year + 1900, sys_time.tm_mon + 1, sys_time.tm_mday,
+                              sys_time.tm_hour, sys_time.tm_min, sys_time.tm_sec);
+        cached_sec = now.tv_sec;
+    }
+
+    char* p = buf;
+    memcpy(p, cached_time, cached_len);
+    p += cached_len;
+    *p++ = '.';
+    long usec = now.tv_usec;
+    for(int i = 5; i >= 0; --i) {
+        p[i] = static_cast<char>('0' + usec % 10);
+        usec /= 10;
+    }
+    p += 6;
+    *p++ = ' ';
+    const char* title = get_level_title(level);
+    size_t title_len = strlen(title);
+    memcpy(p, title, title_len);
+    p += title_len;
+    *p++ = ' ';
+    return static_cast<int>(p - buf);
+}
 
 const char *Log::get_level_title(LOG_LEVEL level) {
-    std::string str;
     switch (level) {
         case LOG_LEVEL::DEBUG:
-            str = "[DEBUG]:";
-            break;
+            return "[DEBUG]:";
         case LOG_LEVEL::INFO: 
-            str = "[INFO]:";
-            break;
+            return "[INFO]:";
         case LOG_LEVEL::WARN:
-            str = "[WARN]:";
-            break;
+            return "[WARN]:";
         case LOG_LEVEL::ERROR:
-            str = "[ERROR]:";
-            break;
-        default:str = "[INFO]:";
+            return "[ERROR]:";
+        default:
+            return "[INFO]:";
     }
-    return str.c_str();
 }
\ No newline at end of file
@@ -5,19 +5,29 @@
 #include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstring>       // memset
 #include <cstdarg>       // vastart va_end
 #include <sys/stat.h>    // mkdir
 #include <sys/time.h>    // time
+#include <condition_variable>
 
-#include "blocking_queue.h"
+#include "log_ring.h"
 
 /**
  * @brief 简单日志功能实现，支持功能：
  *  1. 支持同步、异步多线程写入
  *  2. 支持按行数分割日志
  *  3. 日志参数支持热更新
+ *
+ * 异步模式下写日志的线程不加锁、不等待磁盘：
+ *  1. 每个线程拥有独立的无锁环(log_ring)，格式化后直接写入自己的环
+ *  2. flush线程按环分工，批量取出后一次fwrite写入文件
+ *  3. 时间戳前缀按线程缓存，每秒只调用一次localtime
+ *  4. 环满时按overflow策略丢弃(计数)或等待flush线程腾出空间
  */
 
 enum LOG_LEVEL {
@@ -27,42 +37,79 @@ enum LOG_LEVEL {
     ERROR
 };
 
+enum LOG_OVERFLOW {
+    OVERFLOW_DROP,             // 丢弃并计数，写日志的线程永不等待
+    OVERFLOW_BLOCK             // 等待flush线程腾出空间
+};
+
 class Log {
 
 public:
     static Log *get_instance();
 
+    /**
+     * @param queue_capacity 异步模式下每个线程的环可容纳的日志条数(按平均128字节估算)
+     */
     void init(const char* path, int max_size, LOG_LEVEL level, 
-            bool async_flag, int queue_capacity, int thread_num);
+            bool async_flag, int queue_capacity, int thread_num,
+            LOG_OVERFLOW overflow = OVERFLOW_DROP);
 
     void write(LOG_LEVEL level, const char *format, ...);
 
+    /**
+     * @brief 因环满被丢弃的日志条数
+     */
+    uint64_t dropped() const;
+
 private:
     Log();
     ~Log();
-    void async_flush();
-    const char* get_level_title(LOG_LEVEL level);
+    void async_flush(int index);
+    size_t drain(int index, std::vector<char>& batch, std::vector<uint32_t>& lens);
+    void write_batch(const char* data, const uint32_t* lens, size_t num);
+    void open_file(const std::tm& sys_time);
+    log_ring* local_ring();
+    void wakeup_flush();
+    static int format_prefix(char* buf, LOG_LEVEL level);
+    static const char* get_level_title(LOG_LEVEL level);
 
 private:
     static const int LOG_NAME_LEN = 256;
     static const int LOG_BUFFER_LEN = 20480;
+    static const int AVG_LINE_LEN = 128;
+    static const size_t MIN_RING_LEN = 65536;
+    static const size_t FLUSH_BATCH_LEN = 262144;
 
+    struct ring_slot {
+        std::shared_ptr<log_ring> ring;
+        int owner;                 // 负责该环的flush线程
+    };
 
-    const char* dir_name;      // 路径名
+    std::string dir_name;      // 路径名
     int max_row_per_file;      // 每个日志文件的最大行数
     int cur_row;               // 当前行数
     int cur_day_file_total;    // 当天日志文件个数
     int cur_today;             // 当前的日期
 
     LOG_LEVEL log_level;
-    char* line_buf;
+    std::atomic<bool> inited;
 
     bool async_flag;           // 异步写入相关属性
-    std::unique_ptr<blocking_queue<std::string>> log_block_queue;
+    LOG_OVERFLOW overflow_policy;
+    size_t ring_capacity;
+    std::mutex ring_mutex;     // 保护rings，仅在线程首次写日志和flush线程遍历时使用
+    std::vector<ring_slot> rings;
+    int next_owner;
     std::vector<std::thread> log_write_thread_vec;
+    std::atomic<bool> running;
+    std::atomic<int> sleepers;
+    std::atomic<bool> wakeup_flag;
+    std::mutex wake_mutex;
+    std::condition_variable wake_cond;
+    std::atomic<uint64_t> dropped_count;
 
     FILE *_fp;                 // 日志文件fd
-    mutable std::mutex _mutex;
+    mutable std::mutex _mutex; // 保护文件及行数，只有flush线程(同步模式下为写日志的线程)使用
 };
 
 
@@ -0,0 +1,114 @@
+#ifndef _LOG_RING_H
+#define _LOG_RING_H
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief 单生产者单消费者的无锁字节环，每条日志存为 [4字节长度][内容]
+ *  1. 生产者只写head，消费者只写tail，两者都单调递增，按mask取模定位
+ *  2. 写入跨越环尾时拆成两段拷贝，读出时同样拼接，调用方看到的始终是连续内存
+ *  3. 空间不足时push直接返回false，由调用方决定丢弃还是等待
+ */
+class log_ring {
+
+private:
+    static const size_t CACHE_LINE = 64;
+    static const size_t HEADER_LEN = sizeof(uint32_t);
+
+    size_t capacity;
+    size_t mask;
+    std::unique_ptr<char[]> buffer;
+    char pad0[CACHE_LINE];
+    std::atomic<size_t> head;          // 生产者写入位置
+    char pad1[CACHE_LINE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail;          // 消费者读取位置
+    char pad2[CACHE_LINE - sizeof(std::atomic<size_t>)];
+    std::atomic<bool> closed;          // 所属线程已退出
+
+public:
+    explicit log_ring(size_t cap = 65536): head(0), tail(0), closed(false) {
+        size_t size = 64;
+        while(size < cap) {
+            size <<= 1;
+        }
+        capacity = size;
+        mask = size - 1;
+        buffer.reset(new char[size]);
+    }
+
+    log_ring(const log_ring&) = delete;
+    log_ring& operator=(const log_ring&) = delete;
+
+    /**
+     * @brief 单条日志允许的最大长度
+     */
+    size_t max_record() const {
+        return capacity - HEADER_LEN;
+    }
+
+    /**
+     * @brief 仅由所属线程调用
+     */
+    bool push(const char* data, uint32_t len) {
+        size_t need = HEADER_LEN + len;
+        size_t h = head.load(std::memory_order_relaxed);
+        if(need > capacity - (h - tail.load(std::memory_order_acquire))) {
+            return false;
+        }
+        copy_in(h, reinterpret_cast<const char*>(&len), HEADER_LEN);
+        copy_in(h + HEADER_LEN, data, len);
+        head.store(h + need, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 仅由负责该环的flush线程调用，取出一条日志到out
+     * @return 日志长度; 0: 环为空; -1: out剩余空间cap放不下下一条
+     */
+    int pop(char* out, size_t cap) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if(t == head.load(std::memory_order_acquire)) {
+            return 0;
+        }
+        uint32_t len = 0;
+        copy_out(t, reinterpret_cast<char*>(&len), HEADER_LEN);
+        if(len > cap) {
+            return -1;
+        }
+        copy_out(t + HEADER_LEN, out, len);
+        tail.store(t + HEADER_LEN + len, std::memory_order_release);
+        return static_cast<int>(len);
+    }
+
+    bool empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+    bool is_closed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+private:
+    void copy_in(size_t pos, const char* src, size_t len) {
+        size_t off = pos & mask;
+        size_t first = len < capacity - off ? len : capacity - off;
+        memcpy(buffer.get() + off, src, first);
+        memcpy(buffer.get(), src + first, len - first);
+    }
+
+    void copy_out(size_t pos, char* dst, size_t len) const {
+        size_t off = pos & mask;
+        size_t first = len < capacity - off ? len : capacity - off;
+        memcpy(dst, buffer.get() + off, first);
+        memcpy(dst + first, buffer.get(), len - first);
+    }
+};
+
+#endif
\ No newline at end of file
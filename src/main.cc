@@ -1,7 +1,23 @@
+#include <cstring>
+#include <cstdlib>
+
 #include "web_server.h"
 
-int main() {
-    socket_options options(9000, true, true);
+int main(int argc, char* argv[]) {
+    /* ./src_bin [epoll|io_uring] [max_connections] [tls_port cert.pem key.pem] */
+    POLLER_TYPE poller = POLLER_EPOLL;
+    if(argc > 1 && strcmp(argv[1], "io_uring") == 0) {
+        poller = POLLER_IO_URING;
+    }
+    socket_options options(9000, true, true, 1, poller);
+    if(argc > 2 && atoi(argv[2]) > 0) {
+        options.max_connections = atoi(argv[2]);
+    }
+    if(argc > 5) {
+        options.tls_port = atoi(argv[3]);
+        options.tls_cert = argv[4];
+        options.tls_key = argv[5];
+    }
     web_server http_server(web_server::EPOLL_MODE::LISTEN_CONNECTION_LT, 30000, options);
     http_server.start();
 }
\ No newline at end of file
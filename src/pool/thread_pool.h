@@ -5,9 +5,12 @@
 #include <queue>
 #include <thread>
 #include <vector>
+#include <memory>
 #include <atomic>
+#include <cstdint>
 #include <stdexcept>
 #include <functional>
+#include <condition_variable>
 
 template<typename T>
 class threadsafe_queue {
@@ -19,7 +22,7 @@ private:
 public:
     void push(T data) {
         std::lock_guard<std::mutex> lg(_mutex);
-        _queue.push(data);
+        _queue.push(std::move(data));
     }
 
     bool pop(T& value) {
@@ -34,13 +37,108 @@ public:
 };
 
 
+/**
+ * @brief 有界无锁MPMC环形队列(Vyukov)，每个cell携带序号：
+ *  seq == pos       可写
+ *  seq == pos + 1   可读
+ * 生产者、消费者各自只CAS自己的游标，互不争用同一把锁
+ */
+template<typename T>
+class lockfree_ring {
+
+private:
+    static const size_t CACHE_LINE = 64;
+
+    struct cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    size_t mask;
+    std::unique_ptr<cell[]> buffer;
+    char pad0[CACHE_LINE];
+    std::atomic<size_t> enqueue_pos;
+    char pad1[CACHE_LINE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_pos;
+    char pad2[CACHE_LINE - sizeof(std::atomic<size_t>)];
+
+public:
+    explicit lockfree_ring(size_t capacity = 1024): enqueue_pos(0), dequeue_pos(0) {
+        size_t size = 2;
+        while(size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        buffer.reset(new cell[size]);
+        for(size_t i = 0; i < size; ++i) {
+            buffer[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    lockfree_ring(const lockfree_ring&) = delete;
+    lockfree_ring& operator=(const lockfree_ring&) = delete;
+
+    bool push(T& value) {
+        cell* c;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while(true) {
+            c = &buffer[pos & mask];
+            size_t seq = c->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0) {
+                if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;       // 队列已满
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        c->data = std::move(value);
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        cell* c;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while(true) {
+            c = &buffer[pos & mask];
+            size_t seq = c->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(diff == 0) {
+                if(dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;       // 队列为空
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(c->data);
+        c->seq.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+
+/**
+ * @brief work-stealing线程池
+ *  1. 每个worker拥有独立的无锁队列，submit按线程轮询投递，worker内部submit投递到自身队列
+ *  2. 本地队列为空时依次从其他worker窃取任务
+ *  3. 所有队列都为空时worker在条件变量上休眠，空闲时不占用cpu
+ */
 class thread_pool {
 
 private:
+    typedef std::function<void()> task_type;
+
     class join_threads {
     private:
         std::vector<std::thread> &threads_;
-    
+
     public:
         explicit join_threads(std::vector<std::thread>& th): threads_(th) {}
         ~join_threads() {
@@ -52,47 +150,127 @@ private:
         }
     };
 
+    static const unsigned LOCAL_QUEUE_SIZE = 1024;
+    static const unsigned SPIN_ROUNDS = 64;
+
     std::atomic_bool done;
-    threadsafe_queue<std::function<void()>> work_queue;
+    std::vector<std::unique_ptr<lockfree_ring<task_type>>> local_queues;
+    threadsafe_queue<task_type> overflow_queue;     // 本地队列满时兜底
+
+    std::atomic<int> pending;                       // 已投递未取出的任务数
+    std::atomic<int> sleepers;                      // 休眠中的worker数
+    std::mutex park_mutex;
+    std::condition_variable park_cond;
+
     std::vector<std::thread> threads;
     join_threads joins;
 
-    void worker_thread() {
+    /* 当前线程所属的线程池及worker序号，用于worker内部submit时投递到本地队列 */
+    struct worker_context {
+        const thread_pool* pool;
+        unsigned index;
+    };
+
+    static worker_context& current_worker() {
+        static thread_local worker_context ctx = {nullptr, 0};
+        return ctx;
+    }
+
+    static unsigned& submit_cursor() {
+        static thread_local unsigned cursor = 0;
+        return cursor;
+    }
+
+    bool try_acquire(unsigned index, task_type& task) {
+        if(local_queues[index]->pop(task)) {
+            return true;
+        }
+        /* 从相邻worker开始窃取，避免所有worker同时争抢同一个队列 */
+        unsigned n = local_queues.size();
+        for(unsigned i = 1; i < n; ++i) {
+            if(local_queues[(index + i) % n]->pop(task)) {
+                return true;
+            }
+        }
+        return overflow_queue.pop(task);
+    }
+
+    void worker_thread(unsigned index) {
+        current_worker().pool = this;
+        current_worker().index = index;
+        unsigned idle_rounds = 0;
         while(!done) {
-            std::function<void()> task;
-            if(work_queue.pop(task)) {
+            task_type task;
+            if(try_acquire(index, task)) {
+                pending.fetch_sub(1);
+                idle_rounds = 0;
                 task();
-            } else {
-                std::this_thread::yield;
+                continue;
+            }
+            if(++idle_rounds < SPIN_ROUNDS) {
+                std::this_thread::yield();
+                continue;
             }
+            idle_rounds = 0;
+            std::unique_lock<std::mutex> locker(park_mutex);
+            sleepers.fetch_add(1);
+            park_cond.wait(locker, [this]{ return done.load() || pending.load() > 0; });
+            sleepers.fetch_sub(1);
         }
     }
 
 public:
-    thread_pool(unsigned capacity = 8): done(false), joins(threads) {
+    thread_pool(unsigned capacity = 8): done(false), pending(0), sleepers(0), joins(threads) {
         unsigned count = std::thread::hardware_concurrency();
         if(capacity > count) {
             throw std::out_of_range("thread pool init capacity over hardware count");
         }
+        for(unsigned i = 0; i < capacity; ++i) {
+            local_queues.emplace_back(new lockfree_ring<task_type>(LOCAL_QUEUE_SIZE));
+        }
         try {
             for(unsigned i = 0; i < capacity; ++i) {
-                threads.push_back(std::thread(&thread_pool::worker_thread, this));
+                threads.push_back(std::thread(&thread_pool::worker_thread, this, i));
             }
         } catch(...) {
             done = true;
+            park_cond.notify_all();
             throw;
         }
     }
 
     ~thread_pool() {
         done = true;
+        std::lock_guard<std::mutex> locker(park_mutex);
+        park_cond.notify_all();
     }
 
     template<typename FunctionType>
     void submit(FunctionType f) {
-        work_queue.push(std::forward<FunctionType>(f));
+        task_type task(std::move(f));
+        const worker_context& ctx = current_worker();
+        unsigned index = ctx.pool == this ? ctx.index : (submit_cursor()++) % local_queues.size();
+        if(!local_queues[index]->push(task)) {
+            overflow_queue.push(std::move(task));
+        }
+        /**
+         * pending先于sleepers可见: worker在park_mutex内检查pending，
+         * 若此处看到sleepers为0，则worker必定能看到新的pending
+         */
+        pending.fetch_add(1);
+        if(sleepers.load() > 0) {
+            std::lock_guard<std::mutex> locker(park_mutex);
+            park_cond.notify_one();
+        }
     }
-    
+
+    /**
+     * @brief 已投递未取出的任务数(近似值，用于监控)
+     */
+    int pending_tasks() const {
+        return pending.load(std::memory_order_relaxed);
+    }
+
 };
 
 
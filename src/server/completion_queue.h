@@ -0,0 +1,73 @@
+#ifndef _COMPLETION_QUEUE_H
+#define _COMPLETION_QUEUE_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "http/session_pool.h"
+
+
+/**
+ * @brief worker处理完请求后交还给reactor的完成队列(多生产者，单消费者为所属reactor)
+ *  1. worker不再调用epoll_ctl，poller的注册只由reactor线程修改
+ *  2. 队列由空变为非空时才写eventfd，同一批完成只唤醒reactor一次
+ *  3. reactor先读eventfd再整体交换出队列，交换之后到达的完成会重新写eventfd，不会丢失唤醒
+ */
+class completion_queue {
+public:
+    struct item {
+        session_ptr session;
+        uint64_t token;         // 提交任务时的fd + 连接代数，连接已关闭或fd被复用时丢弃
+        bool has_response;      // false: 请求不完整，只需重新等待可读
+    };
+
+public:
+    completion_queue(): event_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+
+    ~completion_queue() {
+        if(event_fd >= 0) {
+            close(event_fd);
+        }
+    }
+
+    completion_queue(const completion_queue&) = delete;
+    completion_queue& operator=(const completion_queue&) = delete;
+
+    int fd() const { return event_fd; }
+
+    void push(session_ptr session, uint64_t token, bool has_response) {
+        bool notify = false;
+        {
+            std::lock_guard<std::mutex> locker(mutex);
+            notify = items.empty();
+            items.push_back(item{std::move(session), token, has_response});
+        }
+        if(notify) {
+            uint64_t one = 1;
+            ssize_t ret = write(event_fd, &one, sizeof(one));
+            (void)ret;
+        }
+    }
+
+    /**
+     * @brief 取出当前所有完成项，out中原有的内容会被清空(复用容量)
+     */
+    void drain(std::vector<item>& out) {
+        uint64_t cnt = 0;
+        ssize_t ret = read(event_fd, &cnt, sizeof(cnt));
+        (void)ret;
+        out.clear();
+        std::lock_guard<std::mutex> locker(mutex);
+        items.swap(out);
+    }
+
+private:
+    int event_fd;
+    std::mutex mutex;
+    std::vector<item> items;
+};
+
+#endif
\ No newline at end of file
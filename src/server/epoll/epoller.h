@@ -8,7 +8,9 @@
 #include <vector>
 #include <cassert>
 
-class epoller {
+#include "poller.h"
+
+class epoller : public poller {
 public:
     explicit epoller(int max_event_size): _epoll_fd(epoll_create(512)), _events(max_event_size) {
         assert(_epoll_fd >= 0 && _events.size() > 0);
@@ -25,46 +27,46 @@ public:
 
 
 public:
-    void add_fd(int fd, uint32_t events) {
+    void add_fd(int fd, uint32_t events, uint64_t data) override {
         struct epoll_event event;
-        event.data.fd = fd;
+        event.data.u64 = data;
         event.events = events;
 
         int epl_ctl = epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event);
         assert(epl_ctl >= 0);
-
-        int op = fcntl(fd, F_GETFL);
-        op = op | O_NONBLOCK;
-        fcntl(fd, F_SETFL, op);
     }
 
-    void mod_fd(int fd, uint32_t events) {
+    void mod_fd(int fd, uint32_t events, uint64_t data) override {
         assert(fd >= 0);
         struct epoll_event event;
-        event.data.fd = fd;
+        event.data.u64 = data;
         event.events = events;
         epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, fd, &event);
     }
 
-    void del_fd(int fd) {
+    void del_fd(int fd) override {
         assert(fd >= 0);
         epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
     }
 
-    int wait(int timeout = -1) {
+    int wait(int timeout = -1) override {
         return epoll_wait(_epoll_fd, &_events[0], static_cast<int>(_events.size()), timeout);
     }
 
-    int get_event_fd(size_t i) const {
+    uint64_t get_event_data(size_t i) const override {
         assert(i < _events.size() && i >= 0);
-        return _events[i].data.fd;
+        return _events[i].data.u64;
     }
 
-    uint32_t get_event(size_t i) const {
+    uint32_t get_event(size_t i) const override {
         assert(i < _events.size() && i >= 0);
         return _events[i].events;
     }
 
+    const char* name() const override {
+        return "epoll";
+    }
+
 private:
     int _epoll_fd;
     std::vector<struct epoll_event> _events;
@@ -0,0 +1,15 @@
+#include "poller.h"
+#include "epoller.h"
+#include "uring_poller.h"
+#include "../../logger/log.h"
+
+std::shared_ptr<poller> make_poller(POLLER_TYPE type, int max_event_size) {
+    if(type == POLLER_IO_URING) {
+        std::shared_ptr<uring_poller> uring = std::make_shared<uring_poller>(max_event_size);
+        if(uring->valid()) {
+            return uring;
+        }
+        LOG_WARN("io_uring unavailable, fall back to epoll");
+    }
+    return std::make_shared<epoller>(max_event_size);
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef _POLLER_H
+#define _POLLER_H
+
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <stdint.h>
+
+#include <memory>
+#include <cassert>
+
+struct msghdr;
+
+/**
+ * @brief I/O多路复用后端
+ */
+enum POLLER_TYPE {
+    POLLER_EPOLL = 0,
+    POLLER_IO_URING     // io_uring: 明文连接基于完成的accept/recv/send，其余fd使用POLL_ADD就绪通知
+};
+
+
+/**
+ * @brief 事件的来源: 就绪通知或某个I/O操作的完成
+ */
+enum POLLER_OP {
+    OP_POLL = 0,        // 就绪事件，get_event为EPOLL*掩码
+    OP_ACCEPT,          // get_result为新连接的fd或-errno
+    OP_RECV,            // get_result为接收的字节数(0: 对端关闭)或-errno，数据在get_buffer中
+    OP_SEND             // get_result为发送的字节数或-errno
+};
+
+
+/**
+ * @brief 多路复用抽象接口，事件掩码统一使用EPOLL*语义：
+ *  EPOLLIN/EPOLLOUT/EPOLLRDHUP/EPOLLHUP/EPOLLERR 描述就绪事件
+ *  EPOLLONESHOT 触发一次后需要mod_fd重新注册
+ *  EPOLLET 由具体实现尽力支持
+ * 所有方法只在所属reactor线程调用，worker处理完的连接经完成队列交还reactor后再修改注册
+ * add_fd的fd须已是非阻塞的(accept4/socket时指定SOCK_NONBLOCK)，poller不再逐个fcntl
+ * 注册时的data在就绪事件中原样返回(epoll_event.data.u64)，reactor用它同时携带fd与连接代数
+ *
+ * completion_io()为true时还支持基于完成的I/O，操作结果作为事件返回(get_op区分):
+ *  1. accept_multishot/recv_multishot提交一次后持续产生完成事件，直到del_fd
+ *  2. recv的数据位于poller的缓冲区中，只在下一次wait之前有效，调用方需要立即拷贝
+ *  3. send_msg同一fd同时只能有一个，msg及其引用的数据在完成事件返回前必须有效；
+ *     del_fd之后它的完成事件仍会上报，调用方收到后才能close(fd)并释放数据
+ *  同一fd上的注册与操作共用一个data
+ */
+class poller {
+public:
+    poller() = default;
+    virtual ~poller() = default;
+
+    poller(const poller&) = delete;
+    poller& operator=(const poller&) = delete;
+
+public:
+    virtual void add_fd(int fd, uint32_t events, uint64_t data) = 0;
+
+    virtual void mod_fd(int fd, uint32_t events, uint64_t data) = 0;
+
+    virtual void del_fd(int fd) = 0;
+
+    virtual int wait(int timeout = -1) = 0;
+
+    virtual uint64_t get_event_data(size_t i) const = 0;
+
+    virtual uint32_t get_event(size_t i) const = 0;
+
+    virtual const char* name() const = 0;
+
+public:
+    virtual bool completion_io() const { return false; }
+
+    virtual void accept_multishot(int fd, uint64_t data) { assert(false); }
+
+    virtual void recv_multishot(int fd, uint64_t data) { assert(false); }
+
+    virtual bool send_msg(int fd, const struct msghdr* msg, int flags, uint64_t data) { assert(false); return false; }
+
+    virtual POLLER_OP get_op(size_t i) const { return OP_POLL; }
+
+    virtual int get_result(size_t i) const { return 0; }
+
+    virtual const char* get_buffer(size_t i) const { return nullptr; }
+};
+
+
+/**
+ * @brief 按类型创建poller，io_uring不可用时(内核不支持或被seccomp禁用)回退到epoll
+ */
+std::shared_ptr<poller> make_poller(POLLER_TYPE type, int max_event_size);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,499 @@
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include "uring_poller.h"
+#include "../../logger/log.h"
+
+namespace {
+
+int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                       const void* arg, size_t argsz) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+}
+
+
+uring_poller::uring_poller(int max_event_size):
+    _ring_fd(-1), _sq_entries(0), _to_submit(0),
+    _sq_ptr(MAP_FAILED), _sq_size(0), _sqes(nullptr), _sqes_size(0),
+    _cq_ptr(MAP_FAILED), _cq_size(0), _buf_ring(nullptr), _buf_ring_size(0), _events(max_event_size) {
+
+    assert(_events.size() > 0);
+    unsigned entries = 256;
+    while(entries < static_cast<unsigned>(max_event_size)) {
+        entries <<= 1;
+    }
+    if(!setup_ring(entries)) {
+        LOG_ERROR("io_uring setup failed, errno: %d", errno);
+        return;
+    }
+    if(!setup_buf_ring()) {
+        LOG_WARN("io_uring provided buffer ring unavailable, use POLL_ADD only, errno: %d", errno);
+    }
+}
+
+uring_poller::~uring_poller() {
+    if(_buf_ring != nullptr) {
+        munmap(_buf_ring, _buf_ring_size);
+    }
+    if(_sqes != nullptr) {
+        munmap(_sqes, _sqes_size);
+    }
+    if(_cq_ptr != MAP_FAILED && _cq_ptr != _sq_ptr) {
+        munmap(_cq_ptr, _cq_size);
+    }
+    if(_sq_ptr != MAP_FAILED) {
+        munmap(_sq_ptr, _sq_size);
+    }
+    if(_ring_fd >= 0) {
+        close(_ring_fd);
+    }
+}
+
+void uring_poller::add_fd(int fd, uint32_t events, uint64_t data) {
+    assert(fd >= 0);
+    fd_state& st = state_of(fd);
+    if(st.armed) {
+        prep_poll_remove(fd, st);
+    }
+    st.events = events;
+    st.data = data;
+    prep_poll_add(fd, st);
+}
+
+void uring_poller::mod_fd(int fd, uint32_t events, uint64_t data) {
+    assert(fd >= 0);
+    fd_state& st = state_of(fd);
+    if(st.armed) {
+        prep_poll_remove(fd, st);
+    }
+    st.events = events;
+    st.data = data;
+    prep_poll_add(fd, st);
+}
+
+void uring_poller::del_fd(int fd) {
+    assert(fd >= 0);
+    fd_state& st = state_of(fd);
+    if(st.armed) {
+        prep_poll_remove(fd, st);
+    }
+    /* 按user_data取消，调用方随后close(fd)也不影响；send的完成事件仍会上报 */
+    if(st.accepting) {
+        prep_cancel(make_user_data(fd, st.gen, OP_ACCEPT));
+    }
+    if(st.receiving) {
+        prep_cancel(make_user_data(fd, st.gen, OP_RECV));
+    }
+    if(st.sending) {
+        prep_cancel(make_user_data(fd, st.gen, OP_SEND));
+    }
+    st.accepting = false;
+    st.receiving = false;
+    /* 序号递增，已在CQ中的旧事件全部作废 */
+    st.seq++;
+    st.gen++;
+    st.events = 0;
+}
+
+void uring_poller::accept_multishot(int fd, uint64_t data) {
+    assert(fd >= 0 && completion_io());
+    fd_state& st = state_of(fd);
+    st.data = data;
+    st.accepting = prep_op(fd, OP_ACCEPT, st);
+}
+
+void uring_poller::recv_multishot(int fd, uint64_t data) {
+    assert(fd >= 0 && completion_io());
+    fd_state& st = state_of(fd);
+    st.data = data;
+    st.receiving = prep_op(fd, OP_RECV, st);
+}
+
+bool uring_poller::send_msg(int fd, const struct msghdr* msg, int flags, uint64_t data) {
+    assert(fd >= 0 && completion_io());
+    fd_state& st = state_of(fd);
+    assert(!st.sending);
+    struct io_uring_sqe* sqe = get_sqe();
+    if(sqe == nullptr) {
+        LOG_ERROR("io_uring sq overflow, send dropped, fd: %d", fd);
+        return false;
+    }
+    st.data = data;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->msg_flags = static_cast<uint32_t>(flags);
+    sqe->user_data = make_user_data(fd, st.gen, OP_SEND);
+    commit_sqe();
+    st.sending = true;
+    return true;
+}
+
+int uring_poller::wait(int timeout) {
+    /* 上一批事件中的数据调用方已处理完 */
+    recycle_buffers();
+
+    unsigned to_submit = _to_submit;
+    _to_submit = 0;
+
+    int num = reap_completions();
+    if(num > 0) {
+        if(to_submit > 0) {
+            enter(to_submit, 0, 0);
+        }
+        return num;
+    }
+
+    /* 提交本轮积累的注册请求并等待完成事件，只需一次系统调用 */
+    enter(to_submit, timeout == 0 ? 0 : 1, timeout);
+    return reap_completions();
+}
+
+
+/**
+ * private method
+ */
+
+bool uring_poller::setup_ring(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(entries, &params);
+    if(fd < 0) {
+        return false;
+    }
+    /* 依赖IORING_ENTER_EXT_ARG实现带超时的等待(5.11+) */
+    if(!(params.features & IORING_FEAT_EXT_ARG)) {
+        close(fd);
+        errno = ENOSYS;
+        return false;
+    }
+
+    _sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap) {
+        _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+    }
+
+    _sq_ptr = mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(_sq_ptr == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    if(single_mmap) {
+        _cq_ptr = _sq_ptr;
+    } else {
+        _cq_ptr = mmap(nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if(_cq_ptr == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+    }
+    _sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    _sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(_sq_ptr);
+    _sq_head  = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    _sq_tail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    _sq_mask  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    _sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char* cq = static_cast<char*>(_cq_ptr);
+    _cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    _cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    _cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    _cqes    = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    _sq_entries = params.sq_entries;
+    _ring_fd = fd;
+    return true;
+}
+
+bool uring_poller::setup_buf_ring() {
+    /* multishot recv需要6.0+，用同一版本引入的IORING_SETUP_SINGLE_ISSUER探测 */
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER;
+    int probe = sys_io_uring_setup(1, &params);
+    if(probe < 0) {
+        return false;
+    }
+    close(probe);
+
+    _buf_ring_size = RECV_BUF_NUM * sizeof(struct io_uring_buf);
+    void* ring = mmap(nullptr, _buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if(ring == MAP_FAILED) {
+        return false;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = RECV_BUF_NUM;
+    reg.bgid = BUF_GROUP;
+    if(sys_io_uring_register(_ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ring, _buf_ring_size);
+        return false;
+    }
+    _buf_ring = static_cast<struct io_uring_buf_ring*>(ring);
+    _buf_pool.resize(static_cast<size_t>(RECV_BUF_NUM) * RECV_BUF_SIZE);
+    for(unsigned i = 0; i < RECV_BUF_NUM; ++i) {
+        _used_bufs.push_back(static_cast<uint16_t>(i));
+    }
+    recycle_buffers();
+    return true;
+}
+
+/**
+ * @brief 把交给调用方的缓冲区放回缓冲区环尾部，发布tail后内核才能再次使用
+ */
+void uring_poller::recycle_buffers() {
+    if(_used_bufs.empty()) {
+        return;
+    }
+    /* 头文件中的bufs在C++下被编译器放在偏移8处(__DECLARE_FLEX_ARRAY的空结构体)，按数组直接访问 */
+    struct io_uring_buf* bufs = reinterpret_cast<struct io_uring_buf*>(_buf_ring);
+    uint16_t tail = _buf_ring->tail;
+    for(uint16_t bid: _used_bufs) {
+        struct io_uring_buf* buf = &bufs[tail & (RECV_BUF_NUM - 1)];
+        buf->addr = reinterpret_cast<uint64_t>(&_buf_pool[static_cast<size_t>(bid) * RECV_BUF_SIZE]);
+        buf->len = RECV_BUF_SIZE;
+        buf->bid = bid;
+        ++tail;
+    }
+    __atomic_store_n(&_buf_ring->tail, tail, __ATOMIC_RELEASE);
+    _used_bufs.clear();
+}
+
+uring_poller::fd_state& uring_poller::state_of(int fd) {
+    if(static_cast<size_t>(fd) >= _fds.size()) {
+        fd_state empty = {0, 0, 0, false, false, false, false, 0};
+        _fds.resize(std::max(static_cast<size_t>(fd) + 1, _fds.size() * 2), empty);
+    }
+    return _fds[fd];
+}
+
+struct io_uring_sqe* uring_poller::get_sqe() {
+    unsigned tail = *_sq_tail;
+    unsigned head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+    if(tail - head >= _sq_entries) {
+        /* SQ已满，先把积压的请求提交给内核 */
+        enter(_to_submit, 0, 0);
+        _to_submit = 0;
+        head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+        if(tail - head >= _sq_entries) {
+            return nullptr;
+        }
+    }
+    struct io_uring_sqe* sqe = &_sqes[tail & *_sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+void uring_poller::commit_sqe() {
+    /* sqe填写完整后才推进tail，内核不会读到半成品 */
+    unsigned tail = *_sq_tail;
+    _sq_array[tail & *_sq_mask] = tail & *_sq_mask;
+    __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++_to_submit;
+}
+
+void uring_poller::prep_poll_add(int fd, fd_state& st) {
+    struct io_uring_sqe* sqe = get_sqe();
+    if(sqe == nullptr) {
+        LOG_ERROR("io_uring sq overflow, poll add dropped, fd: %d", fd);
+        return;
+    }
+    st.seq++;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = st.events & ~(EPOLLONESHOT | EPOLLET);
+    if(!(st.events & EPOLLONESHOT)) {
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+    sqe->user_data = make_user_data(fd, st.seq);
+    commit_sqe();
+    st.armed = true;
+}
+
+void uring_poller::prep_poll_remove(int fd, fd_state& st) {
+    struct io_uring_sqe* sqe = get_sqe();
+    if(sqe == nullptr) {
+        LOG_ERROR("io_uring sq overflow, poll remove dropped, fd: %d", fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = make_user_data(fd, st.seq);
+    sqe->user_data = TAG_REMOVE;
+    commit_sqe();
+    st.armed = false;
+}
+
+bool uring_poller::prep_op(int fd, POLLER_OP op, fd_state& st) {
+    struct io_uring_sqe* sqe = get_sqe();
+    if(sqe == nullptr) {
+        LOG_ERROR("io_uring sq overflow, op(%d) dropped, fd: %d", op, fd);
+        return false;
+    }
+    sqe->fd = fd;
+    if(op == OP_ACCEPT) {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    } else {
+        /* 数据到达时内核才从缓冲区环中取缓冲区，空闲连接不占用缓冲区 */
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUF_GROUP;
+    }
+    sqe->user_data = make_user_data(fd, st.gen, op);
+    commit_sqe();
+    return true;
+}
+
+void uring_poller::prep_cancel(uint64_t user_data) {
+    struct io_uring_sqe* sqe = get_sqe();
+    if(sqe == nullptr) {
+        LOG_ERROR("io_uring sq overflow, cancel dropped");
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = TAG_REMOVE;
+    commit_sqe();
+}
+
+/**
+ * @brief 处理accept/recv/send的完成事件，需要上报时填写ev并返回true
+ */
+bool uring_poller::complete_op(int fd, POLLER_OP op, uint32_t seq, const struct io_uring_cqe* cqe,
+                               const char* buf, event& ev) {
+    fd_state& st = _fds[fd];
+    if(op == OP_SEND) {
+        /* 调用方收到后才释放发送的数据，del_fd之后也要上报 */
+        st.sending = false;
+    } else {
+        if((st.gen & SEQ_MASK) != seq) {
+            return false;       // del_fd之后的残留事件
+        }
+        bool& active = op == OP_ACCEPT ? st.accepting : st.receiving;
+        if(!(cqe->flags & IORING_CQE_F_MORE)) {
+            /* multishot被内核终止(缓冲区耗尽、CQ溢出、accept出错)，还能继续时重新提交，在下一次wait归还缓冲区后生效 */
+            bool retry = op == OP_ACCEPT ? (cqe->res != -EINVAL && cqe->res != -EBADF && cqe->res != -ECANCELED)
+                                         : (cqe->res > 0 || cqe->res == -ENOBUFS);
+            active = retry && prep_op(fd, op, st);
+        }
+        if(cqe->res == -ECANCELED || (op == OP_RECV && cqe->res == -ENOBUFS)) {
+            return false;
+        }
+    }
+    ev.data = st.data;
+    ev.events = 0;
+    ev.op = op;
+    ev.res = cqe->res;
+    ev.buf = buf;
+    return true;
+}
+
+int uring_poller::enter(unsigned to_submit, unsigned min_complete, int timeout) {
+    unsigned flags = 0;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    memset(&arg, 0, sizeof(arg));
+    if(min_complete > 0) {
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        if(timeout >= 0) {
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+    } else if(to_submit == 0) {
+        return 0;
+    }
+
+    int ret = sys_io_uring_enter(_ring_fd, to_submit, min_complete, flags,
+                                 (flags & IORING_ENTER_EXT_ARG) ? &arg : nullptr,
+                                 (flags & IORING_ENTER_EXT_ARG) ? sizeof(arg) : 0);
+    if(ret < 0 && errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        LOG_ERROR("io_uring enter error, errno: %d", errno);
+    }
+    return ret;
+}
+
+int uring_poller::reap_completions() {
+    unsigned head = *_cq_head;
+    unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+    size_t num = 0;
+    while(head != tail && num < _events.size()) {
+        const struct io_uring_cqe* cqe = &_cqes[head & *_cq_mask];
+        ++head;
+        /* 取到缓冲区的recv完成事件，即使丢弃也要归还缓冲区 */
+        const char* buf = nullptr;
+        if(cqe->flags & IORING_CQE_F_BUFFER) {
+            uint16_t bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            _used_bufs.push_back(bid);
+            buf = &_buf_pool[static_cast<size_t>(bid) * RECV_BUF_SIZE];
+        }
+        if(cqe->user_data & TAG_REMOVE) {
+            continue;
+        }
+        int fd = static_cast<int>(cqe->user_data & 0xffffffff);
+        uint32_t seq = static_cast<uint32_t>(cqe->user_data >> 32) & SEQ_MASK;
+        POLLER_OP op = static_cast<POLLER_OP>((cqe->user_data >> 61) & 3);
+        if(static_cast<size_t>(fd) >= _fds.size()) {
+            continue;
+        }
+        if(op != OP_POLL) {
+            if(complete_op(fd, op, seq, cqe, buf, _events[num])) {
+                ++num;
+            }
+            continue;
+        }
+        fd_state& st = _fds[fd];
+        if((st.seq & SEQ_MASK) != seq) {
+            continue;       // fd已修改、删除或被复用
+        }
+        bool more = cqe->flags & IORING_CQE_F_MORE;
+        if(!more) {
+            st.armed = false;
+        }
+        if(cqe->res == -ECANCELED) {
+            continue;
+        }
+        event& ev = _events[num];
+        ev.data = st.data;
+        ev.events = cqe->res < 0 ? EPOLLERR : static_cast<uint32_t>(cqe->res);
+        ev.op = OP_POLL;
+        ev.res = 0;
+        ev.buf = nullptr;
+        ++num;
+        /* multishot被内核终止(如CQ溢出)，非oneshot的fd需要重新注册 */
+        if(!more && !(st.events & EPOLLONESHOT)) {
+            prep_poll_add(fd, st);
+        }
+    }
+    __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+    return static_cast<int>(num);
+}
\ No newline at end of file
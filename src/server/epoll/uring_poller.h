@@ -0,0 +1,158 @@
+#ifndef _URING_POLLER_H
+#define _URING_POLLER_H
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+
+#include <vector>
+#include <cassert>
+
+#include "poller.h"
+
+/**
+ * @brief 基于io_uring的后端，直接使用io_uring_setup/io_uring_enter系统调用，不依赖liburing
+ *  1. 就绪通知: 每次注册对应一个IORING_OP_POLL_ADD，非oneshot的fd(如监听socket)使用multishot poll
+ *  2. 基于完成的I/O(6.0+): multishot accept、从注册的缓冲区环(provided buffer ring)中取缓冲区的multishot recv、
+ *     sendmsg，省去就绪通知之后的accept/recv/sendmsg系统调用；内核不支持时completion_io()为false，只提供就绪通知
+ *  3. 注册/提交只在reactor线程进行，只写入SQ，在下一次wait时与等待合并为一次io_uring_enter，SQ无需加锁
+ *  4. user_data中携带操作类型、fd与序号，过期的完成事件(fd已修改/删除/复用)直接丢弃，
+ *     recv用过的缓冲区在下一次wait时归还到缓冲区环
+ */
+class uring_poller : public poller {
+public:
+    explicit uring_poller(int max_event_size);
+    ~uring_poller();
+
+    uring_poller(const uring_poller&) = delete;
+    uring_poller& operator=(const uring_poller&) = delete;
+
+    bool valid() const { return _ring_fd >= 0; }
+
+public:
+    void add_fd(int fd, uint32_t events, uint64_t data) override;
+
+    void mod_fd(int fd, uint32_t events, uint64_t data) override;
+
+    void del_fd(int fd) override;
+
+    int wait(int timeout = -1) override;
+
+    uint64_t get_event_data(size_t i) const override {
+        assert(i < _events.size());
+        return _events[i].data;
+    }
+
+    uint32_t get_event(size_t i) const override {
+        assert(i < _events.size());
+        return _events[i].events;
+    }
+
+    const char* name() const override {
+        return "io_uring";
+    }
+
+public:
+    bool completion_io() const override { return _buf_ring != nullptr; }
+
+    void accept_multishot(int fd, uint64_t data) override;
+
+    void recv_multishot(int fd, uint64_t data) override;
+
+    bool send_msg(int fd, const struct msghdr* msg, int flags, uint64_t data) override;
+
+    POLLER_OP get_op(size_t i) const override {
+        assert(i < _events.size());
+        return _events[i].op;
+    }
+
+    int get_result(size_t i) const override {
+        assert(i < _events.size());
+        return _events[i].res;
+    }
+
+    const char* get_buffer(size_t i) const override {
+        assert(i < _events.size());
+        return _events[i].buf;
+    }
+
+    static const unsigned RECV_BUF_NUM = 512;      // 缓冲区环的缓冲区个数(2的幂)
+    static const unsigned RECV_BUF_SIZE = 4096;    // 与读缓冲区的块大小相同
+
+private:
+    struct fd_state {
+        uint32_t seq;          // poll注册序号，每次重新注册递增
+        uint32_t gen;          // accept/recv的序号，del_fd时递增
+        uint32_t events;       // 注册的事件掩码
+        bool armed;            // 内核中是否存在该fd的poll请求
+        bool accepting;        // 内核中是否存在该fd的multishot accept/recv/send请求
+        bool receiving;
+        bool sending;
+        uint64_t data;         // 调用方注册的数据，随事件返回
+    };
+
+    struct event {
+        uint64_t data;
+        uint32_t events;
+        POLLER_OP op;
+        int res;
+        const char* buf;
+    };
+
+    static const uint64_t TAG_REMOVE = 1ULL << 63;     // POLL_REMOVE/ASYNC_CANCEL请求自身的完成事件
+    static const uint16_t BUF_GROUP = 0;
+
+    bool setup_ring(unsigned entries);
+    bool setup_buf_ring();
+    void recycle_buffers();
+    fd_state& state_of(int fd);
+    struct io_uring_sqe* get_sqe();
+    void commit_sqe();
+    void prep_poll_add(int fd, fd_state& st);
+    void prep_poll_remove(int fd, fd_state& st);
+    bool prep_op(int fd, POLLER_OP op, fd_state& st);
+    void prep_cancel(uint64_t user_data);
+    bool complete_op(int fd, POLLER_OP op, uint32_t seq, const struct io_uring_cqe* cqe, const char* buf, event& ev);
+    int  enter(unsigned to_submit, unsigned min_complete, int timeout);
+    int  reap_completions();
+
+    static uint64_t make_user_data(int fd, uint32_t seq, POLLER_OP op = OP_POLL) {
+        return (static_cast<uint64_t>(op) << 61) | (static_cast<uint64_t>(seq & SEQ_MASK) << 32)
+            | static_cast<uint32_t>(fd);
+    }
+
+    static const uint32_t SEQ_MASK = 0x1fffffff;
+
+private:
+    int _ring_fd;
+    unsigned _sq_entries;
+    unsigned _to_submit;           // 已写入SQ尚未提交的条目数
+
+    /* SQ ring */
+    void* _sq_ptr;
+    size_t _sq_size;
+    unsigned* _sq_head;
+    unsigned* _sq_tail;
+    unsigned* _sq_mask;
+    unsigned* _sq_array;
+    struct io_uring_sqe* _sqes;
+    size_t _sqes_size;
+
+    /* CQ ring */
+    void* _cq_ptr;
+    size_t _cq_size;
+    unsigned* _cq_head;
+    unsigned* _cq_tail;
+    unsigned* _cq_mask;
+    struct io_uring_cqe* _cqes;
+
+    /* provided buffer ring: 内核为multishot recv从中取缓冲区 */
+    struct io_uring_buf_ring* _buf_ring;
+    size_t _buf_ring_size;
+    std::vector<char> _buf_pool;
+    std::vector<uint16_t> _used_bufs;   // 已交给调用方的缓冲区，下一次wait时归还
+
+    std::vector<fd_state> _fds;
+    std::vector<event> _events;
+};
+
+#endif
\ No newline at end of file
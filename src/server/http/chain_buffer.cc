@@ -0,0 +1,250 @@
+#include <cerrno>
+#include <cstring>
+#include <sys/uio.h>
+
+#include "chain_buffer.h"
+
+
+buffer_block_pool::buffer_block_pool(size_t max_idle): idle(max_idle), allocated(0), reused(0) {}
+
+buffer_block_pool::~buffer_block_pool() {
+    char* block = nullptr;
+    while(idle.pop(block)) {
+        delete []block;
+    }
+}
+
+buffer_block_pool* buffer_block_pool::get_instance() {
+    /* 最多缓存4096个空闲块(16MB) */
+    static buffer_block_pool instance(4096);
+    return &instance;
+}
+
+char* buffer_block_pool::acquire() {
+    char* block = nullptr;
+    if(idle.pop(block)) {
+        reused.fetch_add(1, std::memory_order_relaxed);
+        return block;
+    }
+    allocated.fetch_add(1, std::memory_order_relaxed);
+    return new char[BLOCK_SIZE];
+}
+
+void buffer_block_pool::release(char* block) {
+    if(!idle.push(block)) {
+        delete []block;
+    }
+}
+
+buffer_block_pool::pool_stats buffer_block_pool::stats() const {
+    pool_stats res = {allocated.load(std::memory_order_relaxed), reused.load(std::memory_order_relaxed)};
+    return res;
+}
+
+
+chain_buffer::chain_buffer(size_t max_size): total(0), limit(max_size) {
+    segments.reserve(4);
+}
+
+chain_buffer::~chain_buffer() {
+    clear();
+}
+
+ssize_t chain_buffer::read_fd(int fd, int& saved_errno) {
+    if(total >= limit) {
+        saved_errno = ENOBUFS;
+        return -1;
+    }
+    size_t budget = limit - total;
+
+    /* 尾段剩余空间 + 1~2个新块，一次readv读入 */
+    struct iovec iov[3];
+    segment spare[2];
+    int iov_cnt = 0;
+    int spare_cnt = 0;
+    size_t room = 0;
+    if(!segments.empty() && segments.back().end < segments.back().cap) {
+        segment& tail = segments.back();
+        room = tail.cap - tail.end;
+        room = room < budget ? room : budget;
+        iov[iov_cnt].iov_base = tail.data + tail.end;
+        iov[iov_cnt].iov_len = room;
+        iov_cnt++;
+    }
+    size_t offered = room;
+    int want = room > 0 ? 1 : 2;
+    while(spare_cnt < want && offered < budget) {
+        spare[spare_cnt] = make_block();
+        size_t len = BLOCK_SIZE < budget - offered ? BLOCK_SIZE : budget - offered;
+        iov[iov_cnt].iov_base = spare[spare_cnt].data;
+        iov[iov_cnt].iov_len = len;
+        offered += len;
+        iov_cnt++;
+        spare_cnt++;
+    }
+
+    ssize_t n = readv(fd, iov, iov_cnt);
+    if(n < 0) {
+        saved_errno = errno;
+    }
+    size_t left = n > 0 ? static_cast<size_t>(n) : 0;
+    total += left;
+    if(room > 0) {
+        size_t used = left < room ? left : room;
+        segments.back().end += used;
+        left -= used;
+    }
+    for(int i = 0; i < spare_cnt; ++i) {
+        if(left > 0) {
+            spare[i].end = left < BLOCK_SIZE ? left : BLOCK_SIZE;
+            left -= spare[i].end;
+            segments.push_back(spare[i]);
+        } else {
+            free_segment(spare[i]);
+        }
+    }
+    return n;
+}
+
+bool chain_buffer::append(const char* data, size_t len) {
+    if(len > limit - total) {
+        return false;
+    }
+    while(len > 0) {
+        if(segments.empty() || segments.back().end == segments.back().cap) {
+            segments.push_back(make_block());
+        }
+        segment& tail = segments.back();
+        size_t n = tail.cap - tail.end;
+        n = n < len ? n : len;
+        memcpy(tail.data + tail.end, data, n);
+        tail.end += n;
+        total += n;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+char* chain_buffer::prepare(size_t& len) {
+    if(total >= limit) {
+        len = 0;
+        return nullptr;
+    }
+    if(segments.empty() || segments.back().end == segments.back().cap) {
+        segments.push_back(make_block());
+    }
+    segment& tail = segments.back();
+    len = tail.cap - tail.end;
+    len = len < limit - total ? len : limit - total;
+    return tail.data + tail.end;
+}
+
+void chain_buffer::commit(size_t n) {
+    segment& tail = segments.back();
+    tail.end += n;
+    total += n;
+    /* prepare新取的块没有写入数据时立即归还 */
+    if(tail.begin == tail.end) {
+        free_segment(tail);
+        segments.pop_back();
+    }
+}
+
+const char* chain_buffer::pullup(size_t n) {
+    if(segments.empty()) {
+        return nullptr;
+    }
+    segment& head = segments.front();
+    if(n > total) {
+        n = total;
+    }
+    if(head.end - head.begin >= n) {
+        return head.data + head.begin;
+    }
+
+    /* 首段空间足够时把后续数据搬进首段，否则分配一块足够大的连续内存 */
+    if(head.cap - head.begin < n) {
+        size_t cap = BLOCK_SIZE;
+        while(cap < n) {
+            cap <<= 1;
+        }
+        segment merged = {new char[cap], cap, 0, 0, false};
+        size_t len = head.end - head.begin;
+        memcpy(merged.data, head.data + head.begin, len);
+        merged.end = len;
+        free_segment(head);
+        head = merged;
+    } else if(head.cap - head.end < n - (head.end - head.begin)) {
+        memmove(head.data, head.data + head.begin, head.end - head.begin);
+        head.end -= head.begin;
+        head.begin = 0;
+    }
+    while(head.end - head.begin < n) {
+        segment& next = segments[1];
+        size_t need = n - (head.end - head.begin);
+        size_t len = next.end - next.begin;
+        len = len < need ? len : need;
+        memcpy(head.data + head.end, next.data + next.begin, len);
+        head.end += len;
+        next.begin += len;
+        if(next.begin == next.end) {
+            free_segment(next);
+            segments.erase(segments.begin() + 1);
+        }
+    }
+    return segments.front().data + segments.front().begin;
+}
+
+void chain_buffer::consume(size_t n) {
+    if(n > total) {
+        n = total;
+    }
+    total -= n;
+    while(n > 0) {
+        segment& head = segments.front();
+        size_t len = head.end - head.begin;
+        if(n < len) {
+            head.begin += n;
+            return;
+        }
+        n -= len;
+        pop_front();
+    }
+    /* 已读完的首段立即归还，空闲连接不持有内存块 */
+    while(!segments.empty() && segments.front().begin == segments.front().end) {
+        pop_front();
+    }
+}
+
+void chain_buffer::clear() {
+    for(size_t i = 0; i < segments.size(); ++i) {
+        free_segment(segments[i]);
+    }
+    segments.clear();
+    total = 0;
+}
+
+
+/**
+ * private method
+ */
+
+chain_buffer::segment chain_buffer::make_block() {
+    segment seg = {buffer_block_pool::get_instance()->acquire(), BLOCK_SIZE, 0, 0, true};
+    return seg;
+}
+
+void chain_buffer::free_segment(segment& seg) {
+    if(seg.pooled) {
+        buffer_block_pool::get_instance()->release(seg.data);
+    } else {
+        delete []seg.data;
+    }
+    seg.data = nullptr;
+}
+
+void chain_buffer::pop_front() {
+    free_segment(segments.front());
+    segments.erase(segments.begin());
+}
\ No newline at end of file
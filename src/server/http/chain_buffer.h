@@ -0,0 +1,119 @@
+#ifndef _CHAIN_BUFFER_H
+#define _CHAIN_BUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <sys/types.h>
+
+#include "../../pool/thread_pool.h"
+
+/**
+ * @brief 进程内共享的固定大小内存块池，块在连接之间复用，不清零
+ */
+class buffer_block_pool {
+public:
+    static const size_t BLOCK_SIZE = 4096;
+
+    struct pool_stats {
+        uint64_t allocated;
+        uint64_t reused;
+    };
+
+public:
+    static buffer_block_pool* get_instance();
+
+    char* acquire();
+
+    void release(char* block);
+
+    pool_stats stats() const;
+
+private:
+    explicit buffer_block_pool(size_t max_idle);
+    ~buffer_block_pool();
+    buffer_block_pool(const buffer_block_pool&) = delete;
+    buffer_block_pool& operator=(const buffer_block_pool&) = delete;
+
+    lockfree_ring<char*> idle;
+    std::atomic<uint64_t> allocated;
+    std::atomic<uint64_t> reused;
+};
+
+
+/**
+ * @brief 由内存块串成的可增长读缓冲区
+ *  1. 数据按[begin, end)分布在若干段中，读取时用readv散布到尾段剩余空间和新块
+ *  2. consume只移动游标，整段读完后块立即归还，空闲连接不占用缓冲区
+ *  3. 解析器需要连续内存时用pullup合并前n个字节，数据位于同一段时不拷贝
+ */
+class chain_buffer {
+public:
+    static const size_t BLOCK_SIZE = buffer_block_pool::BLOCK_SIZE;
+
+public:
+    explicit chain_buffer(size_t max_size = 1 << 20);
+    ~chain_buffer();
+    chain_buffer(const chain_buffer&) = delete;
+    chain_buffer& operator=(const chain_buffer&) = delete;
+
+    size_t size() const { return total; }
+    bool empty() const { return total == 0; }
+    bool full() const { return total >= limit; }
+
+    /**
+     * @brief 从fd读取一次
+     * @return 读取的字节数; 0: 对端关闭; -1: 出错或已达上限，saved_errno为errno(达到上限时为ENOBUFS)
+     */
+    ssize_t read_fd(int fd, int& saved_errno);
+
+    /**
+     * @brief 追加数据(测试及非socket来源使用)
+     */
+    bool append(const char* data, size_t len);
+
+    /**
+     * @brief 返回尾部可直接写入的连续空间，len为其大小(不足时追加一个新块)，已达上限时返回nullptr
+     * 写入后用commit确认实际写入的字节数，用于TLS解密等不能直接readv的来源
+     */
+    char* prepare(size_t& len);
+
+    void commit(size_t n);
+
+    /**
+     * @brief 保证前n个字节(n <= size())位于一段连续内存中，返回其起始地址
+     */
+    const char* pullup(size_t n);
+
+    /**
+     * @brief 丢弃前n个字节
+     */
+    void consume(size_t n);
+
+    /**
+     * @brief 丢弃全部数据并归还所有块
+     */
+    void clear();
+
+    size_t segment_count() const { return segments.size(); }
+
+private:
+    struct segment {
+        char*  data;
+        size_t cap;
+        size_t begin;
+        size_t end;
+        bool   pooled;     // 来自buffer_block_pool，否则为pullup分配的大块
+    };
+
+    static segment make_block();
+    static void free_segment(segment& seg);
+    void pop_front();
+
+private:
+    std::vector<segment> segments;
+    size_t total;
+    size_t limit;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include <cstring>
+
+#include "date_header.h"
+
+std::atomic<time_t> date_header::current(0);
+std::atomic<uint32_t> date_header::sequence(0);
+std::atomic<uint64_t> date_header::words[date_header::WORDS];
+std::atomic_flag date_header::writing = ATOMIC_FLAG_INIT;
+
+
+void date_header::refresh() {
+    time_t now = time(nullptr);
+    if(now == current.load(std::memory_order_relaxed)) {
+        return;
+    }
+    /* 其它reactor正在更新时不等待，本轮沿用上一秒的值 */
+    if(writing.test_and_set(std::memory_order_acquire)) {
+        return;
+    }
+    if(now != current.load(std::memory_order_relaxed)) {
+        format(now);
+        current.store(now, std::memory_order_relaxed);
+    }
+    writing.clear(std::memory_order_release);
+}
+
+void date_header::append(std::string& out) {
+    char buf[WORDS * 8];
+    load(buf);
+    out.append(buf, LENGTH);
+}
+
+std::string date_header::value() {
+    char buf[WORDS * 8];
+    load(buf);
+    /* 去掉"Date: "与结尾的CRLF */
+    return std::string(buf + 6, LENGTH - 8);
+}
+
+
+/**
+ * private method
+ */
+
+void date_header::format(time_t now) {
+    char buf[WORDS * 8] = { 0 };
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    strftime(buf, sizeof(buf), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for(size_t i = 0; i < WORDS; ++i) {
+        uint64_t word;
+        memcpy(&word, buf + i * 8, 8);
+        words[i].store(word, std::memory_order_relaxed);
+    }
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+void date_header::load(char* buf) {
+    /* 另一个线程正在做第一次格式化时等它完成 */
+    while(sequence.load(std::memory_order_acquire) == 0) {
+        refresh();
+    }
+    while(true) {
+        uint32_t begin = sequence.load(std::memory_order_acquire);
+        if(begin & 1) {
+            continue;
+        }
+        for(size_t i = 0; i < WORDS; ++i) {
+            uint64_t word = words[i].load(std::memory_order_relaxed);
+            memcpy(buf + i * 8, &word, 8);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(sequence.load(std::memory_order_relaxed) == begin) {
+            return;
+        }
+    }
+}
\ No newline at end of file
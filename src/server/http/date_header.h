@@ -0,0 +1,48 @@
+#ifndef _DATE_HEADER_H
+#define _DATE_HEADER_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+/**
+ * @brief 所有线程共用的"Date: <IMF-fixdate>\r\n"响应头
+ *  1. 由各reactor在每轮事件处理前调用refresh，秒数变化时只有一个线程重新格式化
+ *  2. 内容放在原子字里并用序号(seqlock)发布，读者不加锁、不分配内存，读到写入中途的内容时重读
+ *  3. 没有reactor的场景(单元测试、启动预加载)第一次读取时自行初始化
+ */
+class date_header {
+public:
+    static const size_t LENGTH = 37;    // "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+
+public:
+    /**
+     * @brief 当前秒与上次格式化时相同则直接返回
+     */
+    static void refresh();
+
+    /**
+     * @brief 向out追加当前的Date头(包括结尾的CRLF)
+     */
+    static void append(std::string& out);
+
+    /**
+     * @brief 只取日期值(HTTP/2的date字段)
+     */
+    static std::string value();
+
+private:
+    static void format(time_t now);
+    static void load(char* buf);
+
+private:
+    static const size_t WORDS = (LENGTH + 7) / 8;
+
+    static std::atomic<time_t> current;
+    static std::atomic<uint32_t> sequence;      // 奇数: 写入中；0: 尚未初始化
+    static std::atomic<uint64_t> words[WORDS];
+    static std::atomic_flag writing;
+};
+
+#endif
\ No newline at end of file
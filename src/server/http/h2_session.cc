@@ -0,0 +1,811 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <unistd.h>
+
+#include "h2_session.h"
+#include "date_header.h"
+#include "http_session.h"
+#include "../metrics.h"
+
+namespace {
+
+inline uint32_t read_u32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+         | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline void append_u32(std::string& out, uint32_t v) {
+    out.push_back(static_cast<char>(v >> 24));
+    out.push_back(static_cast<char>(v >> 16));
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v));
+}
+
+inline void append_setting(std::string& out, uint16_t id, uint32_t value) {
+    out.push_back(static_cast<char>(id >> 8));
+    out.push_back(static_cast<char>(id));
+    append_u32(out, value);
+}
+
+/**
+ * @brief HTTP/2禁止的逐跳(connection-specific)头部
+ */
+bool connection_specific(const std::string& name) {
+    return name == "connection" || name == "keep-alive" || name == "transfer-encoding"
+        || name == "upgrade" || name == "proxy-connection";
+}
+
+}
+
+
+h2_session::h2_session():
+    preface_received(false), settings_received(false), goaway_sent(false), peer_goaway(false),
+    last_stream_id(0), conn_send_window(DEFAULT_WINDOW), conn_recv_window(CONN_RECV_WINDOW),
+    conn_recv_consumed(0), peer_initial_window(DEFAULT_WINDOW), peer_max_frame(MAX_FRAME_SIZE),
+    decoder(hpack_decoder::DEFAULT_TABLE_SIZE, MAX_HEADER_LIST_SIZE),
+    block_stream(0), block_end_stream(false), open_streams(0) {
+    /* 服务端连接前言: SETTINGS，并把连接级接收窗口从默认的64KB调大 */
+    std::string settings;
+    append_setting(settings, SETTINGS_MAX_CONCURRENT_STREAMS, MAX_CONCURRENT_STREAMS);
+    append_setting(settings, SETTINGS_INITIAL_WINDOW_SIZE, STREAM_RECV_WINDOW);
+    append_setting(settings, SETTINGS_MAX_HEADER_LIST_SIZE, MAX_HEADER_LIST_SIZE);
+    append_frame_header(control, settings.size(), FRAME_SETTINGS, 0, 0);
+    control += settings;
+    append_frame_header(control, 4, FRAME_WINDOW_UPDATE, 0, 0);
+    append_u32(control, CONN_RECV_WINDOW - DEFAULT_WINDOW);
+}
+
+h2_session::~h2_session() {
+    for(auto& item: streams) {
+        if(item.second->file_fd >= 0) {
+            close(item.second->file_fd);
+        }
+    }
+}
+
+bool h2_session::start_upgrade(const std::string& settings, const std::string& head, http_response& rsp) {
+    if(!apply_settings(reinterpret_cast<const uint8_t*>(settings.data()), settings.size())) {
+        return false;
+    }
+    /* 升级请求已完整接收，流1处于half-closed(remote) */
+    h2_stream& stream = new_stream(1);
+    stream.end_received = true;
+    last_stream_id = 1;
+    attach_response(stream, head, rsp);
+    return true;
+}
+
+void h2_session::process(const char* buf, size_t len, size_t& used) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buf);
+    used = 0;
+    if(goaway_sent) {
+        used = len;         // 连接即将关闭，丢弃之后收到的数据
+        return;
+    }
+    if(!preface_received) {
+        size_t n = std::min(len, H2_PREFACE_LEN);
+        if(memcmp(buf, H2_PREFACE, n) != 0) {
+            connection_error(H2_PROTOCOL_ERROR, "invalid connection preface");
+            used = len;
+            return;
+        }
+        if(n < H2_PREFACE_LEN) {
+            return;
+        }
+        preface_received = true;
+        used = H2_PREFACE_LEN;
+    }
+
+    while(len - used >= FRAME_HEADER_LEN) {
+        const uint8_t* p = data + used;
+        size_t frame_len = (static_cast<size_t>(p[0]) << 16) | (p[1] << 8) | p[2];
+        uint8_t type = p[3];
+        uint8_t flags = p[4];
+        uint32_t stream_id = read_u32(p + 5) & 0x7fffffff;
+        if(frame_len > MAX_FRAME_SIZE) {
+            connection_error(H2_FRAME_SIZE_ERROR, "frame too large");
+            break;
+        }
+        if(len - used - FRAME_HEADER_LEN < frame_len) {
+            break;
+        }
+        /* 前言之后的第一帧必须是SETTINGS */
+        if(!settings_received && type != FRAME_SETTINGS) {
+            connection_error(H2_PROTOCOL_ERROR, "first frame is not SETTINGS");
+            break;
+        }
+        used += FRAME_HEADER_LEN + frame_len;
+        handle_frame(type, flags, stream_id, p + FRAME_HEADER_LEN, frame_len);
+        if(goaway_sent) {
+            break;
+        }
+    }
+    if(goaway_sent) {
+        used = len;
+    }
+}
+
+bool h2_session::schedule(std::vector<pending_response>& out) {
+    size_t queued = out.size();
+
+    /* 上一轮的帧已全部发出，释放结束的流；流可能在两轮之间被重置(RST_STREAM、窗口错误)，
+     * 先从active中移除，避免释放后仍被访问 */
+    active.erase(std::remove_if(active.begin(), active.end(), [](const h2_stream* s) { return s->done; }),
+                 active.end());
+    for(auto it = streams.begin(); it != streams.end();) {
+        h2_stream& stream = *it->second;
+        if(stream.done) {
+            if(stream.file_fd >= 0) {
+                close(stream.file_fd);
+            }
+            it = streams.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::string pending;
+    pending.swap(control);
+    for(h2_stream* stream: active) {
+        refill(*stream);
+        if(stream->headers_sent) {
+            continue;
+        }
+        /* 头部块超过对端帧大小时拆分为HEADERS + CONTINUATION */
+        bool end_stream = stream->segments.empty() && !stream->producer;
+        const std::string& block = stream->header_block;
+        size_t offset = 0;
+        do {
+            size_t n = std::min<size_t>(block.size() - offset, peer_max_frame);
+            uint8_t flags = offset + n == block.size() ? FLAG_END_HEADERS : 0;
+            if(offset == 0) {
+                append_frame_header(pending, n, FRAME_HEADERS, flags | (end_stream ? FLAG_END_STREAM : 0), stream->id);
+            } else {
+                append_frame_header(pending, n, FRAME_CONTINUATION, flags, stream->id);
+            }
+            pending.append(block, offset, n);
+            offset += n;
+        } while(offset < block.size());
+        stream->headers_sent = true;
+        if(end_stream) {
+            close_stream(*stream);
+        }
+    }
+
+    /* 轮转: 每轮每个流最多一帧，直到帧数用完或所有流都因窗口/内容不足无法继续 */
+    int frames = 0;
+    bool progress = true;
+    while(frames < SCHEDULE_FRAMES && progress) {
+        progress = false;
+        for(size_t i = 0; i < active.size() && frames < SCHEDULE_FRAMES; ++i) {
+            if(!active[i]->done && next_data(*active[i], pending, out)) {
+                progress = true;
+                ++frames;
+            }
+        }
+    }
+    active.erase(std::remove_if(active.begin(), active.end(), [](const h2_stream* s) { return s->done; }),
+                 active.end());
+
+    if(!pending.empty()) {
+        out.emplace_back();
+        out.back().head.swap(pending);
+    }
+
+    /* 连接错误发送GOAWAY后关闭；对端GOAWAY后等现有的流结束再关闭 */
+    if(peer_goaway && !goaway_sent && active.empty() && open_streams == 0) {
+        connection_error(H2_NO_ERROR, "peer goaway");
+        out.emplace_back();
+        out.back().head.swap(control);
+    }
+    if(goaway_sent && !out.empty()) {
+        out.back().keepalive = false;
+    }
+    return out.size() > queued;
+}
+
+bool h2_session::base64url_decode(const std::string& in, std::string& out) {
+    out.clear();
+    uint32_t bits = 0;
+    int bit_len = 0;
+    for(char c: in) {
+        int v;
+        if(c >= 'A' && c <= 'Z') {
+            v = c - 'A';
+        } else if(c >= 'a' && c <= 'z') {
+            v = c - 'a' + 26;
+        } else if(c >= '0' && c <= '9') {
+            v = c - '0' + 52;
+        } else if(c == '-' || c == '+') {
+            v = 62;
+        } else if(c == '_' || c == '/') {
+            v = 63;
+        } else if(c == '=') {
+            break;
+        } else {
+            return false;
+        }
+        bits = (bits << 6) | v;
+        bit_len += 6;
+        if(bit_len >= 8) {
+            bit_len -= 8;
+            out.push_back(static_cast<char>(bits >> bit_len));
+        }
+    }
+    return true;
+}
+
+
+/**
+ * private method
+ */
+
+void h2_session::handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len) {
+    /* 头部块未结束时只能收到同一个流的CONTINUATION */
+    if(block_stream != 0 && (type != FRAME_CONTINUATION || stream_id != block_stream)) {
+        connection_error(H2_PROTOCOL_ERROR, "expected CONTINUATION");
+        return;
+    }
+    switch(type) {
+        case FRAME_DATA:
+            handle_data(flags, stream_id, payload, len);
+            break;
+        case FRAME_HEADERS:
+            handle_headers(flags, stream_id, payload, len);
+            break;
+        case FRAME_CONTINUATION:
+            handle_continuation(flags, stream_id, payload, len);
+            break;
+        case FRAME_PRIORITY:
+            /* 不支持优先级，只校验格式 */
+            if(stream_id == 0) {
+                connection_error(H2_PROTOCOL_ERROR, "PRIORITY on stream 0");
+            } else if(len != 5) {
+                stream_error(stream_id, H2_FRAME_SIZE_ERROR);
+            }
+            break;
+        case FRAME_RST_STREAM:
+            handle_rst_stream(stream_id, len);
+            break;
+        case FRAME_SETTINGS:
+            handle_settings(flags, stream_id, payload, len);
+            break;
+        case FRAME_PING:
+            if(stream_id != 0) {
+                connection_error(H2_PROTOCOL_ERROR, "PING on stream");
+            } else if(len != 8) {
+                connection_error(H2_FRAME_SIZE_ERROR, "PING length");
+            } else if(!(flags & FLAG_ACK)) {
+                append_frame_header(control, 8, FRAME_PING, FLAG_ACK, 0);
+                control.append(reinterpret_cast<const char*>(payload), 8);
+            }
+            break;
+        case FRAME_GOAWAY:
+            if(stream_id != 0) {
+                connection_error(H2_PROTOCOL_ERROR, "GOAWAY on stream");
+            } else {
+                peer_goaway = true;
+            }
+            break;
+        case FRAME_WINDOW_UPDATE:
+            handle_window_update(stream_id, payload, len);
+            break;
+        case FRAME_PUSH_PROMISE:
+            connection_error(H2_PROTOCOL_ERROR, "PUSH_PROMISE from client");
+            break;
+        default:
+            break;          // 忽略未知类型的帧
+    }
+}
+
+void h2_session::handle_headers(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len) {
+    if(stream_id == 0 || (stream_id & 1) == 0) {
+        connection_error(H2_PROTOCOL_ERROR, "invalid HEADERS stream id");
+        return;
+    }
+    if(!strip_padding(flags, payload, len) || ((flags & FLAG_PRIORITY) && len < 5)) {
+        connection_error(H2_PROTOCOL_ERROR, "invalid HEADERS padding");
+        return;
+    }
+    if(flags & FLAG_PRIORITY) {
+        payload += 5;
+        len -= 5;
+    }
+    h2_stream* stream = find_stream(stream_id);
+    if(stream == nullptr && stream_id <= last_stream_id) {
+        connection_error(H2_STREAM_CLOSED, "HEADERS on closed stream");
+        return;
+    }
+    if(stream != nullptr && (stream->end_received || !(flags & FLAG_END_STREAM))) {
+        /* 已有的流上只能是结束请求的trailer */
+        connection_error(H2_PROTOCOL_ERROR, "unexpected HEADERS");
+        return;
+    }
+    header_block.assign(reinterpret_cast<const char*>(payload), len);
+    block_stream = stream_id;
+    block_end_stream = (flags & FLAG_END_STREAM) != 0;
+    if(flags & FLAG_END_HEADERS) {
+        finish_headers();
+    }
+}
+
+void h2_session::handle_continuation(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len) {
+    if(block_stream == 0 || stream_id != block_stream) {
+        connection_error(H2_PROTOCOL_ERROR, "unexpected CONTINUATION");
+        return;
+    }
+    header_block.append(reinterpret_cast<const char*>(payload), len);
+    if(header_block.size() > MAX_HEADER_LIST_SIZE) {
+        connection_error(H2_ENHANCE_YOUR_CALM, "header block too large");
+        return;
+    }
+    if(flags & FLAG_END_HEADERS) {
+        finish_headers();
+    }
+}
+
+/**
+ * @brief 头部块接收完整: 解码(即使要拒绝该流也必须解码，保持动态表同步)，新流在请求结束时处理
+ */
+void h2_session::finish_headers() {
+    uint32_t stream_id = block_stream;
+    block_stream = 0;
+    std::vector<hpack_header> headers;
+    if(!decoder.decode(reinterpret_cast<const uint8_t*>(header_block.data()), header_block.size(), headers)) {
+        connection_error(H2_COMPRESSION_ERROR, "hpack decode error");
+        return;
+    }
+
+    h2_stream* stream = find_stream(stream_id);
+    if(stream != nullptr) {
+        /* trailer: 内容不使用，请求到此结束 */
+        stream->end_received = true;
+        dispatch(*stream);
+        return;
+    }
+    last_stream_id = stream_id;
+    if(peer_goaway || open_streams >= MAX_CONCURRENT_STREAMS) {
+        append_frame_header(control, 4, FRAME_RST_STREAM, 0, stream_id);
+        append_u32(control, H2_REFUSED_STREAM);
+        return;
+    }
+    h2_stream& s = new_stream(stream_id);
+    s.headers.swap(headers);
+    s.end_received = block_end_stream;
+    if(s.end_received) {
+        dispatch(s);
+    }
+}
+
+void h2_session::handle_data(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len) {
+    if(stream_id == 0 || stream_id > last_stream_id) {
+        connection_error(H2_PROTOCOL_ERROR, "DATA on idle stream");
+        return;
+    }
+    /* 流控按整个帧负载(含填充)计算 */
+    conn_recv_window -= len;
+    conn_recv_consumed += len;
+    if(conn_recv_window < 0) {
+        connection_error(H2_FLOW_CONTROL_ERROR, "connection receive window exceeded");
+        return;
+    }
+    if(conn_recv_consumed >= CONN_RECV_WINDOW / 2) {
+        append_frame_header(control, 4, FRAME_WINDOW_UPDATE, 0, 0);
+        append_u32(control, static_cast<uint32_t>(conn_recv_consumed));
+        conn_recv_window += conn_recv_consumed;
+        conn_recv_consumed = 0;
+    }
+    if(!strip_padding(flags, payload, len)) {
+        connection_error(H2_PROTOCOL_ERROR, "invalid DATA padding");
+        return;
+    }
+
+    h2_stream* stream = find_stream(stream_id);
+    if(stream == nullptr || stream->end_received) {
+        stream_error(stream_id, H2_STREAM_CLOSED);
+        return;
+    }
+    stream->recv_window -= len;
+    if(stream->recv_window < 0 || stream->body.size() + len > MAX_REQUEST_SIZE) {
+        stream_error(stream_id, stream->recv_window < 0 ? H2_FLOW_CONTROL_ERROR : H2_REFUSED_STREAM);
+        return;
+    }
+    stream->body.append(reinterpret_cast<const char*>(payload), len);
+    if(flags & FLAG_END_STREAM) {
+        stream->end_received = true;
+        dispatch(*stream);
+    }
+}
+
+void h2_session::handle_settings(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len) {
+    if(stream_id != 0) {
+        connection_error(H2_PROTOCOL_ERROR, "SETTINGS on stream");
+        return;
+    }
+    if(flags & FLAG_ACK) {
+        if(len != 0) {
+            connection_error(H2_FRAME_SIZE_ERROR, "SETTINGS ack with payload");
+        }
+        return;
+    }
+    if(len % 6 != 0) {
+        connection_error(H2_FRAME_SIZE_ERROR, "SETTINGS length");
+        return;
+    }
+    if(!apply_settings(payload, len)) {
+        return;
+    }
+    settings_received = true;
+    append_frame_header(control, 0, FRAME_SETTINGS, FLAG_ACK, 0);
+}
+
+bool h2_session::apply_settings(const uint8_t* payload, size_t len) {
+    if(len % 6 != 0) {
+        return false;
+    }
+    for(size_t i = 0; i < len; i += 6) {
+        uint16_t id = static_cast<uint16_t>((payload[i] << 8) | payload[i + 1]);
+        uint32_t value = read_u32(payload + i + 2);
+        switch(id) {
+            case SETTINGS_ENABLE_PUSH:
+                if(value > 1) {
+                    connection_error(H2_PROTOCOL_ERROR, "invalid ENABLE_PUSH");
+                    return false;
+                }
+                break;
+            case SETTINGS_INITIAL_WINDOW_SIZE:
+                if(value > 0x7fffffff) {
+                    connection_error(H2_FLOW_CONTROL_ERROR, "invalid INITIAL_WINDOW_SIZE");
+                    return false;
+                }
+                /* 新的初始窗口对所有流的发送窗口生效，窗口可以变为负数 */
+                for(auto& item: streams) {
+                    item.second->send_window += static_cast<int64_t>(value) - peer_initial_window;
+                }
+                peer_initial_window = value;
+                break;
+            case SETTINGS_MAX_FRAME_SIZE:
+                if(value < MAX_FRAME_SIZE || value > 0xffffff) {
+                    connection_error(H2_PROTOCOL_ERROR, "invalid MAX_FRAME_SIZE");
+                    return false;
+                }
+                peer_max_frame = value;
+                break;
+            default:
+                break;      // 响应头不使用动态表，HEADER_TABLE_SIZE等无需处理
+        }
+    }
+    return true;
+}
+
+void h2_session::handle_window_update(uint32_t stream_id, const uint8_t* payload, size_t len) {
+    if(len != 4) {
+        connection_error(H2_FRAME_SIZE_ERROR, "WINDOW_UPDATE length");
+        return;
+    }
+    uint32_t increment = read_u32(payload) & 0x7fffffff;
+    if(stream_id == 0) {
+        conn_send_window += increment;
+        if(increment == 0 || conn_send_window > 0x7fffffff) {
+            connection_error(increment == 0 ? H2_PROTOCOL_ERROR : H2_FLOW_CONTROL_ERROR, "invalid WINDOW_UPDATE");
+        }
+        return;
+    }
+    if(stream_id > last_stream_id) {
+        connection_error(H2_PROTOCOL_ERROR, "WINDOW_UPDATE on idle stream");
+        return;
+    }
+    h2_stream* stream = find_stream(stream_id);
+    if(stream == nullptr || stream->done) {
+        return;
+    }
+    stream->send_window += increment;
+    if(increment == 0 || stream->send_window > 0x7fffffff) {
+        stream_error(stream_id, increment == 0 ? H2_PROTOCOL_ERROR : H2_FLOW_CONTROL_ERROR);
+    }
+}
+
+void h2_session::handle_rst_stream(uint32_t stream_id, size_t len) {
+    if(stream_id == 0 || stream_id > last_stream_id) {
+        connection_error(H2_PROTOCOL_ERROR, "RST_STREAM on idle stream");
+        return;
+    }
+    if(len != 4) {
+        connection_error(H2_FRAME_SIZE_ERROR, "RST_STREAM length");
+        return;
+    }
+    h2_stream* stream = find_stream(stream_id);
+    if(stream != nullptr) {
+        close_stream(*stream);
+    }
+}
+
+/**
+ * @brief 请求接收完整: 转换为http_request，与HTTP/1.1走相同的路由生成响应
+ */
+void h2_session::dispatch(h2_stream& stream) {
+    std::string method;
+    std::string path;
+    request.reset();
+    response.reset_for_keepalive();
+    size_t content_length = std::string::npos;
+    bool regular = false;
+    bool valid = true;
+    for(const hpack_header& header: stream.headers) {
+        const std::string& name = header.name;
+        if(std::any_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; })
+           || connection_specific(name) || (name == "te" && header.value != "trailers")) {
+            valid = false;
+            break;
+        }
+        if(!name.empty() && name[0] == ':') {
+            /* 伪头部必须在普通头部之前 */
+            if(regular) {
+                valid = false;
+                break;
+            }
+            if(name == ":method") {
+                method = header.value;
+            } else if(name == ":path") {
+                path = header.value;
+            }
+            continue;
+        }
+        regular = true;
+        if(name == "content-length") {
+            content_length = strtoull(header.value.c_str(), nullptr, 10);
+        }
+        request.set_requset_header(http_slice::of(name), http_slice::of(header.value));
+    }
+    if(!valid || method.empty() || path.empty()
+       || (content_length != std::string::npos && content_length != stream.body.size())) {
+        request.reset();
+        stream_error(stream.id, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    /* 请求头片段指向stream.headers，响应生成之后再清空 */
+    static const http_slice version = { "2", 1 };
+    request.set_request_line(http_slice::of(method), http_slice::of(path), version);
+    request.set_request_body(std::move(stream.body));
+    stream.body.clear();
+    http_session::dispatch(request, response, true, true);
+    head_buf.clear();
+    response.build_response(head_buf);
+    attach_response(stream, head_buf, response);
+    request.reset();
+    stream.headers.clear();
+}
+
+/**
+ * @brief 将HTTP/1.1格式的响应转换为流的响应: 状态行与头部编码为HPACK，内容为缓存片段/文件窗口/内存
+ */
+void h2_session::attach_response(h2_stream& stream, const std::string& head, http_response& rsp) {
+    const static_cache::entry_ptr& cached = rsp.get_cached();
+    const std::vector<byte_range>& ranges = rsp.get_ranges();
+    /* 与HTTP/1.1相同: 命中缓存的完整响应使用预序列化的响应头，206使用生成的响应头 */
+    bool cached_head = cached && ranges.empty();
+    const std::string& http1 = cached_head ? cached->headers[1] : head;
+    int code = rsp.get_code();
+    metrics::add(METRIC_REQUESTS);
+    if(code >= 200 && code < 600) {
+        metrics::add(static_cast<METRIC_COUNTER>(METRIC_RESPONSES_2XX + code / 100 - 2));
+    }
+
+    stream.header_block.clear();
+    hpack_encoder::encode_status(code, stream.header_block);
+    size_t line_end = http1.find("\r\n");
+    /* 缓存的响应头不含Date与结尾的空行 */
+    size_t header_end = cached_head ? http1.size() - 2 : http1.find("\r\n\r\n");
+    if(line_end == std::string::npos || header_end == std::string::npos) {
+        header_end = line_end = http1.size();
+    }
+    std::string name;
+    for(size_t pos = line_end + 2; pos < header_end;) {
+        size_t end = http1.find("\r\n", pos);
+        if(end == std::string::npos || end > header_end) {
+            end = header_end;
+        }
+        size_t colon = http1.find(':', pos);
+        if(colon < end) {
+            name.assign(http1, pos, colon - pos);
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            size_t value = http1.find_first_not_of(' ', colon + 1);
+            if(!connection_specific(name)) {
+                hpack_encoder::encode_header(name, value < end ? http1.substr(value, end - value) : "",
+                                             stream.header_block);
+            }
+        }
+        pos = end + 2;
+    }
+    if(cached_head) {
+        hpack_encoder::encode_header("date", date_header::value(), stream.header_block);
+    }
+
+    /* 错误页面与动态内容跟在响应头之后 */
+    if(!cached_head && header_end + 4 < http1.size()) {
+        stream.storage.emplace_back(http1, header_end + 4);
+        const std::string& body = stream.storage.back();
+        stream.segments.push_back(body_segment{ body.data(), -1, 0, body.size() });
+    }
+    int file_fd = !cached && rsp.get_file_fd() >= 0 ? rsp.release_file_fd() : -1;
+    stream.cached = cached;
+    stream.file_fd = file_fd;
+
+    if(ranges.empty()) {
+        if(cached) {
+            stream.segments.push_back(body_segment{ cached->body.data(), -1, 0, cached->body.size() });
+        } else if(file_fd >= 0) {
+            stream.segments.push_back(body_segment{ nullptr, file_fd, 0, rsp.get_file_len() });
+        }
+    } else {
+        for(size_t i = 0; i < ranges.size(); ++i) {
+            if(!ranges[i].part_head.empty()) {
+                stream.storage.push_back(ranges[i].part_head);
+                stream.segments.push_back(body_segment{ stream.storage.back().data(), -1, 0, stream.storage.back().size() });
+            }
+            if(cached) {
+                stream.segments.push_back(body_segment{ cached->body.data() + ranges[i].offset, -1, 0, ranges[i].len });
+            } else {
+                stream.segments.push_back(body_segment{ nullptr, file_fd, ranges[i].offset, ranges[i].len });
+            }
+        }
+        if(!rsp.get_range_tail().empty()) {
+            stream.storage.push_back(rsp.get_range_tail());
+            stream.segments.push_back(body_segment{ stream.storage.back().data(), -1, 0, stream.storage.back().size() });
+        }
+    }
+    stream.producer = rsp.take_producer();
+    rsp.reset_for_keepalive();
+    active.push_back(&stream);
+}
+
+/**
+ * @brief 流式内容: 已生成的部分全部排入后生成下一段；只在schedule开头调用，此时之前的内容已发出
+ */
+void h2_session::refill(h2_stream& stream) {
+    if(!stream.segments.empty() || !stream.producer) {
+        return;
+    }
+    stream.storage.clear();
+    stream.storage.emplace_back();
+    bool more = stream.producer(stream.storage.back());
+    if(!more) {
+        stream.producer = nullptr;
+    }
+    const std::string& piece = stream.storage.back();
+    if(!piece.empty()) {
+        stream.segments.push_back(body_segment{ piece.data(), -1, 0, piece.size() });
+    }
+}
+
+/**
+ * @brief 为流排入一个DATA帧，帧头追加到pending后与之前的控制帧一起作为内存部分
+ * @return 是否排入了帧
+ */
+bool h2_session::next_data(h2_stream& stream, std::string& pending, std::vector<pending_response>& out) {
+    if(stream.segments.empty()) {
+        if(stream.producer) {
+            return false;           // 等待下一轮生成
+        }
+        /* 内容为空的结束: 不受流控限制 */
+        append_frame_header(pending, 0, FRAME_DATA, FLAG_END_STREAM, stream.id);
+        close_stream(stream);
+        return true;
+    }
+    int64_t window = std::min<int64_t>(std::min(stream.send_window, conn_send_window), peer_max_frame);
+    if(window <= 0) {
+        return false;
+    }
+    body_segment& seg = stream.segments.front();
+    size_t n = std::min<size_t>(seg.len, window);
+    bool end_stream = n == seg.len && stream.segments.size() == 1 && !stream.producer;
+    append_frame_header(pending, n, FRAME_DATA, end_stream ? FLAG_END_STREAM : 0, stream.id);
+
+    out.emplace_back();
+    pending_response& rsp = out.back();
+    rsp.head.swap(pending);
+    if(seg.file_fd >= 0) {
+        rsp.file_fd = seg.file_fd;
+        rsp.file_offset = seg.offset;
+        rsp.file_remain = n;
+    } else {
+        rsp.body = seg.mem;
+        rsp.body_len = n;
+    }
+    rsp.cached = stream.cached;
+
+    seg.mem = seg.mem ? seg.mem + n : nullptr;
+    seg.offset += n;
+    seg.len -= n;
+    if(seg.len == 0) {
+        stream.segments.pop_front();
+    }
+    stream.send_window -= n;
+    conn_send_window -= n;
+    if(end_stream) {
+        close_stream(stream);
+    }
+    return true;
+}
+
+void h2_session::connection_error(ERROR_CODE code, const char* reason) {
+    if(goaway_sent) {
+        return;
+    }
+    if(code != H2_NO_ERROR) {
+        LOG_ERROR("h2 connection error %d: %s", code, reason);
+    }
+    append_frame_header(control, 8, FRAME_GOAWAY, 0, 0);
+    append_u32(control, last_stream_id);
+    append_u32(control, code);
+    goaway_sent = true;
+    block_stream = 0;
+}
+
+void h2_session::stream_error(uint32_t stream_id, ERROR_CODE code) {
+    append_frame_header(control, 4, FRAME_RST_STREAM, 0, stream_id);
+    append_u32(control, code);
+    h2_stream* stream = find_stream(stream_id);
+    if(stream != nullptr) {
+        close_stream(*stream);
+    }
+}
+
+/**
+ * @brief 流结束(响应已全部排入或被重置)，已排队的帧发出后由schedule释放
+ */
+void h2_session::close_stream(h2_stream& stream) {
+    if(stream.done) {
+        return;
+    }
+    stream.done = true;
+    stream.segments.clear();
+    stream.producer = nullptr;
+    --open_streams;
+}
+
+h2_session::h2_stream* h2_session::find_stream(uint32_t stream_id) {
+    auto it = streams.find(stream_id);
+    return it == streams.end() ? nullptr : it->second.get();
+}
+
+h2_session::h2_stream& h2_session::new_stream(uint32_t stream_id) {
+    std::unique_ptr<h2_stream> stream(new h2_stream());
+    stream->id = stream_id;
+    stream->end_received = false;
+    stream->headers_sent = false;
+    stream->done = false;
+    stream->send_window = peer_initial_window;
+    stream->recv_window = STREAM_RECV_WINDOW;
+    stream->file_fd = -1;
+    h2_stream& res = *stream;
+    streams[stream_id] = std::move(stream);
+    ++open_streams;
+    return res;
+}
+
+bool h2_session::strip_padding(uint8_t flags, const uint8_t*& payload, size_t& len) {
+    if(!(flags & FLAG_PADDED)) {
+        return true;
+    }
+    if(len < 1 || payload[0] >= len) {
+        return false;
+    }
+    size_t pad = payload[0];
+    payload += 1;
+    len -= 1 + pad;
+    return true;
+}
+
+void h2_session::append_frame_header(std::string& out, size_t len, uint8_t type, uint8_t flags, uint32_t stream_id) {
+    out.push_back(static_cast<char>(len >> 16));
+    out.push_back(static_cast<char>(len >> 8));
+    out.push_back(static_cast<char>(len));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    append_u32(out, stream_id & 0x7fffffff);
+}
\ No newline at end of file
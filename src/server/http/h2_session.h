@@ -0,0 +1,191 @@
+#ifndef _H2_SESSION_H
+#define _H2_SESSION_H
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+#include "hpack.h"
+#include "http_request.h"
+#include "http_response.h"
+
+struct pending_response;
+
+constexpr char   H2_PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr size_t H2_PREFACE_LEN = sizeof(H2_PREFACE) - 1;
+
+
+/**
+ * @brief 明文HTTP/2(h2c)连接，由http_session在收到连接前言或Upgrade: h2c后创建
+ *  1. 与HTTP/1.1相同的半双工流程: process解析缓冲区中的完整帧，发送队列为空时schedule排入新的帧
+ *  2. 每个流的请求交给与HTTP/1.1相同的http_response处理，响应头转换为HPACK，内容仍然是
+ *     缓存的内存片段或文件窗口，DATA帧经session的sendmsg/sendfile零拷贝发出
+ *  3. 多个流按轮转调度，每轮每个流一帧，受流与连接两级发送窗口限制，窗口耗尽时等待WINDOW_UPDATE
+ *  4. 完成或被重置的流在下一次schedule时(队列已发送完)才释放，保证排队的帧引用的内存与fd有效
+ */
+class h2_session {
+public:
+    enum FRAME_TYPE {
+        FRAME_DATA = 0,
+        FRAME_HEADERS,
+        FRAME_PRIORITY,
+        FRAME_RST_STREAM,
+        FRAME_SETTINGS,
+        FRAME_PUSH_PROMISE,
+        FRAME_PING,
+        FRAME_GOAWAY,
+        FRAME_WINDOW_UPDATE,
+        FRAME_CONTINUATION
+    };
+
+    enum FRAME_FLAG {
+        FLAG_END_STREAM  = 0x1,
+        FLAG_ACK         = 0x1,
+        FLAG_END_HEADERS = 0x4,
+        FLAG_PADDED      = 0x8,
+        FLAG_PRIORITY    = 0x20
+    };
+
+    enum SETTINGS_ID {
+        SETTINGS_HEADER_TABLE_SIZE = 1,
+        SETTINGS_ENABLE_PUSH,
+        SETTINGS_MAX_CONCURRENT_STREAMS,
+        SETTINGS_INITIAL_WINDOW_SIZE,
+        SETTINGS_MAX_FRAME_SIZE,
+        SETTINGS_MAX_HEADER_LIST_SIZE
+    };
+
+    enum ERROR_CODE {
+        H2_NO_ERROR = 0,
+        H2_PROTOCOL_ERROR,
+        H2_INTERNAL_ERROR,
+        H2_FLOW_CONTROL_ERROR,
+        H2_SETTINGS_TIMEOUT,
+        H2_STREAM_CLOSED,
+        H2_FRAME_SIZE_ERROR,
+        H2_REFUSED_STREAM,
+        H2_CANCEL,
+        H2_COMPRESSION_ERROR,
+        H2_CONNECT_ERROR,
+        H2_ENHANCE_YOUR_CALM
+    };
+
+    static const size_t   FRAME_HEADER_LEN = 9;
+    static const uint32_t MAX_FRAME_SIZE = 16384;           // 本端接受的最大帧
+    static const uint32_t MAX_CONCURRENT_STREAMS = 100;
+    static const uint32_t MAX_HEADER_LIST_SIZE = 64 * 1024;
+    static const int32_t  DEFAULT_WINDOW = 65535;
+    static const int32_t  STREAM_RECV_WINDOW = 1 << 20;     // 每个流的请求体不超过MAX_REQUEST_SIZE，无需再更新
+    static const int32_t  CONN_RECV_WINDOW = 16 << 20;
+    static const int      SCHEDULE_FRAMES = 64;             // 一次schedule最多排入的DATA帧
+
+public:
+    h2_session();
+    ~h2_session();
+    h2_session(const h2_session&) = delete;
+    h2_session& operator=(const h2_session&) = delete;
+
+    /**
+     * @brief Upgrade: h2c，升级前的HTTP/1.1请求成为流1
+     * @param settings HTTP2-Settings解码后的SETTINGS负载
+     * @param head     response.build_response()生成的响应头
+     * @return HTTP2-Settings格式错误时返回false，调用方按HTTP/1.1处理
+     */
+    bool start_upgrade(const std::string& settings, const std::string& head, http_response& response);
+
+    /**
+     * @brief 处理data[0, len)中的连接前言与完整帧，used为消费的字节数
+     */
+    void process(const char* data, size_t len, size_t& used);
+
+    /**
+     * @brief 发送队列为空时调用: 释放已结束的流，排入控制帧、响应头与轮转调度的DATA帧
+     * @return 是否排入了新的数据
+     */
+    bool schedule(std::vector<pending_response>& out);
+
+    static bool base64url_decode(const std::string& in, std::string& out);
+
+private:
+    /**
+     * @brief 响应体中的一段: 内存片段或文件窗口
+     */
+    struct body_segment {
+        const char* mem;
+        int    file_fd;
+        off_t  offset;
+        size_t len;
+    };
+
+    struct h2_stream {
+        uint32_t id;
+        bool end_received;              // 请求已完整接收(half-closed remote)
+        bool headers_sent;
+        bool done;                      // 响应已全部排入或流被重置，等待释放
+        int64_t send_window;
+        int32_t recv_window;
+        std::vector<hpack_header> headers;
+        std::string body;
+
+        std::string header_block;       // 待发送的HPACK头部块
+        std::deque<body_segment> segments;
+        std::deque<std::string> storage;        // 内存片段引用的字符串，deque追加时不移动已有元素
+        body_producer producer;
+        static_cache::entry_ptr cached;
+        int file_fd;
+    };
+
+    void handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len);
+    void handle_headers(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len);
+    void handle_continuation(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len);
+    void handle_data(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len);
+    void handle_settings(uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t len);
+    void handle_window_update(uint32_t stream_id, const uint8_t* payload, size_t len);
+    void handle_rst_stream(uint32_t stream_id, size_t len);
+    bool apply_settings(const uint8_t* payload, size_t len);
+    void finish_headers();
+    void dispatch(h2_stream& stream);
+    void attach_response(h2_stream& stream, const std::string& head, http_response& rsp);
+    void refill(h2_stream& stream);
+    bool next_data(h2_stream& stream, std::string& pending, std::vector<pending_response>& out);
+    void connection_error(ERROR_CODE code, const char* reason);
+    void stream_error(uint32_t stream_id, ERROR_CODE code);
+    void close_stream(h2_stream& stream);
+    h2_stream* find_stream(uint32_t stream_id);
+    h2_stream& new_stream(uint32_t stream_id);
+
+    static bool strip_padding(uint8_t flags, const uint8_t*& payload, size_t& len);
+    static void append_frame_header(std::string& out, size_t len, uint8_t type, uint8_t flags, uint32_t stream_id);
+
+private:
+    bool preface_received;
+    bool settings_received;
+    bool goaway_sent;                   // 连接错误，发送完GOAWAY后关闭
+    bool peer_goaway;                   // 对端不再创建新流，现有的流结束后关闭
+    uint32_t last_stream_id;
+
+    int64_t  conn_send_window;
+    int64_t  conn_recv_window;
+    int64_t  conn_recv_consumed;        // 超过接收窗口一半时发送WINDOW_UPDATE
+    int64_t  peer_initial_window;
+    uint32_t peer_max_frame;
+
+    hpack_decoder decoder;
+    std::string control;                // 待发送的控制帧
+    std::string header_block;           // 跨CONTINUATION拼接的头部块
+    std::string head_buf;               // 生成HTTP/1.1格式响应头的缓冲区，复用容量
+    uint32_t block_stream;              // 非0时只能收到该流的CONTINUATION
+    bool     block_end_stream;
+
+    std::unordered_map<uint32_t, std::unique_ptr<h2_stream>> streams;
+    std::vector<h2_stream*> active;     // 有响应待发送的流，按轮转顺序
+    size_t open_streams;
+
+    http_request  request;
+    http_response response;
+};
+
+#endif
\ No newline at end of file
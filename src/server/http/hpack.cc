@@ -0,0 +1,445 @@
+#include <cstring>
+#include <unordered_map>
+
+#include "hpack.h"
+
+namespace {
+
+const hpack_header STATIC_TABLE[hpack::STATIC_TABLE_SIZE] = {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+
+/* RFC 7541 附录B，下标为字节值，EOS(256)单独处理 */
+const uint32_t HUFFMAN_CODES[256] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+};
+
+const uint8_t HUFFMAN_CODE_LEN[256] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+};
+
+const uint32_t HUFFMAN_EOS = 0x3fffffff;
+const int HUFFMAN_EOS_LEN = 30;
+
+/**
+ * @brief Huffman解码树，首次使用时由码表构造；叶子的symbol为字节值或EOS(256)
+ */
+struct huffman_tree {
+    struct node {
+        int16_t child[2];
+        int16_t symbol;
+    };
+
+    node nodes[513];
+    int count;
+
+    huffman_tree(): count(1) {
+        nodes[0] = node{ { -1, -1 }, -1 };
+        for(int sym = 0; sym < 256; ++sym) {
+            add(HUFFMAN_CODES[sym], HUFFMAN_CODE_LEN[sym], sym);
+        }
+        add(HUFFMAN_EOS, HUFFMAN_EOS_LEN, 256);
+    }
+
+    void add(uint32_t code, int len, int sym) {
+        int cur = 0;
+        for(int i = len - 1; i >= 0; --i) {
+            int bit = (code >> i) & 1;
+            if(nodes[cur].child[bit] < 0) {
+                nodes[count] = node{ { -1, -1 }, -1 };
+                nodes[cur].child[bit] = static_cast<int16_t>(count++);
+            }
+            cur = nodes[cur].child[bit];
+        }
+        nodes[cur].symbol = static_cast<int16_t>(sym);
+    }
+};
+
+const huffman_tree& tree() {
+    static const huffman_tree instance;
+    return instance;
+}
+
+/**
+ * @brief 字符串字面量: H位 + 7位前缀长度 + 内容
+ */
+size_t decode_string(const uint8_t* data, size_t len, std::string& out) {
+    if(len == 0) {
+        return 0;
+    }
+    bool huffman = (data[0] & 0x80) != 0;
+    uint64_t str_len = 0;
+    size_t n = hpack::decode_integer(data, len, 7, str_len);
+    if(n == 0 || str_len > len - n) {
+        return 0;
+    }
+    out.clear();
+    if(huffman) {
+        if(!hpack::huffman_decode(data + n, str_len, out)) {
+            return 0;
+        }
+    } else {
+        out.assign(reinterpret_cast<const char*>(data + n), str_len);
+    }
+    return n + str_len;
+}
+
+}
+
+
+/**
+ * hpack
+ */
+
+void hpack::encode_integer(uint64_t value, int prefix_bits, uint8_t first_byte, std::string& out) {
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if(value < max_prefix) {
+        out.push_back(static_cast<char>(first_byte | value));
+        return;
+    }
+    out.push_back(static_cast<char>(first_byte | max_prefix));
+    value -= max_prefix;
+    while(value >= 128) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+size_t hpack::decode_integer(const uint8_t* data, size_t len, int prefix_bits, uint64_t& value) {
+    if(len == 0) {
+        return 0;
+    }
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    value = data[0] & max_prefix;
+    if(value < max_prefix) {
+        return 1;
+    }
+    /* 后续字节每个7位，最多接受28位，足够表示任何合法长度和索引 */
+    for(size_t i = 1, shift = 0; i < len && shift <= 21; ++i, shift += 7) {
+        value += static_cast<uint64_t>(data[i] & 0x7f) << shift;
+        if((data[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+void hpack::huffman_encode(const std::string& in, std::string& out) {
+    uint64_t bits = 0;
+    int bit_len = 0;
+    for(unsigned char c: in) {
+        bits = (bits << HUFFMAN_CODE_LEN[c]) | HUFFMAN_CODES[c];
+        bit_len += HUFFMAN_CODE_LEN[c];
+        while(bit_len >= 8) {
+            bit_len -= 8;
+            out.push_back(static_cast<char>(bits >> bit_len));
+        }
+    }
+    if(bit_len > 0) {
+        /* 用EOS的高位(全1)补齐最后一个字节 */
+        out.push_back(static_cast<char>((bits << (8 - bit_len)) | (0xff >> bit_len)));
+    }
+}
+
+bool hpack::huffman_decode(const uint8_t* data, size_t len, std::string& out) {
+    const huffman_tree& t = tree();
+    int cur = 0;
+    int pad_bits = 0;           // 最后一个符号之后的位数，结尾时只能是不超过7位的全1
+    bool pad_ones = true;
+    for(size_t i = 0; i < len; ++i) {
+        for(int b = 7; b >= 0; --b) {
+            int bit = (data[i] >> b) & 1;
+            cur = t.nodes[cur].child[bit];
+            if(cur < 0) {
+                return false;
+            }
+            ++pad_bits;
+            pad_ones = pad_ones && bit == 1;
+            int16_t sym = t.nodes[cur].symbol;
+            if(sym >= 0) {
+                if(sym == 256) {
+                    return false;
+                }
+                out.push_back(static_cast<char>(sym));
+                cur = 0;
+                pad_bits = 0;
+                pad_ones = true;
+            }
+        }
+    }
+    return pad_bits <= 7 && pad_ones;
+}
+
+const hpack_header* hpack::static_entry(size_t index) {
+    return index >= 1 && index <= STATIC_TABLE_SIZE ? &STATIC_TABLE[index - 1] : nullptr;
+}
+
+int hpack::static_name_index(const std::string& name) {
+    static const std::unordered_map<std::string, int> index = []() {
+        std::unordered_map<std::string, int> res;
+        for(size_t i = STATIC_TABLE_SIZE; i >= 1; --i) {
+            res[STATIC_TABLE[i - 1].name] = static_cast<int>(i);
+        }
+        return res;
+    }();
+    auto it = index.find(name);
+    return it == index.end() ? 0 : it->second;
+}
+
+
+/**
+ * hpack_decoder
+ */
+
+hpack_decoder::hpack_decoder(size_t max_table_size, size_t max_list_size):
+    size(0), max_size(max_table_size), settings_max(max_table_size), max_list(max_list_size) {}
+
+bool hpack_decoder::decode(const uint8_t* data, size_t len, std::vector<hpack_header>& headers) {
+    size_t pos = 0;
+    size_t list_size = 0;
+    bool block_start = true;
+    std::string name;
+    std::string value;
+    while(pos < len) {
+        uint8_t b = data[pos];
+        uint64_t index = 0;
+        size_t n = 0;
+        if(b & 0x80) {
+            /* 索引表示 */
+            n = hpack::decode_integer(data + pos, len - pos, 7, index);
+            const hpack_header* header = nullptr;
+            if(n == 0 || !lookup(index, header)) {
+                return false;
+            }
+            pos += n;
+            list_size += header->name.size() + header->value.size() + 32;
+            if(list_size > max_list) {
+                return false;
+            }
+            headers.push_back(*header);
+            block_start = false;
+            continue;
+        }
+        if((b & 0xe0) == 0x20) {
+            /* 动态表大小更新，只能出现在头部块开头 */
+            n = hpack::decode_integer(data + pos, len - pos, 5, index);
+            if(n == 0 || !block_start || index > settings_max) {
+                return false;
+            }
+            max_size = index;
+            evict(max_size);
+            pos += n;
+            continue;
+        }
+
+        /* 字面量: 01 加入索引(6位前缀)，0000 不加入索引 / 0001 永不索引(4位前缀) */
+        bool incremental = (b & 0xc0) == 0x40;
+        n = hpack::decode_integer(data + pos, len - pos, incremental ? 6 : 4, index);
+        if(n == 0) {
+            return false;
+        }
+        pos += n;
+        if(index == 0) {
+            n = decode_string(data + pos, len - pos, name);
+            if(n == 0) {
+                return false;
+            }
+            pos += n;
+        } else {
+            const hpack_header* header = nullptr;
+            if(!lookup(index, header)) {
+                return false;
+            }
+            name = header->name;
+        }
+        n = decode_string(data + pos, len - pos, value);
+        if(n == 0) {
+            return false;
+        }
+        pos += n;
+        list_size += name.size() + value.size() + 32;
+        if(list_size > max_list) {
+            return false;
+        }
+        if(incremental) {
+            insert(name, value);
+        }
+        headers.push_back(hpack_header{ name, value });
+        block_start = false;
+    }
+    return true;
+}
+
+bool hpack_decoder::lookup(uint64_t index, const hpack_header*& header) const {
+    if(index >= 1 && index <= hpack::STATIC_TABLE_SIZE) {
+        header = hpack::static_entry(index);
+        return true;
+    }
+    index -= hpack::STATIC_TABLE_SIZE + 1;
+    if(index >= dynamic_table.size()) {
+        return false;
+    }
+    header = &dynamic_table[index];
+    return true;
+}
+
+void hpack_decoder::insert(const std::string& name, const std::string& value) {
+    size_t entry_size = name.size() + value.size() + 32;
+    /* 条目比整个表大时清空表，条目本身不加入 */
+    evict(entry_size <= max_size ? max_size - entry_size : 0);
+    if(entry_size <= max_size) {
+        dynamic_table.push_front(hpack_header{ name, value });
+        size += entry_size;
+    }
+}
+
+void hpack_decoder::evict(size_t limit) {
+    while(size > limit && !dynamic_table.empty()) {
+        const hpack_header& oldest = dynamic_table.back();
+        size -= oldest.name.size() + oldest.value.size() + 32;
+        dynamic_table.pop_back();
+    }
+}
+
+
+/**
+ * hpack_encoder
+ */
+
+void hpack_encoder::encode_status(int code, std::string& out) {
+    /* 静态表8~14: 200 204 206 304 400 404 500 */
+    int index = 0;
+    switch(code) {
+        case 200: index = 8; break;
+        case 204: index = 9; break;
+        case 206: index = 10; break;
+        case 304: index = 11; break;
+        case 400: index = 12; break;
+        case 404: index = 13; break;
+        case 500: index = 14; break;
+        default: break;
+    }
+    if(index != 0) {
+        out.push_back(static_cast<char>(0x80 | index));
+        return;
+    }
+    encode_header(":status", std::to_string(code), out);
+}
+
+void hpack_encoder::encode_header(const std::string& name, const std::string& value, std::string& out) {
+    int index = hpack::static_name_index(name);
+    hpack::encode_integer(index, 4, 0x00, out);
+    if(index == 0) {
+        hpack::encode_integer(name.size(), 7, 0x00, out);
+        out += name;
+    }
+    hpack::encode_integer(value.size(), 7, 0x00, out);
+    out += value;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef _HPACK_H
+#define _HPACK_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+struct hpack_header {
+    std::string name;
+    std::string value;
+};
+
+
+/**
+ * @brief HPACK(RFC 7541)头部块解码器，每个HTTP/2连接一个，动态表随连接保存
+ *  1. 支持全部表示方式与Huffman编码的字符串
+ *  2. 静态表条目直接引用常量表，动态表按插入顺序放在deque中
+ *  3. 解码出的头部列表超过max_list_size时视为错误，防止头部炸弹
+ */
+class hpack_decoder {
+public:
+    static const size_t DEFAULT_TABLE_SIZE = 4096;
+
+public:
+    explicit hpack_decoder(size_t max_table_size = DEFAULT_TABLE_SIZE, size_t max_list_size = 64 * 1024);
+
+    /**
+     * @brief 解码一个完整的头部块(HEADERS + CONTINUATION)，追加到headers
+     * @return 格式错误时返回false，连接应以COMPRESSION_ERROR关闭
+     */
+    bool decode(const uint8_t* data, size_t len, std::vector<hpack_header>& headers);
+
+    size_t table_size() const { return size; }
+
+private:
+    bool lookup(uint64_t index, const hpack_header*& header) const;
+    void insert(const std::string& name, const std::string& value);
+    void evict(size_t limit);
+
+private:
+    std::deque<hpack_header> dynamic_table;    // 头部为最新插入的条目(索引62)
+    size_t size;
+    size_t max_size;           // 编码端通过大小更新指令设置的当前上限
+    size_t settings_max;       // SETTINGS_HEADER_TABLE_SIZE，大小更新不能超过它
+    size_t max_list;
+};
+
+
+/**
+ * @brief 响应头的HPACK编码，不使用动态表，因此没有需要同步的状态
+ *  1. 常见状态码直接输出静态表索引，其余状态码与头部名称使用静态表中的名称索引
+ *  2. 值以不加入索引的字面量输出，不做Huffman编码
+ */
+class hpack_encoder {
+public:
+    static void encode_status(int code, std::string& out);
+    /**
+     * @param name 必须为小写
+     */
+    static void encode_header(const std::string& name, const std::string& value, std::string& out);
+};
+
+
+/**
+ * @brief HPACK基本元素，供编解码器与测试使用
+ */
+class hpack {
+public:
+    static void encode_integer(uint64_t value, int prefix_bits, uint8_t first_byte, std::string& out);
+    /**
+     * @return 读取的字节数，数据不完整或溢出时返回0
+     */
+    static size_t decode_integer(const uint8_t* data, size_t len, int prefix_bits, uint64_t& value);
+
+    static void huffman_encode(const std::string& in, std::string& out);
+    static bool huffman_decode(const uint8_t* data, size_t len, std::string& out);
+
+    /**
+     * @brief 静态表(索引1~61)
+     */
+    static const hpack_header* static_entry(size_t index);
+    static const size_t STATIC_TABLE_SIZE = 61;
+
+    /**
+     * @brief 静态表中name对应的第一个索引，没有时返回0
+     */
+    static int static_name_index(const std::string& name);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <cstring>
+
+#include "http_chunked.h"
+
+
+void chunked_decoder::reset() {
+    state = STATE_SIZE;
+    chunk_remain = 0;
+}
+
+chunked_decoder::DECODE_RESULT chunked_decoder::decode(const char* data, size_t len, size_t& consumed,
+                                                       std::string& body) {
+    const char* p = data;
+    const char* end = data + len;
+    while(state != STATE_DONE) {
+        if(state == STATE_DATA) {
+            size_t n = static_cast<size_t>(end - p) < chunk_remain ? end - p : chunk_remain;
+            body.append(p, n);
+            p += n;
+            chunk_remain -= n;
+            if(chunk_remain > 0) {
+                break;
+            }
+            state = STATE_DATA_END;
+            continue;
+        }
+        if(state == STATE_DATA_END) {
+            if(end - p < 2) {
+                break;
+            }
+            if(p[0] != '\r' || p[1] != '\n') {
+                return DECODE_ERROR;
+            }
+            p += 2;
+            state = STATE_SIZE;
+            continue;
+        }
+
+        /* 长度行与trailer行: 等到整行到达后再处理 */
+        const char* lf = static_cast<const char*>(memchr(p, '\n', end - p));
+        if(lf == nullptr) {
+            if(static_cast<size_t>(end - p) > MAX_LINE) {
+                return DECODE_ERROR;
+            }
+            break;
+        }
+        if(lf == p || lf[-1] != '\r' || static_cast<size_t>(lf - p) > MAX_LINE) {
+            return DECODE_ERROR;
+        }
+        size_t line_len = lf - 1 - p;
+        if(state == STATE_SIZE) {
+            if(!parse_size(p, line_len, chunk_remain)) {
+                return DECODE_ERROR;
+            }
+            state = chunk_remain == 0 ? STATE_TRAILER : STATE_DATA;
+        } else if(line_len == 0) {
+            state = STATE_DONE;
+        }
+        p = lf + 1;
+    }
+    consumed += p - data;
+    return state == STATE_DONE ? DECODE_DONE : DECODE_AGAIN;
+}
+
+/**
+ * @brief chunk-size [ BWS ";" chunk-ext ]
+ */
+bool chunked_decoder::parse_size(const char* line, size_t len, size_t& size) {
+    size = 0;
+    size_t i = 0;
+    for(; i < len; ++i) {
+        char c = line[i];
+        int digit;
+        if(c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if(c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if(c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            break;
+        }
+        if(i >= 15) {
+            return false;
+        }
+        size = size * 16 + digit;
+    }
+    if(i == 0) {
+        return false;
+    }
+    while(i < len && (line[i] == ' ' || line[i] == '\t')) {
+        ++i;
+    }
+    return i == len || line[i] == ';';
+}
+
+
+void chunked_encoder::append_chunk(std::string& out, const char* data, size_t len) {
+    if(len == 0) {
+        return;
+    }
+    char size[20];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", len);
+    out.append(size, n);
+    out.append(data, len);
+    out.append("\r\n", 2);
+}
+
+void chunked_encoder::append_last(std::string& out) {
+    out.append("0\r\n\r\n", 5);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef _HTTP_CHUNKED_H
+#define _HTTP_CHUNKED_H
+
+#include <string>
+#include <cstddef>
+
+
+/**
+ * @brief Transfer-Encoding: chunked请求体的流式解码器
+ *  1. 有状态: 数据不完整时返回DECODE_AGAIN，之后从上次停下的位置继续，已解码的内容不再重复处理
+ *  2. 忽略chunk扩展(";name=value")与trailer字段
+ *  3. chunk长度行/trailer行超过MAX_LINE、长度超过15位十六进制时视为错误
+ */
+class chunked_decoder {
+public:
+    enum DECODE_RESULT {
+        DECODE_DONE = 0,
+        DECODE_AGAIN,
+        DECODE_ERROR
+    };
+
+    static const size_t MAX_LINE = 4096;
+
+public:
+    chunked_decoder() { reset(); }
+
+    void reset();
+
+    /**
+     * @brief 解码data[0, len)，data为上次调用未消费数据的开头
+     * @param consumed 累加本次消费的字节数
+     * @param body     追加解码出的内容
+     */
+    DECODE_RESULT decode(const char* data, size_t len, size_t& consumed, std::string& body);
+
+private:
+    enum STATE {
+        STATE_SIZE = 0,         // chunk长度行
+        STATE_DATA,             // chunk内容
+        STATE_DATA_END,         // chunk内容后的CRLF
+        STATE_TRAILER,          // last-chunk之后的trailer，以空行结束
+        STATE_DONE
+    };
+
+    static bool parse_size(const char* line, size_t len, size_t& size);
+
+private:
+    STATE  state;
+    size_t chunk_remain;
+};
+
+
+/**
+ * @brief 以chunked编码输出增量生成的响应体
+ */
+class chunked_encoder {
+public:
+    /**
+     * @brief 追加一个chunk: 十六进制长度 CRLF 内容 CRLF，空内容不输出(避免被当作结束)
+     */
+    static void append_chunk(std::string& out, const char* data, size_t len);
+
+    /**
+     * @brief 追加结束标记last-chunk(不带trailer)
+     */
+    static void append_last(std::string& out);
+};
+
+#endif
\ No newline at end of file
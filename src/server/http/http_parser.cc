@@ -0,0 +1,304 @@
+#include <cstring>
+#include <strings.h>
+
+#include "http_parser.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTTP_PARSER_X86 1
+#endif
+
+namespace {
+
+typedef const char* (*find_char_fn)(const char*, const char*, char);
+
+const char* find_char_scalar(const char* p, const char* end, char c) {
+    for(; p < end; ++p) {
+        if(*p == c) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef HTTP_PARSER_X86
+__attribute__((target("sse4.2")))
+const char* find_char_sse42(const char* p, const char* end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    while(end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int idx = _mm_cmpestri(needle, 1, chunk, 16,
+                               _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+        if(idx < 16) {
+            return p + idx;
+        }
+        p += 16;
+    }
+    return find_char_scalar(p, end, c);
+}
+
+__attribute__((target("avx2")))
+const char* find_char_avx2(const char* p, const char* end, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    while(end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if(mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    /* 不足32字节的尾部交给SSE4.2处理 */
+    return find_char_sse42(p, end, c);
+}
+#endif
+
+http_parser::SIMD_LEVEL detect_simd_level() {
+#ifdef HTTP_PARSER_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return http_parser::SIMD_AVX2;
+    }
+    if(__builtin_cpu_supports("sse4.2")) {
+        return http_parser::SIMD_SSE42;
+    }
+#endif
+    return http_parser::SIMD_SCALAR;
+}
+
+find_char_fn select_find_char(http_parser::SIMD_LEVEL level) {
+    switch(level) {
+#ifdef HTTP_PARSER_X86
+        case http_parser::SIMD_AVX2:
+            return find_char_avx2;
+        case http_parser::SIMD_SSE42:
+            return find_char_sse42;
+#endif
+        default:
+            return find_char_scalar;
+    }
+}
+
+const http_parser::SIMD_LEVEL g_cpu_level = detect_simd_level();
+http_parser::SIMD_LEVEL g_level = g_cpu_level;
+find_char_fn g_find_char = select_find_char(g_cpu_level);
+
+inline bool is_ows(char c) {
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * @brief RFC 9110 tchar: 请求头名只能由这些字符组成
+ */
+struct tchar_table {
+    bool valid[256];
+
+    tchar_table() {
+        memset(valid, 0, sizeof(valid));
+        for(int c = '0'; c <= '9'; ++c) {
+            valid[c] = true;
+        }
+        for(int c = 'a'; c <= 'z'; ++c) {
+            valid[c] = true;
+            valid[c - 'a' + 'A'] = true;
+        }
+        for(const char* p = "!#$%&'*+-.^_`|~"; *p; ++p) {
+            valid[static_cast<unsigned char>(*p)] = true;
+        }
+    }
+};
+
+const tchar_table g_tchar;
+
+/**
+ * @brief 请求头名非空且全部为tchar；冒号前的空白、控制字符都会被拒绝，
+ *  否则"Transfer-Encoding : chunked"这类请求头会与前端代理的理解不一致(请求走私)
+ */
+inline bool valid_header_name(const char* p, const char* end) {
+    if(p == end) {
+        return false;
+    }
+    for(; p < end; ++p) {
+        if(!g_tchar.valid[static_cast<unsigned char>(*p)]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 查找以"\r\n"结尾的行，返回'\r'的位置
+ *  nullptr且again为true: 数据不完整
+ *  nullptr且again为false: '\r'后不是'\n'，格式错误
+ */
+inline const char* find_line_end(const char* p, const char* end, bool& again) {
+    const char* cr = g_find_char(p, end, '\r');
+    if(cr == nullptr || cr + 1 >= end) {
+        again = true;
+        return nullptr;
+    }
+    again = false;
+    return cr[1] == '\n' ? cr : nullptr;
+}
+
+}
+
+
+http_parser::PARSE_RESULT http_parser::parse_request(const char* buf, size_t len,
+                                                     http_request_head& head, size_t& consumed) {
+    const char* p = buf;
+    const char* end = buf + len;
+    bool again = false;
+    head.header_num = 0;
+
+    /* 请求行: METHOD SP PATH SP HTTP/VERSION CRLF */
+    const char* line_end = find_line_end(p, end, again);
+    if(line_end == nullptr) {
+        return again ? PARSE_AGAIN : PARSE_ERROR;
+    }
+    const char* sp1 = g_find_char(p, line_end, ' ');
+    if(sp1 == nullptr || sp1 == p) {
+        return PARSE_ERROR;
+    }
+    const char* sp2 = g_find_char(sp1 + 1, line_end, ' ');
+    if(sp2 == nullptr || sp2 == sp1 + 1) {
+        return PARSE_ERROR;
+    }
+    const char* ver = sp2 + 1;
+    if(line_end - ver < 5 || memcmp(ver, "HTTP/", 5) != 0 || g_find_char(ver, line_end, ' ') != nullptr) {
+        return PARSE_ERROR;
+    }
+    head.method.data = p;
+    head.method.len = sp1 - p;
+    head.path.data = sp1 + 1;
+    head.path.len = sp2 - sp1 - 1;
+    head.version.data = ver + 5;
+    head.version.len = line_end - ver - 5;
+    p = line_end + 2;
+
+    /* 请求头: NAME ":" OWS VALUE OWS CRLF，以空行结束 */
+    while(true) {
+        if(end - p < 2) {
+            return PARSE_AGAIN;
+        }
+        if(p[0] == '\r') {
+            if(p[1] != '\n') {
+                return PARSE_ERROR;
+            }
+            consumed = p + 2 - buf;
+            return PARSE_OK;
+        }
+        /* 不支持obs-fold(以空白开头的续行) */
+        if(is_ows(p[0])) {
+            return PARSE_ERROR;
+        }
+        line_end = find_line_end(p, end, again);
+        if(line_end == nullptr) {
+            return again ? PARSE_AGAIN : PARSE_ERROR;
+        }
+        const char* colon = g_find_char(p, line_end, ':');
+        if(colon == nullptr || !valid_header_name(p, colon) || head.header_num >= http_request_head::MAX_HEADERS) {
+            return PARSE_ERROR;
+        }
+        const char* value = colon + 1;
+        const char* value_end = line_end;
+        while(value < value_end && is_ows(*value)) {
+            ++value;
+        }
+        while(value_end > value && is_ows(value_end[-1])) {
+            --value_end;
+        }
+        http_header_slice& header = head.headers[head.header_num++];
+        header.name.data = p;
+        header.name.len = colon - p;
+        header.value.data = value;
+        header.value.len = value_end - value;
+        p = line_end + 2;
+    }
+}
+
+bool http_parser::content_length(const http_request_head& head, size_t& len) {
+    bool found = false;
+    len = 0;
+    for(size_t i = 0; i < head.header_num; ++i) {
+        const http_header_slice& header = head.headers[i];
+        if(header.name.len != 14 || strncasecmp(header.name.data, "Content-Length", 14) != 0) {
+            continue;
+        }
+        if(header.value.len == 0 || header.value.len > 18) {
+            return false;
+        }
+        size_t value = 0;
+        for(size_t j = 0; j < header.value.len; ++j) {
+            char c = header.value.data[j];
+            if(c < '0' || c > '9') {
+                return false;
+            }
+            value = value * 10 + (c - '0');
+        }
+        if(found && value != len) {
+            return false;
+        }
+        found = true;
+        len = value;
+    }
+    return true;
+}
+
+bool http_parser::transfer_chunked(const http_request_head& head, bool& chunked) {
+    chunked = false;
+    bool has_length = false;
+    for(size_t i = 0; i < head.header_num; ++i) {
+        const http_header_slice& header = head.headers[i];
+        if(header.name.len == 14 && strncasecmp(header.name.data, "Content-Length", 14) == 0) {
+            has_length = true;
+            continue;
+        }
+        if(header.name.len != 17 || strncasecmp(header.name.data, "Transfer-Encoding", 17) != 0) {
+            continue;
+        }
+        /* HTTP/1.0没有Transfer-Encoding，收到时无法确定body边界(RFC 9112 6.1) */
+        if(!head.version.equals("1.1", 3)) {
+            return false;
+        }
+        /* 逗号分隔的编码列表，多个请求头依次拼接；只支持恰好一个chunked */
+        const char* p = header.value.data;
+        const char* end = p + header.value.len;
+        while(p < end) {
+            const char* comma = g_find_char(p, end, ',');
+            const char* item_end = comma ? comma : end;
+            while(p < item_end && is_ows(*p)) {
+                ++p;
+            }
+            const char* e = item_end;
+            while(e > p && is_ows(e[-1])) {
+                --e;
+            }
+            if(e > p) {
+                if(chunked || e - p != 7 || strncasecmp(p, "chunked", 7) != 0) {
+                    return false;
+                }
+                chunked = true;
+            }
+            p = comma ? comma + 1 : end;
+        }
+    }
+    return !(chunked && has_length);
+}
+
+const char* http_parser::find_char(const char* begin, const char* end, char c) {
+    return g_find_char(begin, end, c);
+}
+
+http_parser::SIMD_LEVEL http_parser::simd_level() {
+    return g_level;
+}
+
+http_parser::SIMD_LEVEL http_parser::set_simd_level(SIMD_LEVEL level) {
+    if(level > g_cpu_level) {
+        level = g_cpu_level;
+    }
+    g_level = level;
+    g_find_char = select_find_char(level);
+    return g_level;
+}
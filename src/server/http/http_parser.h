@@ -0,0 +1,105 @@
+#ifndef _HTTP_PARSER_H
+#define _HTTP_PARSER_H
+
+#include <string>
+#include <cstddef>
+
+/**
+ * @brief 指向读缓冲区的只读片段，不拷贝数据
+ */
+struct http_slice {
+    const char* data;
+    size_t len;
+
+    std::string to_string() const {
+        return std::string(data, len);
+    }
+
+    bool equals(const char* s, size_t n) const {
+        return len == n && std::char_traits<char>::compare(data, s, n) == 0;
+    }
+
+    bool empty() const {
+        return len == 0;
+    }
+
+    static http_slice of(const std::string& s) {
+        http_slice res = { s.data(), s.size() };
+        return res;
+    }
+};
+
+struct http_header_slice {
+    http_slice name;
+    http_slice value;
+};
+
+
+/**
+ * @brief 请求行 + 请求头的解析结果，所有片段均指向调用方的缓冲区
+ */
+struct http_request_head {
+    static const size_t MAX_HEADERS = 64;
+
+    http_slice method;
+    http_slice path;
+    http_slice version;          // "HTTP/"之后的部分，如 "1.1"
+    http_header_slice headers[MAX_HEADERS];
+    size_t header_num;
+};
+
+
+/**
+ * @brief 手写HTTP/1.1请求解析器，替代逐行构造std::regex的解析方式
+ *  1. 使用AVX2(32B)/SSE4.2(16B)扫描'\r'、' '、':'，不支持时退化为逐字节扫描
+ *  2. 指令集在运行期通过cpuid选择，无需修改编译参数
+ *  3. 解析是无状态的: 数据不完整时返回PARSE_AGAIN，收到更多数据后从头重新解析
+ */
+class http_parser {
+public:
+    enum PARSE_RESULT {
+        PARSE_OK = 0,
+        PARSE_AGAIN,
+        PARSE_ERROR
+    };
+
+    enum SIMD_LEVEL {
+        SIMD_SCALAR = 0,
+        SIMD_SSE42,
+        SIMD_AVX2
+    };
+
+public:
+    /**
+     * @brief 解析buf[0, len)中的请求行和请求头
+     * @param consumed 成功时为请求头(含结尾空行)的字节数，body从buf + consumed开始
+     */
+    static PARSE_RESULT parse_request(const char* buf, size_t len, http_request_head& head, size_t& consumed);
+
+    /**
+     * @brief 取Content-Length，没有该请求头时为0
+     * @return 值不是十进制数字、溢出或多个值不一致时返回false
+     */
+    static bool content_length(const http_request_head& head, size_t& len);
+
+    /**
+     * @brief 判断请求体是否为chunked编码，没有Transfer-Encoding时chunked为false
+     * @return 含有chunked以外的编码、HTTP/1.0请求带有Transfer-Encoding，
+     *  或同时带有Content-Length(请求走私)时返回false
+     */
+    static bool transfer_chunked(const http_request_head& head, bool& chunked);
+
+    /**
+     * @brief 在[begin, end)中查找字符c，找不到返回nullptr
+     */
+    static const char* find_char(const char* begin, const char* end, char c);
+
+    static SIMD_LEVEL simd_level();
+
+    /**
+     * @brief 强制使用指定指令集(不能超过cpu支持的级别)，用于测试与benchmark
+     */
+    static SIMD_LEVEL set_simd_level(SIMD_LEVEL level);
+};
+
+#endif
\ No newline at end of file
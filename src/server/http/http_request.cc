@@ -1,45 +1,95 @@
 #include <sstream>
+#include <cstdlib>
+#include <strings.h>
 
 #include "http_request.h"
+#include "http_tables.h"
 #include "../../utils/local_cache.h"
 
-const std::unordered_map<std::string, int> http_request::DEFAULT_HTML_TAG {
-            {"/register.html", 0}, {"/login.html", 1}};
+namespace {
 
-const std::unordered_set<std::string> http_request::DEFAULT_HTML{
-            "/index", "/register", "/login","/welcome", "/video", "/picture"};
+const http_slice EMPTY_SLICE = { "", 0 };
 
+inline bool is_ows(char c) {
+    return c == ' ' || c == '\t';
+}
 
-void http_request::set_request_line(std::string method, std::string path, std::string version) {
-    if(method == "GET") {
+/**
+ * @brief 依次回调逗号分隔列表中的每一项(去掉两端空白，跳过空项)，回调返回false时停止
+ */
+template<typename Fn>
+void for_each_item(http_slice value, Fn fn) {
+    const char* p = value.data;
+    const char* end = p + value.len;
+    while(p < end) {
+        const char* comma = http_parser::find_char(p, end, ',');
+        const char* item_end = comma ? comma : end;
+        const char* b = p;
+        while(b < item_end && is_ows(*b)) {
+            ++b;
+        }
+        const char* e = item_end;
+        while(e > b && is_ows(e[-1])) {
+            --e;
+        }
+        if(b < e && !fn(b, e)) {
+            return;
+        }
+        p = comma ? comma + 1 : end;
+    }
+}
+
+inline bool token_equals(const char* b, const char* e, const char* token, size_t len) {
+    return static_cast<size_t>(e - b) == len && strncasecmp(b, token, len) == 0;
+}
+
+}
+
+
+void http_request::set_request_line(http_slice method, http_slice path, http_slice version) {
+    if(method.equals("GET", 3)) {
         req_method = GET;
-    } else if(method == "POST") {
+    } else if(method.equals("POST", 4)) {
         req_method = POST;
     }
     req_version = version;
-    req_path = path;
-    if(path == "/") {
-        req_path = "/index.html"; 
+    /* assign复用上一个请求的容量 */
+    const auto* route = http_tables::ROUTES.find(http_tables::str_view{path.data, path.len});
+    if(route) {
+        req_path.assign(route->value.data, route->value.len);
     } else {
-        for(auto &item: DEFAULT_HTML) {
-            if(item == path) {
-                req_path += ".html";
-                break;
-            }
-        }
+        req_path.assign(path.data, path.len);
     }
 }
 
-void http_request::set_requset_header(std::string key, std::string value) {
-    req_header[key] = value;
+std::string http_request::resource_path(const char* path, size_t len) {
+    const auto* route = http_tables::ROUTES.find(http_tables::str_view{path, len});
+    return route ? route->value.to_string() : std::string(path, len);
+}
+
+void http_request::set_requset_header(http_slice key, http_slice value) {
+    /* Range/条件请求头在每个请求都要检查，解析时单独保存，避免未携带时逐个比较请求头 */
+    if(key.len == 5 && strncasecmp(key.data, "Range", 5) == 0) {
+        req_range = value;
+    } else if(key.len == 8 && strncasecmp(key.data, "If-Range", 8) == 0) {
+        req_if_range = value;
+    } else if(key.len == 13 && strncasecmp(key.data, "If-None-Match", 13) == 0) {
+        req_if_none_match = value;
+    } else if(key.len == 17 && strncasecmp(key.data, "If-Modified-Since", 17) == 0) {
+        req_if_modified_since = value;
+    }
+    http_header_slice header = { key, value };
+    req_header.push_back(header);
 }
 
 void http_request::set_request_body(std::string body) {
-    req_body = body;
-    if(req_method == POST && req_header["Content-Type"] == "application/x-www-form-urlencoded") {
+    req_body = std::move(body);
+    /* HTTP/2的请求头名称为小写 */
+    if(req_method == POST && get_header("Content-Type").equals("application/x-www-form-urlencoded", 33)) {
         parse_from_urlencoded();
-        if(DEFAULT_HTML_TAG.count(req_path)) {
-            int tag = DEFAULT_HTML_TAG.find(req_path)->second;
+        const auto* form = http_tables::FORMS.find(http_tables::str_view{req_path.data(), req_path.size()});
+        if(form) {
+            int tag = form->value;
             LOG_DEBUG("Tag:%d", tag);
             if(tag == 0 || tag == 1) {
                 bool isLogin = (tag == 1);
@@ -53,25 +103,139 @@ void http_request::set_request_body(std::string body) {
     }  
 }
 
-std::string http_request::get_path() const {
+const std::string& http_request::get_path() const {
     return req_path;
 }
 
+/**
+ * @brief HTTP/1.1默认为持久连接，Connection中含有close时关闭；HTTP/1.0需要显式的keep-alive
+ */
 bool http_request::get_keepalive() const {
-    if(req_header.count("Connection") == 1) {
-        return req_header.find("Connection")->second == "keep-alive" && req_version == "1.1";
+    const http_slice* value = find_header("Connection");
+    bool http11 = req_version.equals("1.1", 3);
+    if(value == nullptr) {
+        return http11;
     }
-    return false;
+    bool close = false;
+    bool keepalive = false;
+    for_each_item(*value, [&](const char* b, const char* e) {
+        if(token_equals(b, e, "close", 5)) {
+            close = true;
+            return false;
+        }
+        if(token_equals(b, e, "keep-alive", 10)) {
+            keepalive = true;
+        }
+        return true;
+    });
+    return !close && (http11 || (keepalive && req_version.equals("1.0", 3)));
+}
+
+http_slice http_request::get_version() const {
+    return req_version;
 }
 
 http_request::HTTP_METHOD http_request::get_method() const {
     return req_method;
 }
 
+void http_request::reset() {
+    req_method = GET;
+    req_path.clear();
+    req_version = EMPTY_SLICE;
+    req_header.clear();
+    req_post.clear();
+    req_body.clear();
+    req_range = EMPTY_SLICE;
+    req_if_range = EMPTY_SLICE;
+    req_if_none_match = EMPTY_SLICE;
+    req_if_modified_since = EMPTY_SLICE;
+}
+
+/**
+ * @brief 按Accept-Encoding判断客户端是否接受gzip
+ * 逗号分隔的coding[;q=x]，gzip/x-gzip或*且q不为0时接受
+ */
+bool http_request::accept_gzip() const {
+    const http_slice* value = find_header("Accept-Encoding");
+    if(value == nullptr) {
+        return false;
+    }
+    bool accept = false;
+    for_each_item(*value, [&](const char* b, const char* e) {
+        const char* semi = http_parser::find_char(b, e, ';');
+        const char* name_end = semi ? semi : e;
+        while(name_end > b && is_ows(name_end[-1])) {
+            --name_end;
+        }
+        /* 只需判断q是否为0: q值中出现非0数字即为正 */
+        bool positive = true;
+        if(semi) {
+            const char* q = semi + 1;
+            while(q < e && is_ows(*q)) {
+                ++q;
+            }
+            if(e - q >= 2 && (q[0] == 'q' || q[0] == 'Q') && q[1] == '=') {
+                positive = false;
+                for(q += 2; q < e && *q != ';'; ++q) {
+                    if(*q >= '1' && *q <= '9') {
+                        positive = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if(token_equals(b, name_end, "gzip", 4) || token_equals(b, name_end, "x-gzip", 6)) {
+            accept = positive;          // 明确给出的gzip优先于*
+            return false;
+        }
+        if(token_equals(b, name_end, "*", 1)) {
+            accept = positive;
+        }
+        return true;
+    });
+    return accept;
+}
+
+http_slice http_request::get_range() const {
+    return req_range;
+}
+
+http_slice http_request::get_if_range() const {
+    return req_if_range;
+}
+
+http_slice http_request::get_if_none_match() const {
+    return req_if_none_match;
+}
+
+http_slice http_request::get_if_modified_since() const {
+    return req_if_modified_since;
+}
+
+http_slice http_request::get_header(const char* key) const {
+    const http_slice* value = find_header(key);
+    return value ? *value : EMPTY_SLICE;
+}
+
 
 /**
  * private method
  */
+
+/**
+ * @brief 头部名称大小写不敏感；同名的请求头取最后一个
+ */
+const http_slice* http_request::find_header(const char* key) const {
+    size_t len = strlen(key);
+    for(auto it = req_header.rbegin(); it != req_header.rend(); ++it) {
+        if(it->name.len == len && strncasecmp(it->name.data, key, len) == 0) {
+            return &it->value;
+        }
+    }
+    return nullptr;
+}
+
 void http_request::parse_from_urlencoded() {
     if(req_body.size() == 0) {
         return;
@@ -3,9 +3,10 @@
 
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 #include <cassert>
 
+#include "http_parser.h"
 #include "../../logger/log.h"
 
 class http_request {
@@ -25,32 +26,68 @@ public:
     };
 
 public:
-    http_request(){}
+    http_request(): req_method(GET) { reset(); }
     ~http_request() = default;
     http_request(const http_request&) = delete;
     http_request& operator=(const http_request&) = delete;
 
-    void set_request_line(std::string method, std::string path, std::string version);
-    void set_requset_header(std::string key, std::string value);
+    /**
+     * @brief 请求行与请求头只保存片段，直接指向读缓冲区(HTTP/2为流的头部列表)，不拷贝也不建立map；
+     *  调用方保证这些内存在reset之前有效
+     */
+    void set_request_line(http_slice method, http_slice path, http_slice version);
+    /**
+     * @brief 请求行中的路径映射为资源路径: "/"为首页，默认页面省略了".html"
+     * @param path 可以直接指向请求缓冲区
+     */
+    static std::string resource_path(const char* path, size_t len);
+    void set_requset_header(http_slice key, http_slice value);
     void set_request_body(std::string body);
-    std::string get_path() const;
+    const std::string& get_path() const;
     bool get_keepalive() const;
+    /**
+     * @brief 请求行中"HTTP/"之后的版本号，如"1.1"
+     */
+    http_slice get_version() const;
     HTTP_METHOD get_method() const;
+    bool accept_gzip() const;
+    /**
+     * @brief Range请求头的原始值，没有时为空片段
+     */
+    http_slice get_range() const;
+    /**
+     * @brief 条件请求头的原始值，没有时为空片段
+     */
+    http_slice get_if_range() const;
+    http_slice get_if_none_match() const;
+    http_slice get_if_modified_since() const;
+    /**
+     * @brief 按名称(不区分大小写)取请求头，没有时为空片段
+     */
+    http_slice get_header(const char* key) const;
+
+    /**
+     * @brief keep-alive/对象复用时清空上一个请求，容器保留已分配的容量
+     */
+    void reset();
 
 
 private:
+    const http_slice* find_header(const char* key) const;
     void parse_from_urlencoded();
     bool user_verify(const std::string &name, const std::string &pwd, bool isLogin);
-    static const std::unordered_set<std::string> DEFAULT_HTML;
-    static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
 
 private:
     HTTP_METHOD req_method;
-    std::string req_path;
-    std::string req_version;
-    std::unordered_map<std::string, std::string> req_header;
+    std::string req_path;                       // 映射后的资源路径，复用容量
+    http_slice req_version;
+    std::vector<http_header_slice> req_header;  // 按到达顺序保存，请求头不多，线性查找
     std::unordered_map<std::string, std::string> req_post;
     std::string req_body;
+    http_slice req_range;
+    http_slice req_if_range;
+    http_slice req_if_none_match;
+    http_slice req_if_modified_since;
 };
 
 
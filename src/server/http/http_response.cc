@@ -1,41 +1,74 @@
-#include <sstream>
+#include <cerrno>
+#include <dirent.h>
+#include <strings.h>
+#include <ctime>
 #include "http_response.h"
+#include "http_tables.h"
+#include "date_header.h"
+#include "../../utils/gzip_codec.h"
 
 
-const std::unordered_map<std::string, std::string> http_response::SUFFIX_TYPE = {
-    { ".html",  "text/html" },
-    { ".xml",   "text/xml" },
-    { ".xhtml", "application/xhtml+xml" },
-    { ".txt",   "text/plain" },
-    { ".rtf",   "application/rtf" },
-    { ".pdf",   "application/pdf" },
-    { ".word",  "application/nsword" },
-    { ".png",   "image/png" },
-    { ".gif",   "image/gif" },
-    { ".jpg",   "image/jpeg" },
-    { ".jpeg",  "image/jpeg" },
-    { ".au",    "audio/basic" },
-    { ".mpeg",  "video/mpeg" },
-    { ".mpg",   "video/mpeg" },
-    { ".avi",   "video/x-msvideo" },
-    { ".gz",    "application/x-gzip" },
-    { ".tar",   "application/x-tar" },
-    { ".css",   "text/css "},
-    { ".js",    "text/javascript "},
-};
-
-const std::unordered_map<int, std::string> http_response::CODE_STATUS = {
-    { 200, "OK" },
-    { 400, "Bad Request" },
-    { 403, "Forbidden" },
-    { 404, "Not Found" },
-};
-
-const std::unordered_map<int, std::string> http_response::CODE_PATH = {
-    { 400, "/400.html" },
-    { 403, "/403.html" },
-    { 404, "/404.html" },
-};
+static const char RANGE_BOUNDARY[] = "simplest_web_server_byteranges";
+
+/* 响应头中不变的片段，整段复制 */
+static constexpr perfect_hash::str_view CONNECTION_KEEPALIVE =
+    perfect_hash::view("Connection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n");
+static constexpr perfect_hash::str_view CONNECTION_CLOSE = perfect_hash::view("Connection: close\r\n");
+static constexpr perfect_hash::str_view ACCEPT_RANGES = perfect_hash::view("Accept-Ranges: bytes\r\n");
+static constexpr perfect_hash::str_view CONTENT_GZIP = perfect_hash::view("Content-Encoding: gzip\r\n");
+static constexpr perfect_hash::str_view VARY_ENCODING = perfect_hash::view("Vary: Accept-Encoding\r\n");
+static constexpr perfect_hash::str_view TRANSFER_CHUNKED = perfect_hash::view("Transfer-Encoding: chunked\r\n");
+
+static void append(std::string& out, perfect_hash::str_view s) {
+    out.append(s.data, s.len);
+}
+
+static void append_uint(std::string& out, uint64_t value) {
+    char buf[20];
+    char* p = buf + sizeof(buf);
+    do {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while(value != 0);
+    out.append(p, buf + sizeof(buf) - p);
+}
+
+/* "Content-Range: bytes first-last/size\r\n"，first > last时为"*\/size" */
+static void append_content_range(std::string& out, const char* name, uint64_t first, uint64_t last, uint64_t size) {
+    out.append(name);
+    out.append(": bytes ", 8);
+    if(first > last) {
+        out.push_back('*');
+    } else {
+        append_uint(out, first);
+        out.push_back('-');
+        append_uint(out, last);
+    }
+    out.push_back('/');
+    append_uint(out, size);
+    out.append("\r\n", 2);
+}
+
+/**
+ * @brief 解析s[begin, end)中的十进制数
+ * @return 1 成功，0 为空，-1 含非数字或过长
+ */
+static int parse_range_pos(const std::string& s, size_t begin, size_t end, uint64_t& value) {
+    if(begin == end) {
+        return 0;
+    }
+    if(end - begin > 18) {
+        return -1;
+    }
+    value = 0;
+    for(size_t i = begin; i < end; ++i) {
+        if(s[i] < '0' || s[i] > '9') {
+            return -1;
+        }
+        value = value * 10 + (s[i] - '0');
+    }
+    return 1;
+}
 
 
 void http_response::set_error_info() {
@@ -45,7 +78,46 @@ void http_response::set_error_info() {
     stat((rsp_resource_path + rsp_path).data(), &m_file_stat);
 }
 
-void http_response::set_finish_info(std::string path, bool keepalive) {
+void http_response::set_range(http_slice range) {
+    rsp_range.assign(range.data, range.len);
+}
+
+void http_response::set_conditions(http_slice if_none_match, http_slice if_modified_since, http_slice if_range) {
+    rsp_if_none_match.assign(if_none_match.data, if_none_match.len);
+    rsp_if_modified_since.assign(if_modified_since.data, if_modified_since.len);
+    rsp_if_range.assign(if_range.data, if_range.len);
+}
+
+void http_response::set_cache_hint(static_cache::entry_ptr entry) {
+    m_cache_hint = std::move(entry);
+}
+
+void http_response::set_content_info(int code, const std::string& content_type, std::string body, bool keepalive) {
+    rsp_code = code;
+    rsp_keepalive = keepalive;
+    rsp_content_type = content_type;
+    rsp_body = std::move(body);
+}
+
+void http_response::set_stream_info(int code, const std::string& content_type, body_producer producer,
+                                    bool keepalive, bool chunked) {
+    rsp_code = code;
+    /* 没有chunked时只能由关闭连接标记内容结束 */
+    rsp_keepalive = keepalive && chunked;
+    rsp_content_type = content_type;
+    rsp_producer = std::move(producer);
+    rsp_chunked = chunked;
+}
+
+void http_response::set_finish_info(const std::string& path, bool keepalive, bool accept_gzip) {
+    rsp_keepalive = keepalive;
+    rsp_accept_gzip = accept_gzip && rsp_range.empty();
+    /* 命中静态缓存: 无需stat/open，验证器也在缓存条目中 */
+    if(rsp_code == -1 && use_cache(path)) {
+        check_not_modified();
+        return;
+    }
+
     /* 判断请求的资源文件 */
     if(stat((rsp_resource_path + path).data(), &m_file_stat) < 0 || S_ISDIR(m_file_stat.st_mode)) {
         rsp_code = 404;
@@ -57,110 +129,648 @@ void http_response::set_finish_info(std::string path, bool keepalive) {
         rsp_code = 200; 
     }
 
-    if(CODE_PATH.count(rsp_code) == 1) {
-        rsp_path = CODE_PATH.find(rsp_code)->second;
+    const auto* page = http_tables::ERROR_PAGES.find(rsp_code);
+    if(page) {
+        rsp_path = page->value.to_string();
         stat((rsp_resource_path + rsp_path).data(), &m_file_stat);
     } else {
         rsp_path = path;
     }
-    rsp_keepalive = keepalive;
+
+    /* 验证器只依赖stat的结果，304无需打开文件 */
+    if(rsp_code == 200) {
+        rsp_etag = make_etag(m_file_stat);
+        rsp_last_modified = http_date(m_file_stat.st_mtime);
+        check_not_modified();
+    }
 }
 
 
-std::string http_response::build_response_body() {
-    std::stringstream response_stream;
-    // add response line
-    std::string status;
-    if(CODE_STATUS.count(rsp_code) == 1) {
-        status = CODE_STATUS.find(rsp_code)->second;
-    } else {
-        rsp_code = 400;
-        status = CODE_STATUS.find(400)->second;
+void http_response::build_response(std::string& out) {
+    if(!rsp_content_type.empty()) {
+        build_header(out, rsp_keepalive, rsp_body.size());
+        out.append(rsp_body);
+        return;
+    }
+    if(rsp_code == 304) {
+        build_header(out, rsp_keepalive, 0, rsp_gzip);
+        return;
     }
-    response_stream << "HTTP/1.1 " << rsp_code << " " << status << "\r\n";
 
-    // add response header
-    if(rsp_keepalive) {
-        response_stream << "Connection: keep-alive\r\n";
-        response_stream << "keep-alive: max=6, timeout=120\r\n";
-    } else{
-        response_stream << "Connection: close\r\n";
+    if(!m_cached) {
+        // add response content
+        int res_fd = open((rsp_resource_path + rsp_path).data(), O_RDONLY);
+        if(res_fd < 0) { 
+            error_content("File NotFound!", rsp_body);
+            build_header(out, rsp_keepalive, rsp_body.size());
+            out.append(rsp_body);
+            return;
+        }
+
+        /* 小文件读入静态缓存，后续请求直接命中 */
+        if(rsp_code == 200 && static_cache::get_instance()->cacheable(m_file_stat.st_size) && fill_cache(res_fd)) {
+            close(res_fd);
+        } else {
+            /**
+             * 不再mmap文件: 保留fd，由session用sendfile从page cache直接发送，
+             * 避免每个请求的mmap/munmap以及munmap引起的跨线程TLB shootdown
+             */
+            m_file_fd = res_fd;
+        }
     }
-    response_stream << "Content-type: " << get_content_type() << "\r\n";
 
-    // add response content
-    int res_fd = open((rsp_resource_path + rsp_path).data(), O_RDONLY);
-    if(res_fd < 0) { 
-        std::string err_msg = error_content("File NotFound!");
-        response_stream << "Content-length: " << err_msg.size() << "\r\n\r\n";
-        response_stream << err_msg;
-        return response_stream.str();
+    /* Range只作用于200的原始内容，之后缓存/sendfile都只发送请求的窗口 */
+    if(rsp_code == 200 && !rsp_range.empty()) {
+        apply_range();
+    }
+    if(rsp_code == 416) {
+        m_cached.reset();
+        if(m_file_fd >= 0) {
+            close(m_file_fd);
+            m_file_fd = -1;
+        }
+        error_content("Requested range not satisfiable", rsp_body);
+        build_header(out, rsp_keepalive, rsp_body.size());
+        out.append(rsp_body);
+        return;
+    }
+    if(rsp_code == 206) {
+        size_t content_len = rsp_range_tail.size();
+        for(size_t i = 0; i < rsp_ranges.size(); ++i) {
+            content_len += rsp_ranges[i].part_head.size() + rsp_ranges[i].len;
+        }
+        build_header(out, rsp_keepalive, content_len);
+        return;
     }
 
-    /* 将文件映射到内存提高文件的访问速度, MAP_PRIVATE 建立一个写入时拷贝的私有映射*/
-    LOG_DEBUG("file path %s", (rsp_resource_path + rsp_path).data());
-    int* m_ret = (int*)mmap(0, m_file_stat.st_size, PROT_READ, MAP_PRIVATE, res_fd, 0);
-    if(*m_ret == -1) {
-        std::string tmp("File NotFound!");
-        std::string err_msg = error_content(tmp);
-        response_stream << "Content-length: " << err_msg.size() << "\r\n\r\n";
-        response_stream << err_msg;
-        return response_stream.str();
+    if(m_cached) {
+        /* 响应头已按keep-alive预先序列化在缓存条目中 */
+        return;
+    }
+
+    /* 不缓存的大文件: 磁盘上有同名.gz时直接发送压缩文件 */
+    struct stat gz_stat;
+    int gz_fd = rsp_code == 200 && rsp_accept_gzip && compressible() ? open_gzip_file(gz_stat) : -1;
+    if(gz_fd >= 0) {
+        close(m_file_fd);
+        m_file_fd = gz_fd;
+        m_file_stat = gz_stat;
+        rsp_gzip = true;
     }
-    m_file = (char*)m_ret;
-    close(res_fd);
-    response_stream << "Content-length: " << m_file_stat.st_size << "\r\n\r\n";
-    return response_stream.str();
+
+    LOG_DEBUG("file path %s", (rsp_resource_path + rsp_path).data());
+    build_header(out, rsp_keepalive, m_file_stat.st_size, rsp_gzip);
+}
+
+int http_response::get_file_fd() const {
+    return m_file_fd;
 }
 
-char* http_response::get_m_file() {
-    return m_file;
+int http_response::release_file_fd() {
+    int res_fd = m_file_fd;
+    m_file_fd = -1;
+    return res_fd;
 }
 
 size_t http_response::get_file_len() const {
     return m_file_stat.st_size;
 }
 
+bool http_response::get_keepalive() const {
+    return rsp_keepalive;
+}
+
+int http_response::get_code() const {
+    return rsp_code;
+}
+
+body_producer http_response::take_producer() {
+    body_producer producer;
+    producer.swap(rsp_producer);
+    return producer;
+}
+
+bool http_response::get_chunked() const {
+    return rsp_chunked;
+}
+
+const static_cache::entry_ptr& http_response::get_cached() const {
+    return m_cached;
+}
+
+const std::vector<byte_range>& http_response::get_ranges() const {
+    return rsp_ranges;
+}
+
+const std::string& http_response::get_range_tail() const {
+    return rsp_range_tail;
+}
+
 
 void http_response::reset_for_keepalive() {
     rsp_code = -1;
     rsp_keepalive = false;
-    if(m_file) {
-        munmap(m_file, m_file_stat.st_size);
-        m_file = nullptr;
+    rsp_accept_gzip = false;
+    rsp_gzip = false;
+    rsp_range.clear();
+    rsp_ranges.clear();
+    rsp_range_tail.clear();
+    rsp_if_none_match.clear();
+    rsp_if_modified_since.clear();
+    rsp_if_range.clear();
+    rsp_etag.clear();
+    rsp_last_modified.clear();
+    rsp_content_type.clear();
+    rsp_body.clear();
+    rsp_producer = nullptr;
+    rsp_chunked = false;
+    m_cached.reset();
+    m_cache_hint.reset();
+    if(m_file_fd >= 0) {
+        close(m_file_fd);
+        m_file_fd = -1;
+    }
+}
+
+perfect_hash::str_view http_response::get_content_type() {
+    if(!rsp_content_type.empty()) {
+        return perfect_hash::str_view{rsp_content_type.data(), rsp_content_type.size()};
+    }
+    return file_mime().type;
+}
+
+size_t http_response::preload_static_cache() {
+    if(!static_cache::get_instance()->enabled()) {
+        return 0;
+    }
+    http_response probe;
+    return preload_dir(probe.rsp_resource_path, "");
+}
+
+http_response::RANGE_RESULT http_response::parse_range(const std::string& spec, off_t size,
+                                                       std::vector<byte_range>& ranges) {
+    ranges.clear();
+    if(spec.size() < 6 || strncasecmp(spec.data(), "bytes=", 6) != 0 || size < 0) {
+        return RANGE_IGNORE;
+    }
+    uint64_t file_size = static_cast<uint64_t>(size);
+    uint64_t total = 0;
+    size_t spec_num = 0;
+    size_t pos = 6;
+    while(pos <= spec.size()) {
+        size_t end = spec.find(',', pos);
+        if(end == std::string::npos) {
+            end = spec.size();
+        }
+        size_t begin = pos;
+        pos = end + 1;
+        while(begin < end && (spec[begin] == ' ' || spec[begin] == '\t')) {
+            ++begin;
+        }
+        while(end > begin && (spec[end - 1] == ' ' || spec[end - 1] == '\t')) {
+            --end;
+        }
+        if(begin == end) {
+            continue;
+        }
+        if(++spec_num > MAX_RANGES) {
+            return RANGE_IGNORE;
+        }
+        size_t dash = spec.find('-', begin);
+        if(dash == std::string::npos || dash >= end) {
+            return RANGE_IGNORE;
+        }
+        uint64_t first = 0, last = 0;
+        int has_first = parse_range_pos(spec, begin, dash, first);
+        int has_last = parse_range_pos(spec, dash + 1, end, last);
+        if(has_first < 0 || has_last < 0 || (has_first == 0 && has_last == 0)
+            || (has_first == 1 && has_last == 1 && last < first)) {
+            return RANGE_IGNORE;
+        }
+
+        byte_range range;
+        if(has_first == 0) {
+            /* "-n": 最后n个字节 */
+            if(last == 0 || file_size == 0) {
+                continue;
+            }
+            range.offset = static_cast<off_t>(last >= file_size ? 0 : file_size - last);
+        } else {
+            if(first >= file_size) {
+                continue;
+            }
+            range.offset = static_cast<off_t>(first);
+        }
+        uint64_t range_end = (has_first == 1 && has_last == 1 && last < file_size) ? last + 1 : file_size;
+        range.len = static_cast<size_t>(range_end - range.offset);
+        total += range.len;
+        ranges.push_back(range);
+    }
+    if(spec_num == 0) {
+        return RANGE_IGNORE;
+    }
+    if(ranges.empty()) {
+        return RANGE_UNSATISFIABLE;
+    }
+    if(total > file_size) {
+        ranges.clear();
+        return RANGE_IGNORE;
     }
+    return RANGE_OK;
+}
+
+std::string http_response::make_etag(const struct stat& file_stat) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\"%lx-%lx-%lx\"", static_cast<unsigned long>(file_stat.st_mtim.tv_sec),
+             static_cast<unsigned long>(file_stat.st_mtim.tv_nsec), static_cast<unsigned long>(file_stat.st_size));
+    return buf;
+}
+
+std::string http_response::http_date(time_t t) {
+    char buf[64];
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buf;
+}
+
+bool http_response::parse_http_date(const std::string& value, time_t& t) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char* end = strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if(end == nullptr || *end != '\0') {
+        return false;
+    }
+    t = timegm(&tm);
+    return true;
+}
+
+bool http_response::etag_match(const std::string& list, const std::string& etag, bool& gzip) {
+    gzip = false;
+    if(etag.empty()) {
+        return false;
+    }
+    size_t pos = 0;
+    while(pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if(end == std::string::npos) {
+            end = list.size();
+        }
+        size_t begin = pos;
+        pos = end + 1;
+        while(begin < end && (list[begin] == ' ' || list[begin] == '\t')) {
+            ++begin;
+        }
+        while(end > begin && (list[end - 1] == ' ' || list[end - 1] == '\t')) {
+            --end;
+        }
+        if(end - begin == 1 && list[begin] == '*') {
+            return true;
+        }
+        /* 弱比较: 忽略W/前缀 */
+        if(end - begin > 2 && list.compare(begin, 2, "W/") == 0) {
+            begin += 2;
+        }
+        if(list.compare(begin, end - begin, etag) == 0) {
+            return true;
+        }
+        if(list.compare(begin, end - begin, gzip_etag(etag)) == 0) {
+            gzip = true;
+            return true;
+        }
+    }
+    return false;
 }
 
 /**
  * private method
  */
 
-std::string http_response::get_content_type() {
-    /* 判断文件类型 */
+void http_response::build_header(std::string& out, bool keepalive, size_t content_len, bool gzip,
+                                 bool for_cache) {
+    // add response line
+    const auto* status = http_tables::STATUS_TEXT.find(rsp_code);
+    if(status == nullptr) {
+        rsp_code = 400;
+        status = http_tables::STATUS_TEXT.find(400);
+    }
+    append(out, status->value.line);
+
+    // add response header
+    append(out, keepalive ? CONNECTION_KEEPALIVE : CONNECTION_CLOSE);
+    if(!for_cache) {
+        date_header::append(out);
+    }
+    if(!rsp_etag.empty() && (rsp_code == 200 || rsp_code == 206 || rsp_code == 304)) {
+        out.append("ETag: ", 6);
+        if(gzip && rsp_etag.size() >= 2) {
+            /* 与gzip_etag相同: "xxx" -> "xxx-gz" */
+            out.append(rsp_etag, 0, rsp_etag.size() - 1);
+            out.append("-gz\"", 4);
+        } else {
+            out.append(rsp_etag);
+        }
+        out.append("\r\nLast-Modified: ", 17);
+        out.append(rsp_last_modified);
+        out.append("\r\n", 2);
+    }
+    if(rsp_code == 304) {
+        /* 304不带body，也不描述内容 */
+        if(compressible()) {
+            append(out, VARY_ENCODING);
+        }
+        if(!for_cache) {
+            out.append("\r\n", 2);
+        }
+        return;
+    }
+    out.append("Content-type: ", 14);
+    if(rsp_code == 206 && rsp_ranges.size() > 1) {
+        out.append("multipart/byteranges; boundary=");
+        out.append(RANGE_BOUNDARY, sizeof(RANGE_BOUNDARY) - 1);
+    } else if(rsp_code == 416) {
+        out.append("text/html", 9);
+    } else {
+        append(out, get_content_type());
+    }
+    out.append("\r\n", 2);
+    if(rsp_code == 206 && rsp_ranges.size() == 1) {
+        const byte_range& range = rsp_ranges[0];
+        append_content_range(out, "Content-Range", range.offset, range.offset + range.len - 1, m_file_stat.st_size);
+    } else if(rsp_code == 416) {
+        append_content_range(out, "Content-Range", 1, 0, m_file_stat.st_size);
+    }
+    /* 只对原始内容支持Range */
+    if(((rsp_code == 200 && !gzip) || rsp_code == 206) && rsp_content_type.empty()) {
+        append(out, ACCEPT_RANGES);
+    }
+    if(gzip) {
+        append(out, CONTENT_GZIP);
+    }
+    /* 可压缩资源的响应随Accept-Encoding变化，告知中间缓存 */
+    if(rsp_code == 200 && rsp_content_type.empty() && compressible()) {
+        append(out, VARY_ENCODING);
+    }
+    if(rsp_producer) {
+        /* 长度未知: chunked编码，或以关闭连接结束 */
+        if(rsp_chunked) {
+            append(out, TRANSFER_CHUNKED);
+        }
+    } else {
+        out.append("Content-length: ", 16);
+        append_uint(out, content_len);
+        out.append("\r\n", 2);
+    }
+    if(!for_cache) {
+        out.append("\r\n", 2);
+    }
+}
+
+/**
+ * @brief 按Range确定206的各段，多段时生成multipart/byteranges的分隔头；无法满足时改为416
+ */
+void http_response::apply_range() {
+    /* If-Range不匹配说明客户端已有的部分内容过期，返回完整内容 */
+    if(!rsp_if_range.empty() && !if_range_match()) {
+        return;
+    }
+    RANGE_RESULT ret = parse_range(rsp_range, m_file_stat.st_size, rsp_ranges);
+    if(ret == RANGE_IGNORE) {
+        return;
+    }
+    if(ret == RANGE_UNSATISFIABLE) {
+        rsp_code = 416;
+        return;
+    }
+    rsp_code = 206;
+    if(rsp_ranges.size() == 1) {
+        return;
+    }
+    perfect_hash::str_view type = get_content_type();
+    for(size_t i = 0; i < rsp_ranges.size(); ++i) {
+        byte_range& range = rsp_ranges[i];
+        std::string& part = range.part_head;
+        if(i > 0) {
+            part.append("\r\n", 2);
+        }
+        part.append("--", 2);
+        part.append(RANGE_BOUNDARY, sizeof(RANGE_BOUNDARY) - 1);
+        part.append("\r\nContent-type: ", 16);
+        append(part, type);
+        part.append("\r\n", 2);
+        append_content_range(part, "Content-Range", range.offset, range.offset + range.len - 1, m_file_stat.st_size);
+        part.append("\r\n", 2);
+    }
+    rsp_range_tail = std::string("\r\n--") + RANGE_BOUNDARY + "--\r\n";
+}
+
+/**
+ * @brief 资源未变化时改为304: If-None-Match优先，没有时比较If-Modified-Since
+ */
+void http_response::check_not_modified() {
+    bool gzip = false;
+    bool not_modified = false;
+    if(!rsp_if_none_match.empty()) {
+        not_modified = etag_match(rsp_if_none_match, rsp_etag, gzip);
+    } else if(!rsp_if_modified_since.empty()) {
+        time_t since;
+        not_modified = parse_http_date(rsp_if_modified_since, since) && m_file_stat.st_mtime <= since;
+    }
+    if(not_modified) {
+        rsp_code = 304;
+        rsp_gzip = gzip;
+        m_cached.reset();
+    }
+}
+
+/**
+ * @brief If-Range: 强比较ETag，或与Last-Modified完全相同
+ */
+bool http_response::if_range_match() const {
+    if(rsp_if_range.compare(0, 2, "W/") == 0) {
+        return false;
+    }
+    if(rsp_if_range[0] == '"') {
+        return rsp_if_range == rsp_etag;
+    }
+    return rsp_if_range == rsp_last_modified;
+}
+
+std::string http_response::gzip_etag(const std::string& etag) {
+    /* "xxx" -> "xxx-gz"，同一文件的gzip变体是不同的表示，需要不同的强ETag */
+    if(etag.size() < 2) {
+        return etag;
+    }
+    return etag.substr(0, etag.size() - 1) + "-gz\"";
+}
+
+bool http_response::use_cache(const std::string& path) {
+    bool need_revalidate = false;
+    static_cache* cache = static_cache::get_instance();
+    static_cache::entry_ptr entry;
+    if(m_cache_hint) {
+        entry = std::move(m_cache_hint);
+        static_cache::hit(entry);
+    } else {
+        entry = cache->lookup(path, need_revalidate);
+    }
+    if(!entry || entry->code != 200) {
+        return false;
+    }
+    if(need_revalidate) {
+        /* 文件被修改或替换后丢弃旧条目，走正常流程重新加载 */
+        struct stat st;
+        if(stat((rsp_resource_path + path).data(), &st) < 0
+            || st.st_ino != entry->file_stat.st_ino
+            || st.st_size != entry->file_stat.st_size
+            || st.st_mtim.tv_sec != entry->file_stat.st_mtim.tv_sec
+            || st.st_mtim.tv_nsec != entry->file_stat.st_mtim.tv_nsec) {
+            cache->erase(path);
+            return false;
+        }
+        cache->touch(entry);
+    }
+    rsp_code = 200;
+    rsp_path = path;
+    m_file_stat = entry->file_stat;
+    rsp_etag = entry->etag;
+    rsp_last_modified = entry->last_modified;
+    rsp_gzip = rsp_accept_gzip && entry->gzip;
+    m_cached = rsp_gzip ? entry->gzip : entry;
+    return true;
+}
+
+bool http_response::fill_cache(int res_fd) {
+    std::string body(m_file_stat.st_size, '\0');
+    size_t offset = 0;
+    while(offset < body.size()) {
+        ssize_t n = pread(res_fd, &body[offset], body.size() - offset, offset);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return false;
+        }
+        offset += n;
+    }
+    /* 可压缩的文本同时生成gzip变体，压缩收益不足时不保留 */
+    std::shared_ptr<static_entry> gzip;
+    std::string gz_body;
+    if(compressible() && load_gzip(body, gz_body) && gz_body.size() < body.size() / 10 * 9) {
+        std::string headers[2];
+        build_header(headers[0], false, gz_body.size(), true, true);
+        build_header(headers[1], true, gz_body.size(), true, true);
+        gzip = static_cache::make_entry(rsp_code, std::move(gz_body), std::move(headers[0]),
+                                        std::move(headers[1]), m_file_stat);
+        gzip->etag = gzip_etag(rsp_etag);
+        gzip->last_modified = rsp_last_modified;
+    }
+    std::string headers[2];
+    build_header(headers[0], false, offset, false, true);
+    build_header(headers[1], true, offset, false, true);
+    std::shared_ptr<static_entry> identity = static_cache::make_entry(
+        rsp_code, std::move(body), std::move(headers[0]), std::move(headers[1]), m_file_stat);
+    identity->etag = rsp_etag;
+    identity->last_modified = rsp_last_modified;
+    identity->gzip = gzip;
+    static_cache::entry_ptr entry = static_cache::get_instance()->insert(rsp_path, identity);
+    rsp_gzip = rsp_accept_gzip && entry->gzip;
+    m_cached = rsp_gzip ? entry->gzip : entry;
+    return true;
+}
+
+bool http_response::compressible() {
+    return file_mime().compressible;
+}
+
+/**
+ * @brief 按文件后缀查找MIME类型，后缀直接指向rsp_path，不截取子串
+ */
+const http_tables::mime_type& http_response::file_mime() const {
     std::string::size_type idx = rsp_path.find_last_of('.');
     if(idx == std::string::npos) {
-        return "text/plain";
+        return http_tables::DEFAULT_MIME;
     }
-    std::string suffix = rsp_path.substr(idx);
-    if(SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;
+    const auto* mime = http_tables::MIME_TYPES.find(perfect_hash::str_view{rsp_path.data() + idx, rsp_path.size() - idx});
+    return mime ? mime->value : http_tables::DEFAULT_MIME;
+}
+
+/**
+ * @brief 打开与资源同目录、不早于原文件修改的"<file>.gz"，不存在时返回-1
+ */
+int http_response::open_gzip_file(struct stat& gz_stat) {
+    std::string gz_path = rsp_resource_path + rsp_path + ".gz";
+    if(stat(gz_path.data(), &gz_stat) < 0 || !S_ISREG(gz_stat.st_mode)
+        || gz_stat.st_mtime < m_file_stat.st_mtime) {
+        return -1;
     }
-    return "text/plain";
+    return open(gz_path.data(), O_RDONLY);
 }
 
-std::string http_response::error_content(std::string message) {
-    std::string status;
-    if(CODE_STATUS.count(rsp_code) == 1) {
-        status = CODE_STATUS.find(rsp_code)->second;
-    } else {
-        status = "Bad Request";
+bool http_response::load_gzip(const std::string& body, std::string& out) {
+    struct stat gz_stat;
+    int gz_fd = open_gzip_file(gz_stat);
+    if(gz_fd >= 0) {
+        out.resize(gz_stat.st_size);
+        size_t offset = 0;
+        while(offset < out.size()) {
+            ssize_t n = pread(gz_fd, &out[offset], out.size() - offset, offset);
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            if(n <= 0) {
+                break;
+            }
+            offset += n;
+        }
+        close(gz_fd);
+        if(offset == out.size()) {
+            return true;
+        }
     }
-    std::stringstream body_stream;
-    body_stream << "<html><title>Error</title>"
-                << "<body bgcolor=\"ffffff\">" << rsp_code << " : " << status << "\n"
-                << "<p>" << message << "</p>"
-                << "<hr><em>simplest web server</em></body></html>";
-    return body_stream.str();
+    return gzip_compress(body.data(), body.size(), out);
 }
 
+size_t http_response::preload_dir(const std::string& root, const std::string& dir) {
+    DIR* dp = opendir((root + dir).data());
+    if(dp == nullptr) {
+        return 0;
+    }
+    size_t loaded = 0;
+    struct dirent* ent;
+    while((ent = readdir(dp)) != nullptr) {
+        std::string name = ent->d_name;
+        if(name == "." || name == ".." || (name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0)) {
+            continue;
+        }
+        std::string path = dir + "/" + name;
+        struct stat st;
+        if(stat((root + path).data(), &st) < 0) {
+            continue;
+        }
+        if(S_ISDIR(st.st_mode)) {
+            loaded += preload_dir(root, path);
+        } else if(S_ISREG(st.st_mode) && static_cache::get_instance()->cacheable(st.st_size)) {
+            /* 走一遍正常的响应流程，由fill_cache写入缓存 */
+            http_response rsp;
+            std::string head;
+            rsp.set_finish_info(path, false, false);
+            rsp.build_response(head);
+            loaded += rsp.m_cached ? 1 : 0;
+        }
+    }
+    closedir(dp);
+    return loaded;
+}
 
+void http_response::error_content(const char* message, std::string& out) {
+    const auto* status = http_tables::STATUS_TEXT.find(rsp_code);
+    out.clear();
+    out.append("<html><title>Error</title><body bgcolor=\"ffffff\">");
+    append_uint(out, rsp_code);
+    out.append(" : ", 3);
+    append(out, (status ? status : http_tables::STATUS_TEXT.find(400))->value.reason);
+    out.append("\n<p>", 4);
+    out.append(message);
+    out.append("</p><hr><em>simplest web server</em></body></html>");
+}
\ No newline at end of file
@@ -1,52 +1,176 @@
 #ifndef _HTTP_RESPONSE_H
 #define _HTTP_RESPONSE_H
 
+#include <functional>
 #include <string>
-#include <unordered_map>
+#include <vector>
 #include <fcntl.h>       // open
 #include <unistd.h>      // close
 #include <sys/stat.h>    // stat
-#include <sys/mman.h>    // mmap, munmap
 
+#include "http_parser.h"
+#include "http_tables.h"
+#include "static_cache.h"
 #include "../../logger/log.h"
 
+/**
+ * @brief Range请求中的一段: 响应体[offset, offset + len)，多段响应时前面加上part_head分隔头
+ */
+struct byte_range {
+    off_t  offset;
+    size_t len;
+    std::string part_head;
+};
+
+/**
+ * @brief 增量生成的响应体: 每次调用向out追加下一段内容，返回false表示这是最后一段
+ * 由session在前面的数据发出后再调用，响应不必完整生成就可以开始发送
+ */
+typedef std::function<bool(std::string& out)> body_producer;
+
+
 class http_response {
 
+public:
+    enum RANGE_RESULT {
+        RANGE_IGNORE = 0,       // 没有Range或无法解析，按200返回完整内容
+        RANGE_OK,
+        RANGE_UNSATISFIABLE     // 416
+    };
+
+    static const size_t MAX_RANGES = 16;
+
 public:
     http_response() {}
     ~http_response() {
-        if(m_file) {
-            munmap(m_file, m_file_stat.st_size);
-            m_file = nullptr;
+        if(m_file_fd >= 0) {
+            close(m_file_fd);
+            m_file_fd = -1;
         }
     }
     http_response(const http_response&) = delete;
     http_response& operator=(const http_response&) = delete;
 
     void set_error_info();
-    void set_finish_info(std::string path, bool keepalive);
-    std::string build_response_body();
-    char*  get_m_file();
+    /**
+     * @brief 设置请求的Range，需在set_finish_info之前调用；Range请求只返回未压缩的原始内容
+     */
+    void set_range(http_slice range);
+    /**
+     * @brief 设置条件请求头，需在set_finish_info之前调用；资源未变化时返回不带body的304
+     */
+    void set_conditions(http_slice if_none_match, http_slice if_modified_since, http_slice if_range);
+    void set_finish_info(const std::string& path, bool keepalive, bool accept_gzip = false);
+    /**
+     * @brief 调用方已经查到的无需校验的缓存条目(reactor分类请求时)，set_finish_info直接使用，不再查找
+     */
+    void set_cache_hint(static_cache::entry_ptr entry);
+    /**
+     * @brief 返回动态生成的内容(如/metrics)，不经过文件与缓存
+     */
+    void set_content_info(int code, const std::string& content_type, std::string body, bool keepalive);
+    /**
+     * @brief 返回长度未知、边生成边发送的动态内容
+     * @param chunked HTTP/1.1使用chunked编码；HTTP/1.0客户端不支持时以关闭连接标记结束
+     */
+    void set_stream_info(int code, const std::string& content_type, body_producer producer,
+                         bool keepalive, bool chunked);
+    /**
+     * @brief 向out追加状态行与响应头，错误页面/动态内容跟在后面；不分配内存(out容量足够时)
+     *  命中缓存的完整响应不追加任何内容，发送时使用缓存条目中预序列化的响应头，之后再补上Date头与空行
+     */
+    void build_response(std::string& out);
+    int    get_file_fd() const;
+    /**
+     * @brief 转移响应文件的所有权，之后由调用方负责close
+     */
+    int    release_file_fd();
     size_t get_file_len() const;
+    bool   get_keepalive() const;
+    int    get_code() const;
+    /**
+     * @brief 转移set_stream_info设置的生成器，没有时为空
+     */
+    body_producer take_producer();
+    bool   get_chunked() const;
+    const static_cache::entry_ptr& get_cached() const;
+    /**
+     * @brief 206响应要发送的各段，为空时发送完整的响应体；多段响应最后还需发送get_range_tail()
+     */
+    const std::vector<byte_range>& get_ranges() const;
+    const std::string& get_range_tail() const;
     void reset_for_keepalive();
 
+    /**
+     * @brief 启动时遍历资源目录，将可缓存的文件(及其gzip变体)预先载入静态缓存
+     * @return 载入的文件数
+     */
+    static size_t preload_static_cache();
+
+    /**
+     * @brief 解析"bytes=a-b, c-, -n"，结果按请求顺序排列，已按文件大小截断
+     *  语法错误、超过MAX_RANGES段或各段总长超过文件大小(重叠请求)时忽略Range
+     */
+    static RANGE_RESULT parse_range(const std::string& spec, off_t size, std::vector<byte_range>& ranges);
+
+    /**
+     * @brief 由文件大小和修改时间生成强ETag，同一文件是否缓存得到的值相同
+     */
+    static std::string make_etag(const struct stat& file_stat);
+    static std::string http_date(time_t t);
+    static bool parse_http_date(const std::string& value, time_t& t);
+
+    /**
+     * @brief If-None-Match列表(弱比较)是否包含etag或其gzip变体，匹配gzip变体时gzip为true
+     */
+    static bool etag_match(const std::string& list, const std::string& etag, bool& gzip);
+
 
 private:
-    std::string get_content_type();
-    std::string error_content(std::string message);
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
-    static const std::unordered_map<int, std::string> CODE_STATUS;
-    static const std::unordered_map<int, std::string> CODE_PATH;
+    perfect_hash::str_view get_content_type();
+    const http_tables::mime_type& file_mime() const;
+    /**
+     * @param for_cache 写入缓存条目的响应头: 不带Date头与结尾的空行，由发送方每次补上
+     */
+    void build_header(std::string& out, bool keepalive, size_t content_len, bool gzip = false,
+                      bool for_cache = false);
+    bool compressible();
+    int  open_gzip_file(struct stat& gz_stat);
+    bool load_gzip(const std::string& body, std::string& out);
+    bool use_cache(const std::string& path);
+    void apply_range();
+    void check_not_modified();
+    bool if_range_match() const;
+    static std::string gzip_etag(const std::string& etag);
+    bool fill_cache(int res_fd);
+    static size_t preload_dir(const std::string& root, const std::string& dir);
+    void error_content(const char* message, std::string& out);
 
 private:
     int rsp_code = -1;
     bool rsp_keepalive;
+    bool rsp_accept_gzip = false;   // 客户端接受gzip
+    bool rsp_gzip = false;          // 本次以gzip发送
+    std::string rsp_range;          // 请求的Range
+    std::vector<byte_range> rsp_ranges;
+    std::string rsp_range_tail;     // 多段响应的结束分隔符
+    std::string rsp_if_none_match;
+    std::string rsp_if_modified_since;
+    std::string rsp_if_range;
+    std::string rsp_etag;           // 200/206/304响应的验证器
+    std::string rsp_last_modified;
+    std::string rsp_content_type;   // 非空时为动态内容
+    std::string rsp_body;
+    body_producer rsp_producer;     // 非空时为流式内容，响应头不带Content-length
+    bool rsp_chunked = false;
 
     std::string rsp_path;
     std::string rsp_resource_path = "/opt/simplest-web-server/src/server/http/resource";
 
-    char* m_file;
+    int m_file_fd = -1;          // 响应文件，由session通过sendfile发送
     struct stat m_file_stat;
+    static_cache::entry_ptr m_cached;   // 命中静态缓存时的响应，持有期间不会被淘汰释放
+    static_cache::entry_ptr m_cache_hint;
 };
 
 #endif
\ No newline at end of file
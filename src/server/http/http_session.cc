@@ -1,218 +1,755 @@
 #include "http_session.h"
+#include "h2_session.h"
+#include "date_header.h"
+#include "../metrics.h"
 #include <string>
-#include <regex>
+#include <cstring>
+#include <strings.h>
+#include <algorithm>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 
-http_session::http_session(int fd_, uint32_t event, std::shared_ptr<epoller>& epl): 
-    fd(fd_), conn_event(event), epler_(epl) {
-        m_read_idx = 0;
-        m_checked_idx = 0;
-        m_start_line = 0;
-        iov_cnt = 0;
-        bytes_to_send = 0;
-        bytes_have_send = 0;
-        m_check_state = CHECK_STATE_REQUESTLINE;
-        memset(m_read_buf, '\0', READ_BUFFER_SIZE);
+http_session::http_session(): fd(-1), conn_event(0), ev_data(0), m_read_buf(MAX_REQUEST_SIZE),
+    m_completion_io(false), m_sending(false) {
+    reset_for_keepalive();
+}
+
+http_session::http_session(int fd_, uint32_t event, std::shared_ptr<poller>& epl, uint64_t data): 
+    fd(fd_), conn_event(event), epler_(epl), ev_data(data), m_read_buf(MAX_REQUEST_SIZE),
+    m_completion_io(false), m_sending(false) {
+    reset_for_keepalive();
+}
+
+http_session::~http_session() = default;
+
+void http_session::init(int fd_, uint32_t event, std::shared_ptr<poller>& epl, uint64_t data) {
+    fd = fd_;
+    conn_event = event;
+    ev_data = data;
+    if(epler_ != epl) {
+        epler_ = epl;
     }
+}
 
+void http_session::recycle() {
+    reset_for_keepalive();
+    m_tls.detach();
+    m_completion_io = false;
+    m_sending = false;
+    fd = -1;
+}
 
-bool http_session::read_buf() {
-    int  recv_cnt = 0;
+
+bool http_session::start_tls(tls_context* ctx) {
+    return m_tls.attach(ctx, fd);
+}
+
+http_session::READ_RESULT http_session::read_buf() {
+    if(m_tls.active()) {
+        return read_tls();
+    }
+    ssize_t recv_cnt = 0;
+    int saved_errno = 0;
     /**
-     * recv函数返回说明：
-     *     <0 出错；
+     * read_fd返回说明：
+     *     <0 出错(包括请求超过上限)；
      *     =0 连接关闭；
      *     >0 接收到的数据长度大小；
      */
     do {
-        recv_cnt = recv(fd, &m_read_buf[m_read_idx], READ_BUFFER_SIZE - m_read_idx, 0);
+        recv_cnt = m_read_buf.read_fd(fd, saved_errno);
         if (recv_cnt == -1)
         {
-            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            if (saved_errno == EAGAIN || saved_errno == EWOULDBLOCK)
                 break;
-            return false;
+            if (saved_errno == ENOBUFS)
+                break;          // 已达上限，交给process返回错误
+            if (saved_errno == EINTR)
+                continue;
+            return READ_CLOSE;
         }
         else if (recv_cnt == 0)
         {
-            return false;
+            return READ_CLOSE;
         }
-        m_read_idx += recv_cnt;
     }while(conn_event & EPOLLET);
 
-    return true;
+    return READ_DATA;
+}
+
+void http_session::feed(const char* data, size_t len) {
+    size_t room = MAX_REQUEST_SIZE > m_read_buf.size() ? MAX_REQUEST_SIZE - m_read_buf.size() : 0;
+    m_read_buf.append(data, std::min(len, room));
+}
+
+bool http_session::send_done(int res) {
+    m_sending = false;
+    if (res > 0) {
+        consume_iov(res);
+        metrics::add(METRIC_RESPONSE_BYTES, res);
+        return true;
+    }
+    /* 被打断时write_buf从断点重新提交 */
+    return res == -EINTR || res == -EAGAIN;
 }
 
 
+
+
 /**
- * @return
- *      true 继续打开连接
- *      false 关闭连接
+ * @brief 只在reactor线程调用；不处理读缓冲区中剩余的请求，交给reactor按请求类型分派
  */
-bool http_session::write_buf() {
-    int temp = 0;
+http_session::WRITE_RESULT http_session::write_buf() {
+    ssize_t temp = 0;
+
+    if (m_sending) {
+        return WRITE_DONE;      // 等待上一次发送的完成事件
+    }
+
+    if (m_tls.active() && !m_tls.handshake_done()) {
+        /* 握手时发送缓冲区已满，可写后继续握手；完成时请求已到达则交给reactor处理 */
+        READ_RESULT res = read_tls();
+        if (res != READ_DATA) {
+            return res == READ_CLOSE ? WRITE_CLOSE : WRITE_DONE;
+        }
+        if (!m_read_buf.empty()) {
+            return WRITE_PENDING;
+        }
+    }
 
     while (1) {
-        temp = writev(fd, iov_vec, iov_cnt);
-        if (temp < 0) {
-            if (errno == EAGAIN) {
-                epler_->mod_fd(fd, conn_event | EPOLLOUT);
-                return true;
+        /* 按顺序释放已发送完的响应，非keep-alive的响应发送完即关闭连接 */
+        while (m_resp_idx < m_responses.size()) {
+            pending_response& rsp = m_responses[m_resp_idx];
+            if (rsp.mem_sent < mem_len(rsp) || rsp.file_remain > 0) {
+                break;
+            }
+            if (rsp.producer) {
+                next_chunk(rsp);
+                continue;
+            }
+            if (rsp.own_file) {
+                close(rsp.file_fd);
+                rsp.own_file = false;
+            }
+            rsp.cached.reset();
+            m_resp_idx++;
+            if (!rsp.keepalive) {
+                return WRITE_CLOSE;
             }
-            return false;
+        }
+        if (m_resp_idx == m_responses.size()) {
+            m_head_arena.clear();
+            /* HTTP/2: 上一批帧已发出，继续排入各流的后续内容 */
+            if (m_h2) {
+                m_responses.clear();
+                m_resp_idx = 0;
+                if (m_h2->schedule(m_responses)) {
+                    continue;
+                }
+            }
+            m_responses.clear();
+            m_resp_idx = 0;
+            /* TLS: 读缓冲区满时留在SSL中的明文不会再触发EPOLLIN */
+            if (m_tls.has_pending() && read_tls() == READ_CLOSE) {
+                return WRITE_CLOSE;
+            }
+            /* 超过单批上限留在缓冲区中的请求不会再触发EPOLLIN，由reactor直接分派 */
+            if (!m_read_buf.empty()) {
+                return WRITE_PENDING;
+            }
+            break;
         }
 
-        bytes_have_send += temp;
-        bytes_to_send -= temp;
-        if (bytes_have_send >= iov_vec[0].iov_len) {
-            iov_vec[0].iov_len = 0;
-            iov_vec[1].iov_base = (uint8_t*)iov_vec[1].iov_base + (bytes_have_send - iov_vec[0].iov_len);
-            iov_vec[1].iov_len = bytes_to_send;
+        pending_response& cur = m_responses[m_resp_idx];
+        if (cur.mem_sent < mem_len(cur)) {
+            /* 从当前响应开始收集连续的内存段，直到某个响应还有文件要发送或内容未生成完；
+             * 文件前的部分带MSG_MORE，与文件首部合并到同一个TCP报文 */
+            struct iovec* iov = m_send_iov;
+            int iov_cnt = 0;
+            bool file_follows = false;
+            for (size_t i = m_resp_idx; i < m_responses.size() && iov_cnt + 4 <= MAX_BATCH_IOV; ++i) {
+                iov_cnt += fill_iov(m_responses[i], iov + iov_cnt);
+                if (m_responses[i].file_remain > 0) {
+                    file_follows = true;
+                    break;
+                }
+                if (m_responses[i].producer) {
+                    break;      // 已生成的部分立即发出，不等待后续内容
+                }
+            }
+            int flags = MSG_NOSIGNAL | (file_follows ? MSG_MORE : 0);
+            if (m_completion_io) {
+                return submit_send(iov_cnt, flags) ? WRITE_DONE : WRITE_CLOSE;
+            }
+            temp = send_iov(iov, iov_cnt, flags);
+            if (temp > 0) {
+                consume_iov(temp);
+                metrics::add(METRIC_RESPONSE_BYTES, temp);
+            }
         } else {
-            iov_vec[0].iov_base = (uint8_t*)iov_vec[0].iov_base + bytes_have_send;
-            iov_vec[0].iov_len = iov_vec[0].iov_len - bytes_have_send;
+            /* 零拷贝: 内核从page cache直接发送，file_offset由sendfile推进，EAGAIN后从断点续传 */
+            temp = send_file(cur);
+            if (temp > 0) {
+                cur.file_remain -= temp;
+                metrics::add(METRIC_RESPONSE_BYTES, temp);
+            } else if (temp == 0) {
+                LOG_ERROR("fd: %d, sendfile reach eof, file may be truncated", fd);
+                return WRITE_CLOSE;
+            }
         }
 
-        if (bytes_to_send <= 0) {
-            if(request.get_keepalive()) {
-                reset_for_keepalive();
-                epler_->mod_fd(fd, conn_event | EPOLLIN);
-                return true;
-            } else {
-                return false;
+        if (temp < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                rearm(EPOLLOUT);
+                return WRITE_DONE;
+            }
+            if (errno == EINTR) {
+                continue;
             }
+            return WRITE_CLOSE;
         }
     }
+
+    rearm(EPOLLIN);
+    return WRITE_DONE;
 }
 
-void http_session::process() {
-    process_read_buf();
-    if(m_check_state == CHECK_STATE_ERROR || m_check_state == CHECK_STATE_FINISH) {
-        if(m_check_state == CHECK_STATE_ERROR) {
-            response.set_error_info();
+bool http_session::inline_ready() {
+    clear_classified();
+    if (m_h2 || m_read_buf.empty()) {
+        return false;
+    }
+    size_t len = m_read_buf.size();
+    const char* data = m_read_buf.pullup(len);
+    size_t offset = 0;
+    static_cache* cache = static_cache::get_instance();
+    for (size_t num = 0; offset < len && num < MAX_PIPELINE; ++num) {
+        http_request_head head;
+        size_t consumed = 0;
+        http_parser::PARSE_RESULT ret = http_parser::parse_request(data + offset, len - offset, head, consumed);
+        if (ret == http_parser::PARSE_AGAIN) {
+            /* 不完整的请求留给下一次读取，已达上限时交给worker返回错误 */
+            if (len - offset >= MAX_REQUEST_SIZE) {
+                clear_classified();
+                return false;
+            }
+            break;
         }
-        if(m_check_state == CHECK_STATE_FINISH) {
-            response.set_finish_info(request.get_path(), request.get_keepalive());
+        if (ret == http_parser::PARSE_ERROR || !head.method.equals("GET", 3)) {
+            clear_classified();
+            return false;
         }
-
-        std::string body = response.build_response_body();
-        /* 响应头 */
-        iov_vec[0].iov_base = const_cast<char*>(body.c_str());
-        iov_vec[0].iov_len = body.size();
-        iov_cnt = 1;
-        bytes_to_send += iov_vec[0].iov_len;
-        /* 文件 */
-        if(response.get_file_len() > 0  && response.get_m_file()) {
-            iov_vec[1].iov_base = response.get_m_file();
-            iov_vec[1].iov_len = response.get_file_len();
-            iov_cnt = 2;
-            bytes_to_send += iov_vec[1].iov_len;
+        for (size_t i = 0; i < head.header_num; ++i) {
+            const http_slice& name = head.headers[i].name;
+            if ((name.len == 14 && strncasecmp(name.data, "Content-Length", 14) == 0)
+                || (name.len == 17 && strncasecmp(name.data, "Transfer-Encoding", 17) == 0)
+                || (name.len == 7 && strncasecmp(name.data, "Upgrade", 7) == 0)) {
+                clear_classified();
+                return false;
+            }
         }
-
-        if(bytes_to_send > 0) {
-            epler_->mod_fd(fd, conn_event | EPOLLOUT);
+        static_cache::entry_ptr entry = cache->fresh(http_request::resource_path(head.path.data, head.path.len));
+        if (!entry) {
+            clear_classified();
+            return false;
         }
+        classified_request c = { head.method, head.path, head.version, m_classified_headers.size(),
+                                 head.header_num, consumed, std::move(entry) };
+        m_classified_headers.insert(m_classified_headers.end(), head.headers, head.headers + head.header_num);
+        m_classified.push_back(std::move(c));
+        offset += consumed;
+    }
+    m_classified_data = data;
+    m_classified_len = len;
+    return true;
+}
 
-        return;
+/**
+ * @brief 解析缓冲区中所有完整的请求(HTTP/1.1 pipelining)，按顺序生成响应，
+ * 由reactor调用write_buf将这一批响应合并发送
+ */
+bool http_session::process() {
+    /* 数据都在一个块内时不拷贝，跨块时合并一次 */
+    size_t len = m_read_buf.size();
+    const char* data = len > 0 ? m_read_buf.pullup(len) : nullptr;
+    size_t offset = 0;
+    /* 缓冲区与inline_ready分类时相同才能使用分类结果 */
+    if (data != m_classified_data || len != m_classified_len) {
+        clear_classified();
+    }
+    if (!m_h2 && len > 0 && memcmp(data, H2_PREFACE, std::min(len, H2_PREFACE_LEN)) == 0) {
+        /* prior knowledge: 连接以HTTP/2前言开头；前言不完整时等待，避免被当作HTTP/1.x请求 */
+        if (len < H2_PREFACE_LEN) {
+            return false;
+        }
+        m_h2.reset(new h2_session());
+    }
+    for (size_t num = 0; !m_h2 && m_responses.size() < MAX_PIPELINE; ++num) {
+        size_t used = 0;
+        if (num < m_classified.size()) {
+            apply_classified(num, used);
+        } else {
+            process_read_buf(data + offset, len - offset, used);
+        }
+        if (m_check_state != CHECK_STATE_FINISH && m_check_state != CHECK_STATE_ERROR) {
+            break;
+        }
+        offset += used;
+        /* 连接将被关闭，之后的请求不再处理 */
+        if (!add_response()) {
+            break;
+        }
+    }
+    if (m_h2) {
+        /* 升级后缓冲区中剩余的数据(客户端前言等)属于HTTP/2 */
+        size_t used = 0;
+        m_h2->process(data + offset, len - offset, used);
+        offset += used;
+        m_h2->schedule(m_responses);
     }
-    epler_->mod_fd(fd, conn_event | EPOLLIN);
+    clear_classified();
+    if (offset > 0) {
+        m_read_buf.consume(offset);
+    }
+
+    return !m_responses.empty();
 }
 
 
-void http_session::process_read_buf() {
-    while (m_check_state != CHECK_STATE_FINISH && m_check_state != CHECK_STATE_ERROR) {
-        parse_line();
-        std::string text(m_read_buf + m_start_line);
-        LOG_INFO("fd: %d, process_read buffer: %s", fd, text.c_str());
-        m_start_line = m_checked_idx;
-        switch (m_check_state) {
-            case CHECK_STATE_REQUESTLINE: {
-                if(!parse_request_line(text)) {
-                    m_check_state = CHECK_STATE_ERROR;
-                    LOG_ERROR("fd: %d, parse request line error", fd);
-                    return;
-                }
-                m_check_state = CHECK_STATE_HEADER;
-                break;
-            }
-            case CHECK_STATE_HEADER: {
-                if(text == "") {
-                    m_check_state = CHECK_STATE_CONTENT;
-                    break;
-                }
+/**
+ * private method
+ */
 
-                if(!parse_headers(text)) {
-                    m_check_state = CHECK_STATE_ERROR;
-                    return;
-                }
-                break;
-            }
-            case CHECK_STATE_CONTENT: {
-                if(!parse_content(text)) {
-                    m_check_state = CHECK_STATE_ERROR;
-                    return;
-                }
-                m_check_state = CHECK_STATE_FINISH;
+/**
+ * @brief 重新注册EPOLLONESHOT事件，只在reactor线程调用
+ */
+void http_session::rearm(uint32_t events) {
+    /* 完成模式下multishot recv一直有效，只有等待可写(sendfile)时才需要注册 */
+    if(m_completion_io && !(events & EPOLLOUT)) {
+        return;
+    }
+    epler_->mod_fd(fd, conn_event | events, ev_data);
+}
+
+/**
+ * @brief 推进握手并解密所有已到达的记录；读到WANT_READ为止，
+ * 否则已解密的明文留在SSL缓冲区中，socket上没有新数据时不会再触发EPOLLIN
+ */
+http_session::READ_RESULT http_session::read_tls() {
+    if(!m_tls.handshake_done()) {
+        tls_connection::TLS_RESULT res = m_tls.handshake();
+        if(res == tls_connection::TLS_ERROR) {
+            return READ_CLOSE;
+        }
+        if(res != tls_connection::TLS_OK) {
+            rearm(res == tls_connection::TLS_WANT_WRITE ? EPOLLOUT : EPOLLIN);
+            return READ_WAIT;
+        }
+    }
+    while(true) {
+        size_t room = 0;
+        char* p = m_read_buf.prepare(room);
+        if(p == nullptr) {
+            break;          // 已达上限，交给process返回错误
+        }
+        int saved_errno = 0;
+        ssize_t n = m_tls.read(p, room, saved_errno);
+        m_read_buf.commit(n > 0 ? n : 0);
+        if(n == 0) {
+            return READ_CLOSE;
+        }
+        if(n < 0) {
+            if(saved_errno == EAGAIN) {
                 break;
             }
-            default: {
-                m_check_state = CHECK_STATE_ERROR;
-                return;
+            if(saved_errno == EINTR) {
+                continue;
             }
+            return READ_CLOSE;
         }
     }
+    if(m_read_buf.empty()) {
+        rearm(EPOLLIN);
+        return READ_WAIT;
+    }
+    return READ_DATA;
+}
+
+/**
+ * @brief kTLS未生效时由SSL加密后写出，否则与明文连接相同
+ */
+ssize_t http_session::send_iov(struct iovec* iov, int iov_cnt, int flags) {
+    if(m_tls.active() && !m_tls.ktls_send()) {
+        return m_tls.writev(iov, iov_cnt);
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_cnt;
+    return sendmsg(fd, &msg, flags);
 }
 
+/**
+ * @brief 完成模式: m_send_iov[0, iov_cnt)交给poller提交sendmsg，结果由send_done处理
+ */
+bool http_session::submit_send(int iov_cnt, int flags) {
+    memset(&m_send_msg, 0, sizeof(m_send_msg));
+    m_send_msg.msg_iov = m_send_iov;
+    m_send_msg.msg_iovlen = iov_cnt;
+    m_sending = epler_->send_msg(fd, &m_send_msg, flags, ev_data);
+    return m_sending;
+}
+
+ssize_t http_session::send_file(pending_response& rsp) {
+    if(m_tls.active()) {
+        return m_tls.sendfile(rsp.file_fd, &rsp.file_offset, rsp.file_remain);
+    }
+    return sendfile(fd, rsp.file_fd, &rsp.file_offset, rsp.file_remain);
+}
 
-// TODO: optimize, streaming parse 
-bool http_session::parse_line() {
-    for(int i = m_checked_idx; i < m_read_idx; ++i) {
-        if (m_read_buf[i] == '\r' && m_read_buf[i + 1] == '\n') {
-            m_read_buf[i++] = '\0';
-            m_read_buf[i++] = '\0';
-            m_checked_idx = i;
-            return true;
+/**
+ * @brief 解析data[0, len)开头的一个请求，成功时used为请求头 + body的长度
+ */
+void http_session::process_read_buf(const char* data, size_t len, size_t& used) {
+    http_request_head head;
+    size_t consumed = 0;
+    m_check_state = CHECK_STATE_REQUESTLINE;
+    if(len == 0) {
+        return;
+    }
+    uint64_t parse_start = metrics::now_ns();
+    http_parser::PARSE_RESULT ret = http_parser::parse_request(data, len, head, consumed);
+    metrics::record(METRIC_PARSE_TIME, metrics::now_ns() - parse_start);
+    if(ret == http_parser::PARSE_AGAIN) {
+        /* 请求头不完整，等待更多数据；已达请求上限则无法继续 */
+        if(len >= MAX_REQUEST_SIZE) {
+            m_check_state = CHECK_STATE_ERROR;
+            LOG_ERROR("fd: %d, request header too large", fd);
+        }
+        return;
+    }
+    if(ret == http_parser::PARSE_ERROR) {
+        m_check_state = CHECK_STATE_ERROR;
+        LOG_ERROR("fd: %d, parse request error", fd);
+        return;
+    }
+
+    /* 以Content-Length或chunked编码确定body的边界，其后的数据属于下一个流水线请求 */
+    size_t body_len = 0;
+    bool chunked = false;
+    if(!http_parser::transfer_chunked(head, chunked)) {
+        m_check_state = CHECK_STATE_ERROR;
+        LOG_ERROR("fd: %d, unsupported transfer encoding", fd);
+        return;
+    }
+    if(chunked) {
+        /* 之前已解码的部分不再重复处理 */
+        chunked_decoder::DECODE_RESULT res = m_chunked.decode(data + consumed + m_chunked_used,
+                                                              len - consumed - m_chunked_used,
+                                                              m_chunked_used, m_chunked_body);
+        if(res == chunked_decoder::DECODE_AGAIN && len < MAX_REQUEST_SIZE) {
+            return;
+        }
+        if(res != chunked_decoder::DECODE_DONE) {
+            m_check_state = CHECK_STATE_ERROR;
+            LOG_ERROR("fd: %d, invalid chunked body", fd);
+            reset_chunked();
+            return;
         }
+        body_len = m_chunked_used;
+    } else if(!http_parser::content_length(head, body_len) || body_len > MAX_REQUEST_SIZE - consumed) {
+        m_check_state = CHECK_STATE_ERROR;
+        LOG_ERROR("fd: %d, invalid content length", fd);
+        return;
+    }
+    if(len - consumed < body_len) {
+        return;
+    }
+
+    LOG_DEBUG("fd: %d, request line: %.*s %.*s HTTP/%.*s", fd,
+              (int)head.method.len, head.method.data, (int)head.path.len, head.path.data,
+              (int)head.version.len, head.version.data);
+    /* 请求只引用读缓冲区中的片段，process在响应生成之后才消费缓冲区 */
+    request.set_request_line(head.method, head.path, head.version);
+    for(size_t i = 0; i < head.header_num; ++i) {
+        request.set_requset_header(head.headers[i].name, head.headers[i].value);
     }
-    return false;
+    bool content_ok = chunked ? parse_content(m_chunked_body.data(), m_chunked_body.size())
+                              : parse_content(data + consumed, body_len);
+    if(chunked) {
+        reset_chunked();
+    }
+    if(!content_ok) {
+        m_check_state = CHECK_STATE_ERROR;
+        return;
+    }
+    used = consumed + body_len;
+    m_check_state = CHECK_STATE_FINISH;
 }
 
-bool http_session::parse_request_line(std::string& line) {
-    std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    std::smatch sub_match;
-    if(std::regex_match(line, sub_match, patten)) {
-        request.set_request_line(sub_match[1], sub_match[2], sub_match[3]);
-        return true;
+/**
+ * @brief 使用inline_ready的分类结果填充请求，与process_read_buf解析成功时相同
+ */
+void http_session::apply_classified(size_t idx, size_t& used) {
+    classified_request& c = m_classified[idx];
+    request.set_request_line(c.method, c.path, c.version);
+    for(size_t i = 0; i < c.header_num; ++i) {
+        const http_header_slice& header = m_classified_headers[c.header_off + i];
+        request.set_requset_header(header.name, header.value);
     }
-    return false;
+    response.set_cache_hint(std::move(c.entry));
+    used = c.consumed;
+    m_check_state = CHECK_STATE_FINISH;
 }
 
+void http_session::clear_classified() {
+    m_classified.clear();
+    m_classified_headers.clear();
+    m_classified_data = nullptr;
+    m_classified_len = 0;
+}
 
-bool http_session::parse_headers(std::string& line) {
-    std::regex patten("^([^:]*): ?(.*)$");
-    std::smatch sub_match;
-    if(std::regex_match(line, sub_match, patten)) {
-        request.set_requset_header(sub_match[1], sub_match[2]);
-        return true;
+void http_session::reset_chunked() {
+    m_chunked.reset();
+    m_chunked_used = 0;
+    m_chunked_body.clear();
+}
+
+bool http_session::parse_content(const char* body, size_t len) {
+    request.set_request_body(std::string(body, len));
+    LOG_DEBUG("fd: %d, request body:%.*s, len:%d", fd, (int)len, body, (int)len);
+    return true;
+}
+
+/**
+ * @brief 流式响应: 当前段发送完后生成下一段，chunked时编码后放入head，生成结束时追加last-chunk
+ */
+void http_session::next_chunk(pending_response& rsp) {
+    m_chunk_buf.clear();
+    bool more = rsp.producer(m_chunk_buf);
+    /* 响应头(缓冲区中的片段)已随第一段发出，之后的内存部分只有生成的内容 */
+    rsp.arena_len = 0;
+    rsp.cached_head = nullptr;
+    rsp.body_len = 0;
+    rsp.head.clear();
+    rsp.mem_sent = 0;
+    if(rsp.chunked) {
+        chunked_encoder::append_chunk(rsp.head, m_chunk_buf.data(), m_chunk_buf.size());
+        if(!more) {
+            chunked_encoder::append_last(rsp.head);
+        }
+    } else {
+        rsp.head.swap(m_chunk_buf);
+    }
+    if(!more) {
+        rsp.producer = nullptr;
     }
-    return false;
 }
 
+/**
+ * @brief 为刚解析完(或解析出错)的请求生成响应并排队，然后复位请求状态以解析下一个请求
+ * @return 响应是否keep-alive
+ */
+bool http_session::add_response() {
+    if(m_check_state == CHECK_STATE_ERROR) {
+        response.set_error_info();
+    } else if(upgrade_h2c()) {
+        return true;
+    } else {
+        dispatch(request, response, request.get_keepalive(), request.get_version().equals("1.1", 3));
+    }
+
+    /* 响应头追加到本批共用的缓冲区，文件的所有权转移到队列，保证发送完成前有效 */
+    if(m_head_arena.capacity() < HEAD_ARENA_SIZE) {
+        m_head_arena.reserve(HEAD_ARENA_SIZE);
+    }
+    size_t head_off = m_head_arena.size();
+    response.build_response(m_head_arena);
+    const static_cache::entry_ptr& cached = response.get_cached();
+    bool keepalive = response.get_keepalive();
+    metrics::add(METRIC_REQUESTS);
+    int code = response.get_code();
+    if(code >= 200 && code < 600) {
+        metrics::add(static_cast<METRIC_COUNTER>(METRIC_RESPONSES_2XX + code / 100 - 2));
+    }
+    int file_fd = -1;
+    if(!cached && response.get_file_fd() >= 0) {
+        file_fd = response.release_file_fd();
+    }
 
-bool http_session::parse_content(std::string& line) {
-    request.set_request_body(line);
-    LOG_DEBUG("fd: %d, request body:%s, len:%d", fd, line.c_str(), line.size());
+    const std::vector<byte_range>& ranges = response.get_ranges();
+    if(ranges.empty()) {
+        pending_response& rsp = push_response();
+        if(cached) {
+            rsp.cached = cached;
+            rsp.cached_head = &cached->headers[keepalive ? 1 : 0];
+            /* 缓存的响应头不含Date，补上当前的Date头与空行 */
+            date_header::append(m_head_arena);
+            m_head_arena.append("\r\n", 2);
+            rsp.body = cached->body.data();
+            rsp.body_len = cached->body.size();
+        } else {
+            rsp.producer = response.take_producer();
+            rsp.chunked = response.get_chunked();
+            if(file_fd >= 0) {
+                rsp.file_fd = file_fd;
+                rsp.own_file = true;
+                rsp.file_remain = response.get_file_len();
+            }
+        }
+        rsp.arena_off = head_off;
+        rsp.arena_len = m_head_arena.size() - head_off;
+        rsp.keepalive = keepalive;
+    } else {
+        /* 206: 每段一个条目，只发送请求的窗口；多段时依次为 分隔头 + 内容，最后是结束分隔符 */
+        for(size_t i = 0; i < ranges.size(); ++i) {
+            pending_response& rsp = push_response();
+            m_head_arena.append(ranges[i].part_head);
+            rsp.arena_off = head_off;
+            rsp.arena_len = m_head_arena.size() - head_off;
+            head_off = m_head_arena.size();
+            if(cached) {
+                rsp.cached = cached;
+                rsp.body = cached->body.data() + ranges[i].offset;
+                rsp.body_len = ranges[i].len;
+            } else {
+                rsp.file_fd = file_fd;
+                rsp.file_offset = ranges[i].offset;
+                rsp.file_remain = ranges[i].len;
+            }
+        }
+        if(!response.get_range_tail().empty()) {
+            pending_response& rsp = push_response();
+            m_head_arena.append(response.get_range_tail());
+            rsp.arena_off = head_off;
+            rsp.arena_len = m_head_arena.size() - head_off;
+        }
+        if(file_fd >= 0) {
+            m_responses.back().file_fd = file_fd;
+            m_responses.back().own_file = true;
+        }
+        m_responses.back().keepalive = keepalive;
+    }
+
+    /* 上一个请求的请求头/表单不能带到下一个请求 */
+    m_check_state = CHECK_STATE_REQUESTLINE;
+    request.reset();
+    response.reset_for_keepalive();
+    return keepalive;
+}
+
+/**
+ * @brief Upgrade: h2c + HTTP2-Settings: 回复101后切换到HTTP/2，当前请求的响应在流1上返回
+ * @return 是否已切换
+ */
+bool http_session::upgrade_h2c() {
+    http_slice upgrade = request.get_header("Upgrade");
+    /* h2c只用于明文连接，HTTPS上的HTTP/2由ALPN协商 */
+    if(m_tls.active() || upgrade.len != 3 || strncasecmp(upgrade.data, "h2c", 3) != 0
+       || !request.get_version().equals("1.1", 3)) {
+        return false;
+    }
+    std::string settings;
+    if(!h2_session::base64url_decode(request.get_header("HTTP2-Settings").to_string(), settings)
+       || settings.size() % 6 != 0) {
+        return false;
+    }
+    dispatch(request, response, true, true);
+    std::string head;
+    response.build_response(head);
+    std::unique_ptr<h2_session> h2(new h2_session());
+    if(!h2->start_upgrade(settings, head, response)) {
+        response.reset_for_keepalive();
+        return false;
+    }
+    push_response().head = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+    m_h2 = std::move(h2);
+    m_check_state = CHECK_STATE_REQUESTLINE;
+    request.reset();
+    response.reset_for_keepalive();
     return true;
 }
 
+void http_session::dispatch(http_request& request, http_response& response, bool keepalive, bool chunked) {
+    const std::string& path = request.get_path();
+    if(path == METRICS_PATH) {
+        /* 按分段生成，响应头和已生成的部分先发出 */
+        int part = 0;
+        response.set_stream_info(200, "text/plain; version=0.0.4; charset=utf-8",
+                                 [part](std::string& out) mutable {
+                                     return metrics::get_instance()->render_part(part++, out);
+                                 },
+                                 keepalive, chunked);
+    } else {
+        response.set_range(request.get_range());
+        response.set_conditions(request.get_if_none_match(), request.get_if_modified_since(), request.get_if_range());
+        response.set_finish_info(path, keepalive, request.accept_gzip());
+    }
+}
+
+pending_response& http_session::push_response() {
+    m_responses.emplace_back();
+    return m_responses.back();
+}
+
 void http_session::reset_for_keepalive() {
-    m_read_idx = 0;
-    m_checked_idx = 0;
-    m_start_line = 0;
-    iov_cnt = 0;
-    bytes_to_send = 0;
-    bytes_have_send = 0;
+    m_read_buf.clear();
+    for(size_t i = 0; i < m_responses.size(); ++i) {
+        if(m_responses[i].own_file) {
+            close(m_responses[i].file_fd);
+        }
+    }
+    m_responses.clear();
+    m_resp_idx = 0;
+    m_head_arena.clear();
+    m_h2.reset();
     m_check_state = CHECK_STATE_REQUESTLINE;
-    memset(m_read_buf, '\0', READ_BUFFER_SIZE);
+    reset_chunked();
+    clear_classified();
 
+    request.reset();
     response.reset_for_keepalive();
 }
+
+/**
+ * @brief 生成响应中未发送的内存段，返回iovec个数(最多4个)
+ */
+int http_session::fill_iov(const pending_response& rsp, struct iovec* iov) const {
+    const char* parts[4] = { nullptr, m_head_arena.data() + rsp.arena_off, rsp.head.data(), rsp.body };
+    size_t sizes[4] = { 0, rsp.arena_len, rsp.head.size(), rsp.body_len };
+    if(rsp.cached_head) {
+        parts[0] = rsp.cached_head->data();
+        sizes[0] = rsp.cached_head->size();
+    }
+
+    size_t skip = rsp.mem_sent;
+    int iov_cnt = 0;
+    for(int i = 0; i < 4; ++i) {
+        if(skip >= sizes[i]) {
+            skip -= sizes[i];
+            continue;
+        }
+        iov[iov_cnt].iov_base = const_cast<char*>(parts[i] + skip);
+        iov[iov_cnt].iov_len = sizes[i] - skip;
+        iov_cnt++;
+        skip = 0;
+    }
+    return iov_cnt;
+}
+
+/**
+ * @brief sendmsg发送了len字节，依次推进各响应的内存部分
+ */
+void http_session::consume_iov(size_t len) {
+    for(size_t i = m_resp_idx; len > 0 && i < m_responses.size(); ++i) {
+        pending_response& rsp = m_responses[i];
+        size_t step = std::min(len, mem_len(rsp) - rsp.mem_sent);
+        rsp.mem_sent += step;
+        len -= step;
+    }
+}
+
+size_t http_session::mem_len(const pending_response& rsp) const {
+    return (rsp.cached_head ? rsp.cached_head->size() : 0) + rsp.arena_len + rsp.head.size() + rsp.body_len;
+}
\ No newline at end of file
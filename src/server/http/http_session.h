@@ -2,13 +2,54 @@
 #define _HTTP_SESSION_H
 
 #include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
 
+#include "chain_buffer.h"
+#include "http_chunked.h"
+#include "http_parser.h"
 #include "http_request.h"
 #include "http_response.h"
-#include "../epoll/epoller.h"
+#include "tls_context.h"
+#include "../epoll/poller.h"
 
-constexpr int READ_BUFFER_SIZE  = 20480;
-constexpr int WRITE_BUFFER_SIZE = 10240;
+class h2_session;
+
+constexpr size_t MAX_REQUEST_SIZE = 1 << 20;   // 单个请求(请求头 + body)的上限
+constexpr size_t MAX_PIPELINE = 128;            // 一批最多处理的流水线请求数
+constexpr int    MAX_BATCH_IOV = 128;           // 一次sendmsg最多携带的iovec数
+constexpr size_t HEAD_ARENA_SIZE = 4096;        // 响应头缓冲区的初始容量，一批响应发送完后复用
+
+
+/**
+ * @brief 等待发送的响应(或206多段响应中的一段):
+ *  内存部分(缓存的响应头 + 响应头缓冲区中的片段 + head + 缓存内容的片段) + 可选的文件窗口(sendfile)
+ * iovec在发送时才根据mem_sent生成，响应头缓冲区扩容或vector扩容移动head后依然有效
+ * 流式响应在内存部分发送完后由producer生成下一段放入head，直到producer结束
+ */
+struct pending_response {
+    static_cache::entry_ptr cached;     // 持有缓存条目，保证cached_head/body有效
+    const std::string* cached_head;     // 预序列化的headers[keepalive]，不含Date头与结尾的空行
+    size_t arena_off;                   // 在session响应头缓冲区中的片段: 响应头(错误响应包含内容)、分段头
+    size_t arena_len;
+    std::string head;                   // 自身持有的内容: 流式响应生成的段、HTTP/2帧
+    const char* body;                   // 缓存内容中要发送的片段
+    size_t body_len;
+    bool   keepalive;                   // false: 发送完后关闭连接
+    size_t mem_sent;
+    int    file_fd;
+    bool   own_file;                    // 多段共用一个fd，由最后一段负责close
+    off_t  file_offset;
+    size_t file_remain;
+    body_producer producer;             // 非空时还有内容未生成
+    bool   chunked;                     // 生成的内容需要chunked编码
+
+    pending_response(): cached_head(nullptr), arena_off(0), arena_len(0), body(nullptr), body_len(0),
+                        keepalive(true), mem_sent(0), file_fd(-1), own_file(false), file_offset(0), file_remain(0), chunked(false) {}
+};
 
 class http_session {
 public: 
@@ -21,45 +62,160 @@ public:
         CHECK_STATE_ERROR
     };
 
+    enum READ_RESULT
+    {
+        READ_CLOSE = 0,     // 出错或对端关闭
+        READ_DATA,          // 交给process处理
+        READ_WAIT           // TLS握手未完成或记录不完整，已重新注册事件
+    };
+
+    enum WRITE_RESULT
+    {
+        WRITE_CLOSE = 0,    // 出错或非keep-alive的响应已发送完
+        WRITE_DONE,         // 已重新注册事件(等待可写或可读)，完成模式下或已提交发送
+        WRITE_PENDING       // 响应已发送完，读缓冲区中还有请求，未注册事件，由reactor决定在哪个线程处理
+    };
+
 public:
-    http_session(int fd_, uint32_t event, std::shared_ptr<epoller>& epl);
+    http_session();
+    http_session(int fd_, uint32_t event, std::shared_ptr<poller>& epl, uint64_t data);
     http_session(const http_session&) = delete;
     http_session& operator=(const http_session&) = delete;
-    ~http_session() = default;
+    ~http_session();
+
+    /**
+     * @brief 绑定到新连接(session_pool复用)
+     * @param data 注册到poller的数据(fd + 连接代数)，重新注册事件时原样带上
+     */
+    void init(int fd_, uint32_t event, std::shared_ptr<poller>& epl, uint64_t data);
+
+    /**
+     * @brief 连接关闭后归还到池中前调用，释放文件等资源，保留缓冲区容量
+     */
+    void recycle();
+
+    /**
+     * @brief HTTPS连接: 之后的读写都经过TLS，握手在reactor中随读写事件非阻塞地推进
+     */
+    bool start_tls(tls_context* ctx);
 
-    bool read_buf();
-    void process();
-    bool write_buf();
+    READ_RESULT read_buf();
+
+    /**
+     * @brief io_uring完成模式(只用于明文连接): 数据由reactor从multishot recv的完成事件中交给feed，
+     * 发送提交给poller，完成事件由reactor交给send_done后再调用write_buf继续发送
+     */
+    void use_completion_io() { m_completion_io = true; }
+    bool completion_io() const { return m_completion_io; }
+
+    /**
+     * @brief 追加接收到的数据，超过请求上限的部分丢弃，由process返回错误
+     */
+    void feed(const char* data, size_t len);
+
+    /**
+     * @brief 处理send_msg的完成事件
+     * @return false 发送出错，需要关闭连接
+     */
+    bool send_done(int res);
+
+    /* 发送提交给内核尚未完成，期间不能修改待发送的响应，连接也不能close */
+    bool sending() const { return m_sending; }
+
+    /* 还有响应未发送完(包括等待可写的文件部分)，新到达的请求留在读缓冲区中，发送完后由write_buf返回WRITE_PENDING */
+    bool write_pending() const { return m_sending || m_resp_idx < m_responses.size(); }
+
+    /**
+     * @brief 读缓冲区中完整的请求都是命中静态缓存(无需校验)的简单GET: 没有body、不升级协议，
+     * 处理只需查缓存和拼接响应，可以直接在reactor线程调用process
+     * 返回true时保留解析结果与查到的缓存条目，紧接着的process直接使用，不再解析和查找
+     */
+    bool inline_ready();
+
+    /**
+     * @brief 可以在worker线程调用，不修改poller注册
+     * @return true 有待发送的响应，由reactor调用write_buf发送; false 请求不完整，需要等待可读
+     */
+    bool process();
+    WRITE_RESULT write_buf();
+
+    /**
+     * @brief 按路径生成响应(/metrics或静态文件)，HTTP/1.1与HTTP/2的流共用
+     */
+    static void dispatch(http_request& request, http_response& response, bool keepalive, bool chunked);
 
 private:
-    void process_read_buf();
-    bool parse_line();
-    bool parse_request_line(std::string&);
-    bool parse_headers(std::string&);
-    bool parse_content(std::string&);
+    void rearm(uint32_t events);
+    READ_RESULT read_tls();
+    ssize_t send_iov(struct iovec* iov, int iov_cnt, int flags);
+    ssize_t send_file(pending_response& rsp);
+    void process_read_buf(const char* data, size_t len, size_t& used);
+    void apply_classified(size_t idx, size_t& used);
+    void clear_classified();
+    bool parse_content(const char* body, size_t len);
+    void next_chunk(pending_response& rsp);
+    void reset_chunked();
+    bool add_response();
+    bool upgrade_h2c();
+    pending_response& push_response();
     void reset_for_keepalive();
+    bool submit_send(int iov_cnt, int flags);
+    int  fill_iov(const pending_response& rsp, struct iovec* iov) const;
+    void consume_iov(size_t len);
+    size_t mem_len(const pending_response& rsp) const;
 
 private:
     int fd;
     uint32_t conn_event;
-    std::shared_ptr<epoller> epler_;
+    std::shared_ptr<poller> epler_;
+    uint64_t ev_data;
+
+    // read buffer: 按需从块池取块，请求处理完后归还
+    chain_buffer m_read_buf;
 
-    // read buffer
-    char m_read_buf[READ_BUFFER_SIZE];
-    int  m_read_idx;
-    int  m_checked_idx;
-    int  m_start_line;
+    // chunked请求体: 跨多次读取保存解码进度，收到更多数据后只解码新到达的部分
+    chunked_decoder m_chunked;
+    size_t m_chunked_used;            // 已解码的body字节数(编码后)
+    std::string m_chunked_body;
 
-    // write buffer
-    int iov_cnt;
-    struct iovec iov_vec[2];
-    int bytes_to_send;
-    int bytes_have_send;
+    // write queue: 流水线请求的响应按顺序排队，连续的内存部分合并为一次sendmsg，文件部分走sendfile
+    std::vector<pending_response> m_responses;
+    size_t m_resp_idx;                // 第一个未发送完的响应
+    // 本批响应的响应头都追加在这里，响应按偏移引用；全部发送完后清空，保留容量
+    std::string m_head_arena;
+    std::string m_chunk_buf;          // 流式响应生成内容的暂存区，复用容量
+
+    // inline_ready的分类结果: 片段指向读缓冲区，请求头连续存放在m_classified_headers中
+    struct classified_request {
+        http_slice method;
+        http_slice path;
+        http_slice version;
+        size_t header_off;
+        size_t header_num;
+        size_t consumed;
+        static_cache::entry_ptr entry;
+    };
+    std::vector<classified_request> m_classified;
+    std::vector<http_header_slice> m_classified_headers;
+    const char* m_classified_data;    // 分类时缓冲区的起点与长度，process时不一致则重新解析
+    size_t m_classified_len;
 
     CHECK_STATE   m_check_state;
     http_request  request;
     http_response response;
 
+    // 一次发送的iovec，完成模式下提交后内核异步读取，需要保持到完成事件返回
+    struct iovec m_send_iov[MAX_BATCH_IOV];
+    struct msghdr m_send_msg;
+    bool m_completion_io;
+    bool m_sending;
+
+    // HTTPS连接的TLS状态，kTLS生效时发送仍直接使用sendmsg/sendfile
+    tls_connection m_tls;
+
+    // 切换到HTTP/2后非空，之后的读写都交给它
+    std::unique_ptr<h2_session> m_h2;
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef _HTTP_TABLES_H
+#define _HTTP_TABLES_H
+
+#include "../../utils/perfect_hash.h"
+
+/**
+ * @brief 请求路由、MIME类型与状态码的编译期完美哈希表，查找时键直接指向请求缓冲区或路径，不分配内存
+ */
+namespace http_tables {
+
+using perfect_hash::str_view;
+using perfect_hash::view;
+
+struct mime_type {
+    str_view type;
+    bool compressible;      // 文本类内容，可以gzip
+};
+
+/* 省略了".html"的默认页面 */
+constexpr perfect_hash::entry<str_view, str_view> ROUTE_ENTRIES[] = {
+    { view("/"),         view("/index.html") },
+    { view("/index"),    view("/index.html") },
+    { view("/register"), view("/register.html") },
+    { view("/login"),    view("/login.html") },
+    { view("/welcome"),  view("/welcome.html") },
+    { view("/video"),    view("/video.html") },
+    { view("/picture"),  view("/picture.html") },
+};
+
+/* 表单提交的页面: 0 注册，1 登录 */
+constexpr perfect_hash::entry<str_view, int> FORM_ENTRIES[] = {
+    { view("/register.html"), 0 },
+    { view("/login.html"),    1 },
+};
+
+constexpr perfect_hash::entry<str_view, mime_type> MIME_ENTRIES[] = {
+    { view(".html"),  { view("text/html"), true } },
+    { view(".xml"),   { view("text/xml"), true } },
+    { view(".xhtml"), { view("application/xhtml+xml"), true } },
+    { view(".txt"),   { view("text/plain"), true } },
+    { view(".rtf"),   { view("application/rtf"), false } },
+    { view(".pdf"),   { view("application/pdf"), false } },
+    { view(".word"),  { view("application/nsword"), false } },
+    { view(".png"),   { view("image/png"), false } },
+    { view(".gif"),   { view("image/gif"), false } },
+    { view(".jpg"),   { view("image/jpeg"), false } },
+    { view(".jpeg"),  { view("image/jpeg"), false } },
+    { view(".au"),    { view("audio/basic"), false } },
+    { view(".mpeg"),  { view("video/mpeg"), false } },
+    { view(".mpg"),   { view("video/mpeg"), false } },
+    { view(".avi"),   { view("video/x-msvideo"), false } },
+    { view(".gz"),    { view("application/x-gzip"), false } },
+    { view(".tar"),   { view("application/x-tar"), false } },
+    { view(".css"),   { view("text/css"), true } },
+    { view(".js"),    { view("text/javascript"), true } },
+    { view(".svg"),   { view("image/svg+xml"), true } },
+    { view(".ico"),   { view("image/x-icon"), false } },
+    { view(".ttf"),   { view("font/ttf"), true } },
+    { view(".otf"),   { view("font/otf"), true } },
+    { view(".woff"),  { view("font/woff"), false } },
+    { view(".woff2"), { view("font/woff2"), false } },
+    { view(".eot"),   { view("application/vnd.ms-fontobject"), true } },
+};
+
+/* 未知后缀按纯文本处理 */
+constexpr mime_type DEFAULT_MIME = { view("text/plain"), true };
+
+/* 状态行预先格式化，生成响应头时整段复制 */
+struct status_line {
+    str_view reason;
+    str_view line;          // "HTTP/1.1 <code> <reason>\r\n"
+};
+
+constexpr perfect_hash::entry<int, status_line> STATUS_ENTRIES[] = {
+    { 200, { view("OK"),                    view("HTTP/1.1 200 OK\r\n") } },
+    { 206, { view("Partial Content"),       view("HTTP/1.1 206 Partial Content\r\n") } },
+    { 304, { view("Not Modified"),          view("HTTP/1.1 304 Not Modified\r\n") } },
+    { 400, { view("Bad Request"),           view("HTTP/1.1 400 Bad Request\r\n") } },
+    { 403, { view("Forbidden"),             view("HTTP/1.1 403 Forbidden\r\n") } },
+    { 404, { view("Not Found"),             view("HTTP/1.1 404 Not Found\r\n") } },
+    { 416, { view("Range Not Satisfiable"), view("HTTP/1.1 416 Range Not Satisfiable\r\n") } },
+};
+
+/* 以页面代替默认错误内容的状态码 */
+constexpr perfect_hash::entry<int, str_view> ERROR_PAGE_ENTRIES[] = {
+    { 400, view("/400.html") },
+    { 403, view("/403.html") },
+    { 404, view("/404.html") },
+};
+
+constexpr auto ROUTES = perfect_hash::make_table<16>(ROUTE_ENTRIES);
+constexpr auto FORMS = perfect_hash::make_table<4>(FORM_ENTRIES);
+constexpr auto MIME_TYPES = perfect_hash::make_table<64>(MIME_ENTRIES);
+constexpr auto STATUS_TEXT = perfect_hash::make_table<16>(STATUS_ENTRIES);
+constexpr auto ERROR_PAGES = perfect_hash::make_table<8>(ERROR_PAGE_ENTRIES);
+
+static_assert(ROUTES.valid() && FORMS.valid() && MIME_TYPES.valid() && STATUS_TEXT.valid() && ERROR_PAGES.valid(),
+              "no perfect hash seed found, enlarge the slot count");
+
+}
+
+#endif
\ No newline at end of file
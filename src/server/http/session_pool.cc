@@ -0,0 +1,44 @@
+#include "session_pool.h"
+
+
+void session_ptr::reset() {
+    if(node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        node->pool->release(node);
+    }
+    node = nullptr;
+}
+
+
+session_pool::session_pool(size_t max_idle): idle(max_idle), created(0), reused(0) {}
+
+session_pool::~session_pool() {
+    session_node* node = nullptr;
+    while(idle.pop(node)) {
+        delete node;
+    }
+}
+
+session_ptr session_pool::acquire(int fd, uint32_t event, std::shared_ptr<poller>& epl, uint64_t data) {
+    session_node* node = nullptr;
+    if(idle.pop(node)) {
+        reused.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        node = new session_node();
+        node->pool = this;
+        created.fetch_add(1, std::memory_order_relaxed);
+    }
+    node->session.init(fd, event, epl, data);
+    return session_ptr(node);
+}
+
+void session_pool::release(session_node* node) {
+    node->session.recycle();
+    if(!idle.push(node)) {
+        delete node;
+    }
+}
+
+session_pool::pool_stats session_pool::stats() const {
+    pool_stats res = {created.load(std::memory_order_relaxed), reused.load(std::memory_order_relaxed)};
+    return res;
+}
\ No newline at end of file
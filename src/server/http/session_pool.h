@@ -0,0 +1,97 @@
+#ifndef _SESSION_POOL_H
+#define _SESSION_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "http_session.h"
+#include "../../pool/thread_pool.h"
+
+class session_pool;
+
+/**
+ * @brief 池化的session节点，引用计数内嵌在节点中，发放/回收都不需要额外分配控制块
+ */
+struct session_node {
+    http_session session;
+    std::atomic<int> refs;
+    session_pool* pool;
+
+    session_node(): refs(0), pool(nullptr) {}
+};
+
+
+/**
+ * @brief 指向池中session的侵入式引用计数指针，用法与std::shared_ptr<http_session>相同
+ * reactor的连接表与线程池中的任务各持有一份，最后一份释放时session回到池中
+ */
+class session_ptr {
+public:
+    session_ptr(): node(nullptr) {}
+
+    explicit session_ptr(session_node* n): node(n) {
+        if(node) {
+            node->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    session_ptr(const session_ptr& other): session_ptr(other.node) {}
+
+    session_ptr(session_ptr&& other): node(other.node) {
+        other.node = nullptr;
+    }
+
+    session_ptr& operator=(session_ptr other) {
+        std::swap(node, other.node);
+        return *this;
+    }
+
+    ~session_ptr() {
+        reset();
+    }
+
+    void reset();
+
+    http_session* get() const { return node ? &node->session : nullptr; }
+    http_session* operator->() const { return &node->session; }
+    http_session& operator*() const { return node->session; }
+    explicit operator bool() const { return node != nullptr; }
+
+private:
+    session_node* node;
+};
+
+
+/**
+ * @brief http_session对象池
+ *  1. 空闲节点放在无锁队列中，reactor线程取用，最后释放引用的线程(reactor或worker)归还
+ *  2. 归还时只重置游标和状态，读缓冲区不清零，request/response中的容器保留容量
+ *  3. 空闲节点超过max_idle时直接释放，避免连接高峰过后长期占用内存
+ */
+class session_pool {
+public:
+    struct pool_stats {
+        uint64_t created;
+        uint64_t reused;
+    };
+
+public:
+    explicit session_pool(size_t max_idle = 256);
+    ~session_pool();
+    session_pool(const session_pool&) = delete;
+    session_pool& operator=(const session_pool&) = delete;
+
+    session_ptr acquire(int fd, uint32_t event, std::shared_ptr<poller>& epl, uint64_t data);
+
+    void release(session_node* node);
+
+    pool_stats stats() const;
+
+private:
+    lockfree_ring<session_node*> idle;
+    std::atomic<uint64_t> created;
+    std::atomic<uint64_t> reused;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <chrono>
+#include <functional>
+
+#include "static_cache.h"
+#include "../metrics.h"
+
+namespace {
+
+class read_guard {
+public:
+    explicit read_guard(pthread_rwlock_t& lock): lock_(lock) { pthread_rwlock_rdlock(&lock_); }
+    ~read_guard() { pthread_rwlock_unlock(&lock_); }
+private:
+    pthread_rwlock_t& lock_;
+};
+
+class write_guard {
+public:
+    explicit write_guard(pthread_rwlock_t& lock): lock_(lock) { pthread_rwlock_wrlock(&lock_); }
+    ~write_guard() { pthread_rwlock_unlock(&lock_); }
+private:
+    pthread_rwlock_t& lock_;
+};
+
+}
+
+
+static_cache::static_cache(): budget(0), max_entry(0), revalidate(1000) {}
+
+static_cache* static_cache::get_instance() {
+    static static_cache instance;
+    return &instance;
+}
+
+void static_cache::init(size_t budget_bytes, size_t max_entry_bytes, int revalidate_ms) {
+    budget = budget_bytes;
+    max_entry = max_entry_bytes;
+    revalidate = revalidate_ms;
+}
+
+bool static_cache::cacheable(off_t file_size) const {
+    /* 单个条目不超过分片预算，避免一个大文件把整个分片清空 */
+    return enabled() && file_size >= 0 && static_cast<size_t>(file_size) <= max_entry
+        && static_cast<size_t>(file_size) <= budget / SHARD_NUM;
+}
+
+static_cache::entry_ptr static_cache::lookup(const std::string& path, bool& need_revalidate) {
+    need_revalidate = false;
+    if(!enabled()) {
+        return nullptr;
+    }
+    shard& s = shard_of(path);
+    entry_ptr entry;
+    {
+        read_guard locker(s.lock);
+        auto it = s.index.find(path);
+        if(it != s.index.end()) {
+            entry = it->second;
+        }
+    }
+    if(!entry) {
+        metrics::add(METRIC_CACHE_MISSES);
+        return nullptr;
+    }
+    hit(entry);
+    need_revalidate = now_ms() - entry->checked_ms.load(std::memory_order_relaxed) > revalidate;
+    return entry;
+}
+
+static_cache::entry_ptr static_cache::fresh(const std::string& path) {
+    if(!enabled()) {
+        return nullptr;
+    }
+    shard& s = shard_of(path);
+    entry_ptr entry;
+    {
+        read_guard locker(s.lock);
+        auto it = s.index.find(path);
+        if(it == s.index.end() || it->second->code != 200) {
+            return nullptr;
+        }
+        entry = it->second;
+    }
+    if(now_ms() - entry->checked_ms.load(std::memory_order_relaxed) > revalidate) {
+        return nullptr;
+    }
+    return entry;
+}
+
+void static_cache::hit(const entry_ptr& entry) {
+    metrics::add(METRIC_CACHE_HITS);
+    /* 同一毫秒内的命中不再写，热点条目的缓存行不在reactor之间来回传递 */
+    int64_t now = now_ms();
+    if(entry->used_ms.load(std::memory_order_relaxed) != now) {
+        entry->used_ms.store(now, std::memory_order_relaxed);
+    }
+}
+
+static_cache::entry_ptr static_cache::insert(const std::string& path, int code, std::string body,
+                                             const std::string& header_close, const std::string& header_keepalive,
+                                             const struct stat& file_stat, entry_ptr gzip) {
+    std::shared_ptr<static_entry> entry = make_entry(code, std::move(body), header_close, header_keepalive, file_stat);
+    entry->gzip = std::move(gzip);
+    return insert(path, std::move(entry));
+}
+
+static_cache::entry_ptr static_cache::insert(const std::string& path, std::shared_ptr<static_entry> entry) {
+    if(!enabled()) {
+        return entry;
+    }
+
+    size_t size = entry_bytes(*entry);
+    size_t shard_budget = budget / SHARD_NUM;
+    shard& s = shard_of(path);
+    write_guard locker(s.lock);
+    auto it = s.index.find(path);
+    if(it != s.index.end()) {
+        remove(s, it);
+    }
+    while(!s.index.empty() && s.bytes + size > shard_budget) {
+        auto victim = s.index.begin();
+        for(auto cur = s.index.begin(); cur != s.index.end(); ++cur) {
+            if(cur->second->used_ms.load(std::memory_order_relaxed)
+               < victim->second->used_ms.load(std::memory_order_relaxed)) {
+                victim = cur;
+            }
+        }
+        remove(s, victim);
+        s.evictions++;
+    }
+    if(s.bytes + size <= shard_budget) {
+        entry->used_ms.store(now_ms(), std::memory_order_relaxed);
+        s.index.emplace(path, entry);
+        s.bytes += size;
+    }
+    return entry;
+}
+
+std::shared_ptr<static_entry> static_cache::make_entry(int code, std::string body,
+                                                      const std::string& header_close,
+                                                      const std::string& header_keepalive,
+                                                      const struct stat& file_stat) {
+    std::shared_ptr<static_entry> entry = std::make_shared<static_entry>();
+    entry->code = code;
+    entry->body = std::move(body);
+    entry->headers[0] = header_close;
+    entry->headers[1] = header_keepalive;
+    entry->file_stat = file_stat;
+    entry->checked_ms.store(now_ms(), std::memory_order_relaxed);
+    entry->used_ms.store(0, std::memory_order_relaxed);
+    return entry;
+}
+
+void static_cache::touch(const entry_ptr& entry) {
+    entry->checked_ms.store(now_ms(), std::memory_order_relaxed);
+}
+
+void static_cache::erase(const std::string& path) {
+    shard& s = shard_of(path);
+    write_guard locker(s.lock);
+    auto it = s.index.find(path);
+    if(it != s.index.end()) {
+        remove(s, it);
+    }
+}
+
+static_cache::cache_stats static_cache::stats() {
+    metrics* m = metrics::get_instance();
+    cache_stats res = {m->counter(METRIC_CACHE_HITS), m->counter(METRIC_CACHE_MISSES), 0, 0, 0};
+    for(size_t i = 0; i < SHARD_NUM; ++i) {
+        read_guard locker(shards[i].lock);
+        res.evictions += shards[i].evictions;
+        res.bytes += shards[i].bytes;
+        res.entries += shards[i].index.size();
+    }
+    return res;
+}
+
+int64_t static_cache::now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * private method
+ */
+
+static_cache::shard::shard() {
+    /* 读者持续不断时glibc默认的读优先会让插入一直等待 */
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+}
+
+static_cache::shard::~shard() {
+    pthread_rwlock_destroy(&lock);
+}
+
+static_cache::shard& static_cache::shard_of(const std::string& path) {
+    return shards[std::hash<std::string>()(path) % SHARD_NUM];
+}
+
+void static_cache::remove(shard& s, std::unordered_map<std::string, entry_ptr>::iterator it) {
+    s.bytes -= entry_bytes(*it->second);
+    s.index.erase(it);
+}
+
+size_t static_cache::entry_bytes(const static_entry& entry) {
+    size_t bytes = entry.body.size() + entry.headers[0].size() + entry.headers[1].size()
+                 + entry.etag.size() + entry.last_modified.size();
+    if(entry.gzip) {
+        bytes += entry_bytes(*entry.gzip);
+    }
+    return bytes;
+}
@@ -0,0 +1,138 @@
+#ifndef _STATIC_CACHE_H
+#define _STATIC_CACHE_H
+
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief 缓存的静态响应: 文件内容 + 按keep-alive区分的预序列化响应头
+ * 命中时响应即为 headers[keepalive] + body 两段内存，无需stat/open/格式化
+ */
+struct static_entry {
+    int code;
+    std::string body;
+    std::string headers[2];        // [0]: Connection: close, [1]: keep-alive
+    struct stat file_stat;
+    std::string etag;              // 与file_stat一起缓存，条件请求无需stat
+    std::string last_modified;
+
+    mutable std::atomic<int64_t> checked_ms;   // 上次确认与磁盘一致的时间
+    mutable std::atomic<int64_t> used_ms;      // 最近一次命中的时间，淘汰时用作近似LRU
+
+    std::shared_ptr<const static_entry> gzip;  // 可压缩文本的gzip变体，随原条目一起校验和淘汰
+};
+
+
+/**
+ * @brief 进程内共享、读多写少的静态文件缓存，以解析后的请求路径为key
+ *  1. 按路径hash分片，每个分片一把读写锁: 命中只加读锁，不修改分片内的任何数据；
+ *     插入、淘汰、删除才加写锁
+ *  2. 命中时只在时间变化后写一次条目的used_ms(relaxed)，代替移动LRU链表
+ *  3. 总字节数受budget限制，超出时淘汰分片内used_ms最小的条目(近似LRU，只在插入时扫描)
+ *  4. 命中/未命中计入metrics的线程本地计数，不写共享的缓存行
+ *  5. 条目超过revalidate_ms未校验时由调用方stat确认，文件变化后重新加载
+ */
+class static_cache {
+public:
+    struct cache_stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t   bytes;
+        size_t   entries;
+    };
+
+    typedef std::shared_ptr<const static_entry> entry_ptr;
+
+public:
+    static static_cache* get_instance();
+
+    /**
+     * @param budget_bytes    缓存总字节数上限，0表示关闭缓存
+     * @param max_entry_bytes 单个文件超过该大小不缓存(走sendfile)
+     * @param revalidate_ms   条目校验间隔
+     */
+    void init(size_t budget_bytes, size_t max_entry_bytes, int revalidate_ms);
+
+    bool enabled() const { return budget > 0; }
+
+    bool cacheable(off_t file_size) const;
+
+    /**
+     * @brief 查找缓存，need_revalidate为true时调用方需要stat确认后调用touch
+     */
+    entry_ptr lookup(const std::string& path, bool& need_revalidate);
+
+    /**
+     * @brief 返回无需校验即可使用的200条目，没有时为空；不计入命中统计，也不调整LRU
+     *  调用方之后实际使用该条目时调用hit
+     */
+    entry_ptr fresh(const std::string& path);
+
+    /**
+     * @brief 记录一次命中: 计入统计并更新条目的used_ms，lookup内部也使用
+     */
+    static void hit(const entry_ptr& entry);
+
+    entry_ptr insert(const std::string& path, int code, std::string body,
+                     const std::string& header_close, const std::string& header_keepalive,
+                     const struct stat& file_stat, entry_ptr gzip = entry_ptr());
+
+    /**
+     * @brief 插入调用方用make_entry构造并补充了验证器/gzip变体的条目
+     */
+    entry_ptr insert(const std::string& path, std::shared_ptr<static_entry> entry);
+
+    /**
+     * @brief 构造不进入缓存的条目，用于gzip变体
+     */
+    static std::shared_ptr<static_entry> make_entry(int code, std::string body,
+                                                    const std::string& header_close,
+                                                    const std::string& header_keepalive,
+                                                    const struct stat& file_stat);
+
+    void touch(const entry_ptr& entry);
+
+    void erase(const std::string& path);
+
+    cache_stats stats();
+
+    static int64_t now_ms();
+
+private:
+    static_cache();
+    ~static_cache() = default;
+    static_cache(const static_cache&) = delete;
+    static_cache& operator=(const static_cache&) = delete;
+
+    static const size_t SHARD_NUM = 16;
+
+    /* 按cache line对齐，相邻分片的锁不共享缓存行 */
+    struct alignas(64) shard {
+        pthread_rwlock_t lock;
+        std::unordered_map<std::string, entry_ptr> index;
+        size_t bytes = 0;
+        uint64_t evictions = 0;
+
+        shard();
+        ~shard();
+    };
+
+    shard& shard_of(const std::string& path);
+    /* 调用方持有写锁 */
+    static void remove(shard& s, std::unordered_map<std::string, entry_ptr>::iterator it);
+    static size_t entry_bytes(const static_entry& entry);
+
+private:
+    size_t budget;
+    size_t max_entry;
+    int revalidate;
+    shard shards[SHARD_NUM];
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <unistd.h>
+
+#include <openssl/err.h>
+
+#include "tls_context.h"
+#include "../metrics.h"
+#include "../../logger/log.h"
+
+namespace {
+
+/* ALPN按服务端顺序优先: h2 > http/1.1 */
+const unsigned char ALPN_PROTOS[] = "\x02h2\x08http/1.1";
+
+std::string last_error() {
+    unsigned long err = ERR_get_error();
+    if(err == 0) {
+        return "unknown error";
+    }
+    char buf[256];
+    ERR_error_string_n(err, buf, sizeof(buf));
+    return buf;
+}
+
+}
+
+
+tls_context::tls_context(): ctx(nullptr) {}
+
+tls_context::~tls_context() {
+    if(ctx) {
+        SSL_CTX_free(ctx);
+    }
+}
+
+bool tls_context::init(const std::string& cert_file, const std::string& key_file, long cache_size, long timeout_s) {
+    ctx = SSL_CTX_new(TLS_server_method());
+    if(ctx == nullptr) {
+        LOG_ERROR("tls: create context failed: %s", last_error().c_str());
+        return false;
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_options(ctx, SSL_OP_NO_RENEGOTIATION | SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_NO_COMPRESSION
+                           | SSL_OP_IGNORE_UNEXPECTED_EOF | SSL_OP_ENABLE_KTLS);
+    /* 非阻塞写: 每写出一条记录即返回，EAGAIN后重试时缓冲区地址可以变化(发送队列的vector可能扩容) */
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER
+                        | SSL_MODE_RELEASE_BUFFERS);
+
+    if(SSL_CTX_use_certificate_chain_file(ctx, cert_file.c_str()) != 1
+       || SSL_CTX_use_PrivateKey_file(ctx, key_file.c_str(), SSL_FILETYPE_PEM) != 1
+       || SSL_CTX_check_private_key(ctx) != 1) {
+        LOG_ERROR("tls: load certificate %s / key %s failed: %s", cert_file.c_str(), key_file.c_str(),
+                  last_error().c_str());
+        SSL_CTX_free(ctx);
+        ctx = nullptr;
+        return false;
+    }
+
+    /* 会话恢复: 服务端会话缓存 + 票据，TLS 1.3只发一张票据 */
+    static const unsigned char SESSION_ID_CONTEXT[] = "simplest-web-server";
+    SSL_CTX_set_session_id_context(ctx, SESSION_ID_CONTEXT, sizeof(SESSION_ID_CONTEXT) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, cache_size);
+    SSL_CTX_set_timeout(ctx, timeout_s);
+    SSL_CTX_set_num_tickets(ctx, 1);
+
+    SSL_CTX_set_alpn_select_cb(ctx, select_alpn, nullptr);
+    LOG_INFO("tls: certificate %s loaded, session cache size: %ld, timeout: %lds", cert_file.c_str(),
+             cache_size, timeout_s);
+    return true;
+}
+
+
+/**
+ * private method
+ */
+
+int tls_context::select_alpn(SSL* ssl, const unsigned char** out, unsigned char* outlen,
+                             const unsigned char* in, unsigned int inlen, void* arg) {
+    unsigned char* selected = nullptr;
+    if(SSL_select_next_proto(&selected, outlen, ALPN_PROTOS, sizeof(ALPN_PROTOS) - 1,
+                             in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+
+tls_connection::tls_connection(): ssl(nullptr), established(false), ktls(false) {}
+
+tls_connection::~tls_connection() {
+    detach();
+}
+
+bool tls_connection::attach(tls_context* ctx, int fd) {
+    detach();
+    ssl = SSL_new(ctx->get());
+    if(ssl == nullptr || SSL_set_fd(ssl, fd) != 1) {
+        LOG_ERROR("tls: fd: %d, create connection failed: %s", fd, last_error().c_str());
+        detach();
+        return false;
+    }
+    SSL_set_accept_state(ssl);
+    return true;
+}
+
+void tls_connection::detach() {
+    if(ssl) {
+        /* 不写close_notify，但标记为已关闭，避免OpenSSL把会话当作异常中断从缓存中移除 */
+        SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+        SSL_free(ssl);
+        ssl = nullptr;
+    }
+    established = false;
+    ktls = false;
+}
+
+tls_connection::TLS_RESULT tls_connection::handshake() {
+    ERR_clear_error();
+    int ret = SSL_do_handshake(ssl);
+    if(ret == 1) {
+        established = true;
+        ktls = BIO_get_ktls_send(SSL_get_wbio(ssl)) != 0;
+        metrics::add(resumed() ? METRIC_TLS_RESUMED : METRIC_TLS_HANDSHAKES);
+        LOG_DEBUG("tls: fd: %d, %s handshake, %s, ktls send: %d", SSL_get_fd(ssl),
+                  resumed() ? "resumed" : "full", SSL_get_version(ssl), ktls);
+        return TLS_OK;
+    }
+    switch(SSL_get_error(ssl, ret)) {
+        case SSL_ERROR_WANT_READ:
+            return TLS_WANT_READ;
+        case SSL_ERROR_WANT_WRITE:
+            return TLS_WANT_WRITE;
+        default:
+            metrics::add(METRIC_TLS_FAILED);
+            LOG_INFO("tls: fd: %d, handshake failed: %s", SSL_get_fd(ssl), last_error().c_str());
+            return TLS_ERROR;
+    }
+}
+
+ssize_t tls_connection::read(char* buf, size_t len, int& saved_errno) {
+    ERR_clear_error();
+    int ret = SSL_read(ssl, buf, static_cast<int>(std::min<size_t>(len, INT_MAX)));
+    if(ret > 0) {
+        return ret;
+    }
+    switch(SSL_get_error(ssl, ret)) {
+        case SSL_ERROR_ZERO_RETURN:
+            return 0;
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            saved_errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_SYSCALL:
+            saved_errno = errno != 0 ? errno : ECONNRESET;
+            return -1;
+        default:
+            saved_errno = EPROTO;
+            return -1;
+    }
+}
+
+ssize_t tls_connection::writev(const struct iovec* iov, int iov_cnt) {
+    ERR_clear_error();
+    if(iov_cnt == 1 || iov[0].iov_len >= RECORD_SIZE) {
+        return write_result(SSL_write(ssl, iov[0].iov_base, static_cast<int>(std::min<size_t>(iov[0].iov_len, INT_MAX))));
+    }
+    /* 小段(响应头、分块头等)合并为一条记录，避免每段单独加密成记录 */
+    m_gather.clear();
+    for(int i = 0; i < iov_cnt && m_gather.size() < RECORD_SIZE; ++i) {
+        size_t n = std::min(iov[i].iov_len, RECORD_SIZE - m_gather.size());
+        m_gather.append(static_cast<const char*>(iov[i].iov_base), n);
+    }
+    return write_result(SSL_write(ssl, m_gather.data(), static_cast<int>(m_gather.size())));
+}
+
+ssize_t tls_connection::sendfile(int file_fd, off_t* offset, size_t count) {
+    ERR_clear_error();
+    ssize_t n = 0;
+    if(ktls) {
+        /* 内核加密: 文件内容仍由page cache直接发送 */
+        n = write_result(static_cast<int>(SSL_sendfile(ssl, file_fd, *offset, std::min<size_t>(count, INT_MAX), 0)));
+    } else {
+        m_gather.resize(count < RECORD_SIZE ? count : RECORD_SIZE);
+        n = pread(file_fd, &m_gather[0], m_gather.size(), *offset);
+        if(n <= 0) {
+            return n;
+        }
+        n = write_result(SSL_write(ssl, m_gather.data(), static_cast<int>(n)));
+    }
+    if(n > 0) {
+        *offset += n;
+    }
+    return n;
+}
+
+
+/**
+ * private method
+ */
+
+ssize_t tls_connection::write_result(int ret) {
+    if(ret > 0) {
+        return ret;
+    }
+    switch(SSL_get_error(ssl, ret)) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+            break;
+        case SSL_ERROR_SYSCALL:
+            if(errno == 0) {
+                errno = EPIPE;
+            }
+            break;
+        default:
+            errno = EPROTO;
+            break;
+    }
+    return -1;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#ifndef _TLS_CONTEXT_H
+#define _TLS_CONTEXT_H
+
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <openssl/ssl.h>
+
+
+/**
+ * @brief HTTPS监听端口的服务端配置，所有reactor共用一个SSL_CTX
+ *  1. 会话缓存(session id)由SSL_CTX内部加锁共享，任一reactor上建立的会话都能在其它reactor上恢复
+ *  2. 会话票据(TLS 1.2 ticket / TLS 1.3 PSK)的密钥随SSL_CTX生成，同样在reactor间共享，恢复时跳过证书签名与完整密钥交换
+ *  3. 开启SSL_OP_ENABLE_KTLS: 内核支持时握手后记录加密交给内核，sendmsg/sendfile照常使用
+ *  4. ALPN优先协商h2，其次http/1.1
+ */
+class tls_context {
+public:
+    tls_context();
+    ~tls_context();
+    tls_context(const tls_context&) = delete;
+    tls_context& operator=(const tls_context&) = delete;
+
+    /**
+     * @param cert_file  PEM格式证书链(服务端证书在前)
+     * @param key_file   PEM格式私钥
+     * @param cache_size 会话缓存条目上限
+     * @param timeout_s  会话(缓存与票据)有效期
+     */
+    bool init(const std::string& cert_file, const std::string& key_file,
+              long cache_size = 20480, long timeout_s = 3600);
+
+    SSL_CTX* get() const { return ctx; }
+
+private:
+    static int select_alpn(SSL* ssl, const unsigned char** out, unsigned char* outlen,
+                           const unsigned char* in, unsigned int inlen, void* arg);
+
+private:
+    SSL_CTX* ctx;
+};
+
+
+/**
+ * @brief 一个TLS连接，作为http_session的成员随session池化复用
+ *  1. socket为非阻塞，握手/读/写返回TLS_WANT_*或errno = EAGAIN时由调用方注册对应事件后重试
+ *  2. kTLS发送生效后调用方直接对socket使用sendmsg/sendfile；否则writev把多段合并为一条记录后SSL_write，
+ *     sendfile以pread读出文件窗口后SSL_write
+ *  3. 只由当前持有连接的线程(reactor或worker，EPOLLONESHOT保证互斥)访问
+ */
+class tls_connection {
+public:
+    enum TLS_RESULT {
+        TLS_OK = 0,
+        TLS_WANT_READ,
+        TLS_WANT_WRITE,
+        TLS_ERROR
+    };
+
+    static const size_t RECORD_SIZE = 16384;    // TLS记录的最大明文长度
+
+public:
+    tls_connection();
+    ~tls_connection();
+    tls_connection(const tls_connection&) = delete;
+    tls_connection& operator=(const tls_connection&) = delete;
+
+    bool attach(tls_context* ctx, int fd);
+
+    /**
+     * @brief 释放SSL对象，不发送close_notify(fd此时可能已关闭)，会话仍保留在缓存中
+     */
+    void detach();
+
+    bool active() const { return ssl != nullptr; }
+    bool handshake_done() const { return established; }
+
+    TLS_RESULT handshake();
+
+    /**
+     * @brief 语义同recv: >0 读取的明文长度; 0 对端关闭; -1 出错，saved_errno为EAGAIN表示需要等待可读
+     */
+    ssize_t read(char* buf, size_t len, int& saved_errno);
+
+    /**
+     * @brief 语义同sendmsg，一次最多写出一条记录，需要等待可写时返回-1且errno = EAGAIN
+     */
+    ssize_t writev(const struct iovec* iov, int iov_cnt);
+
+    /**
+     * @brief 语义同sendfile，offset按写出的字节数推进
+     */
+    ssize_t sendfile(int file_fd, off_t* offset, size_t count);
+
+    bool ktls_send() const { return ktls; }
+    bool has_pending() const { return ssl != nullptr && SSL_has_pending(ssl) == 1; }
+    bool resumed() const { return ssl != nullptr && SSL_session_reused(ssl) == 1; }
+
+private:
+    ssize_t write_result(int ret);
+
+private:
+    SSL* ssl;
+    bool established;
+    bool ktls;
+    std::string m_gather;           // 非kTLS时合并小段/读取文件窗口，复用容量
+};
+
+#endif
\ No newline at end of file
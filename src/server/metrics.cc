@@ -0,0 +1,217 @@
+#include <time.h>
+#include <sstream>
+
+#include "metrics.h"
+
+namespace {
+
+struct counter_info {
+    const char* name;
+    const char* labels;
+    const char* help;
+};
+
+/* 与METRIC_COUNTER一一对应，同名的连续条目属于同一个指标族 */
+const counter_info COUNTER_INFO[METRIC_COUNTER_NUM] = {
+    { "sws_connections_accepted_total", "", "Accepted connections." },
+    { "sws_connections_rejected_total", "", "Connections rejected with 503 because of the connection limit or fd exhaustion." },
+    { "sws_connections_closed_total", "", "Closed connections." },
+    { "sws_http_requests_total", "", "Parsed HTTP requests, including malformed ones." },
+    { "sws_http_responses_total", "{code=\"2xx\"}", "HTTP responses by status class." },
+    { "sws_http_responses_total", "{code=\"3xx\"}", "HTTP responses by status class." },
+    { "sws_http_responses_total", "{code=\"4xx\"}", "HTTP responses by status class." },
+    { "sws_http_responses_total", "{code=\"5xx\"}", "HTTP responses by status class." },
+    { "sws_http_response_bytes_total", "", "Bytes written to clients." },
+    { "sws_timer_expired_total", "", "Connections closed by the idle timer." },
+    { "sws_tls_handshakes_total", "{result=\"full\"}", "TLS handshakes by result." },
+    { "sws_tls_handshakes_total", "{result=\"resumed\"}", "TLS handshakes by result." },
+    { "sws_tls_handshakes_total", "{result=\"failed\"}", "TLS handshakes by result." },
+    { "sws_stale_events_total", "", "Poller events and worker completions dropped because the connection generation no longer matched." },
+    { "sws_request_batches_total", "{target=\"reactor\"}", "Request batches by the thread that processed them." },
+    { "sws_request_batches_total", "{target=\"pool\"}", "Request batches by the thread that processed them." },
+    { "sws_static_cache_hits_total", "", "Static cache hits." },
+    { "sws_static_cache_misses_total", "", "Static cache misses." },
+};
+
+const counter_info HISTOGRAM_INFO[METRIC_HISTOGRAM_NUM] = {
+    { "sws_thread_pool_wait_seconds", "", "Time a task waits in the thread pool queue." },
+    { "sws_request_parse_seconds", "", "Time spent parsing a request head." },
+};
+
+/* 导出的桶上界(ns)，直方图内部仍按hdr分桶记录 */
+const uint64_t BUCKET_BOUNDS[] = {
+    250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 1000000000,
+};
+
+}
+
+
+metrics::shard::shard() {
+    for(int i = 0; i < METRIC_COUNTER_NUM; ++i) {
+        counters[i].store(0, std::memory_order_relaxed);
+    }
+    for(int h = 0; h < METRIC_HISTOGRAM_NUM; ++h) {
+        sums[h].store(0, std::memory_order_relaxed);
+        for(int i = 0; i < hdr_histogram::BUCKET_NUM; ++i) {
+            buckets[h][i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+metrics* metrics::get_instance() {
+    static metrics instance;
+    return &instance;
+}
+
+uint64_t metrics::now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+void metrics::add_collector(const std::string& name, const std::string& help, const std::string& type,
+                            collect_fn fn) {
+    std::lock_guard<std::mutex> locker(_mutex);
+    collector c = { name, help, type, std::move(fn) };
+    collectors.push_back(std::move(c));
+}
+
+void metrics::clear_collectors() {
+    std::lock_guard<std::mutex> locker(_mutex);
+    collectors.clear();
+}
+
+std::string metrics::render() {
+    std::string out;
+    for(int part = 0; render_part(part, out); ++part) {
+    }
+    return out;
+}
+
+bool metrics::render_part(int part, std::string& out) {
+    std::ostringstream stream;
+    stream.precision(15);       // 默认6位有效数字会把字节数等大整数输出成科学计数法
+    if(part == 0) {
+        render_counters(stream);
+    } else if(part == 1) {
+        render_histograms(stream);
+    } else if(part == 2) {
+        render_collectors(stream);
+    }
+    out += stream.str();
+    return part + 1 < RENDER_PARTS;
+}
+
+uint64_t metrics::counter(METRIC_COUNTER counter) {
+    std::lock_guard<std::mutex> locker(_mutex);
+    uint64_t value = 0;
+    for(const std::unique_ptr<shard>& s: shards) {
+        value += s->counters[counter].load(std::memory_order_relaxed);
+    }
+    return value;
+}
+
+hdr_histogram metrics::histogram(METRIC_HISTOGRAM hist) {
+    std::vector<uint64_t> buckets;
+    uint64_t sum = 0;
+    merge_histogram(hist, buckets, sum);
+    hdr_histogram res;
+    for(int i = 0; i < hdr_histogram::BUCKET_NUM; ++i) {
+        if(buckets[i] > 0) {
+            res.record(hdr_histogram::lowest_equivalent(i), buckets[i]);
+        }
+    }
+    return res;
+}
+
+
+/**
+ * private method
+ */
+
+metrics::shard& metrics::local() {
+    static thread_local shard* s = get_instance()->register_shard();
+    return *s;
+}
+
+metrics::shard* metrics::register_shard() {
+    std::lock_guard<std::mutex> locker(_mutex);
+    shards.emplace_back(new shard());
+    return shards.back().get();
+}
+
+void metrics::render_counters(std::ostream& out) {
+    uint64_t values[METRIC_COUNTER_NUM];
+    for(int i = 0; i < METRIC_COUNTER_NUM; ++i) {
+        values[i] = counter(static_cast<METRIC_COUNTER>(i));
+    }
+
+    const char* family = "";
+    for(int i = 0; i < METRIC_COUNTER_NUM; ++i) {
+        const counter_info& info = COUNTER_INFO[i];
+        if(std::string(family) != info.name) {
+            family = info.name;
+            out << "# HELP " << info.name << " " << info.help << "\n";
+            out << "# TYPE " << info.name << " counter\n";
+        }
+        out << info.name << info.labels << " " << values[i] << "\n";
+    }
+    uint64_t closed = values[METRIC_CLOSED];
+    out << "# HELP sws_connections_active Open connections.\n";
+    out << "# TYPE sws_connections_active gauge\n";
+    out << "sws_connections_active " << (values[METRIC_ACCEPTED] > closed ? values[METRIC_ACCEPTED] - closed : 0)
+        << "\n";
+}
+
+void metrics::render_histograms(std::ostream& out) {
+    std::vector<uint64_t> buckets;
+    for(int h = 0; h < METRIC_HISTOGRAM_NUM; ++h) {
+        const counter_info& info = HISTOGRAM_INFO[h];
+        uint64_t sum = 0;
+        merge_histogram(static_cast<METRIC_HISTOGRAM>(h), buckets, sum);
+        out << "# HELP " << info.name << " " << info.help << "\n";
+        out << "# TYPE " << info.name << " histogram\n";
+        /* hdr桶的上界不超过导出桶的上界时计入该桶，误差不超过hdr的分桶精度 */
+        uint64_t cumulative = 0;
+        int index = 0;
+        for(uint64_t bound: BUCKET_BOUNDS) {
+            while(index < hdr_histogram::BUCKET_NUM && hdr_histogram::highest_equivalent(index) <= bound) {
+                cumulative += buckets[index++];
+            }
+            out << info.name << "_bucket{le=\"" << bound / 1e9 << "\"} " << cumulative << "\n";
+        }
+        while(index < hdr_histogram::BUCKET_NUM) {
+            cumulative += buckets[index++];
+        }
+        out << info.name << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+        out << info.name << "_sum " << sum / 1e9 << "\n";
+        out << info.name << "_count " << cumulative << "\n";
+    }
+}
+
+void metrics::render_collectors(std::ostream& out) {
+    /* collector在锁外调用，其中记录指标时不会在注册分片时死锁 */
+    std::vector<collector> snapshot;
+    {
+        std::lock_guard<std::mutex> locker(_mutex);
+        snapshot = collectors;
+    }
+    for(const collector& c: snapshot) {
+        out << "# HELP " << c.name << " " << c.help << "\n";
+        out << "# TYPE " << c.name << " " << c.type << "\n";
+        out << c.name << " " << c.fn() << "\n";
+    }
+}
+
+void metrics::merge_histogram(METRIC_HISTOGRAM hist, std::vector<uint64_t>& buckets, uint64_t& sum) {
+    buckets.assign(hdr_histogram::BUCKET_NUM, 0);
+    sum = 0;
+    std::lock_guard<std::mutex> locker(_mutex);
+    for(const std::unique_ptr<shard>& s: shards) {
+        for(int i = 0; i < hdr_histogram::BUCKET_NUM; ++i) {
+            buckets[i] += s->buckets[hist][i].load(std::memory_order_relaxed);
+        }
+        sum += s->sums[hist].load(std::memory_order_relaxed);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../utils/hdr_histogram.h"
+
+constexpr const char METRICS_PATH[] = "/metrics";     // 保留路径，返回Prometheus文本格式的指标
+
+enum METRIC_COUNTER {
+    METRIC_ACCEPTED = 0,        // 接受的连接
+    METRIC_REJECTED,            // 超过上限返回503的连接
+    METRIC_CLOSED,              // 关闭的连接，活跃连接数 = accepted - closed
+    METRIC_REQUESTS,
+    METRIC_RESPONSES_2XX,
+    METRIC_RESPONSES_3XX,
+    METRIC_RESPONSES_4XX,
+    METRIC_RESPONSES_5XX,
+    METRIC_RESPONSE_BYTES,
+    METRIC_TIMER_EXPIRED,       // 空闲超时关闭的连接
+    METRIC_TLS_HANDSHAKES,      // 完整TLS握手
+    METRIC_TLS_RESUMED,         // 通过会话缓存/票据恢复的握手
+    METRIC_TLS_FAILED,
+    METRIC_STALE_EVENTS,        // 代数不符而丢弃的poller事件与worker完成项
+    METRIC_DISPATCH_INLINE,     // 在reactor线程直接处理的读取批次
+    METRIC_DISPATCH_POOL,       // 提交到线程池处理的读取批次
+    METRIC_CACHE_HITS,          // 静态缓存命中(lookup)
+    METRIC_CACHE_MISSES,
+    METRIC_COUNTER_NUM
+};
+
+enum METRIC_HISTOGRAM {
+    METRIC_POOL_WAIT = 0,       // 任务在线程池队列中的等待时间(ns)
+    METRIC_PARSE_TIME,          // 解析请求头的时间(ns)
+    METRIC_HISTOGRAM_NUM
+};
+
+
+/**
+ * @brief 进程内指标
+ *  1. 每个线程第一次记录时分配自己的分片(按cache line填充)，记录只写本线程分片：
+ *     单写者用relaxed load + store，不需要加锁也没有lock前缀指令
+ *  2. 直方图沿用hdr_histogram的分桶，每个桶是一个原子计数
+ *  3. 抓取时加锁遍历所有分片汇总，线程退出后分片保留，累计值不会倒退
+ *  4. 线程池队列长度、日志丢弃数等由注册的collector在抓取时读取
+ */
+class metrics {
+public:
+    typedef std::function<double()> collect_fn;
+
+public:
+    static metrics* get_instance();
+
+    static void add(METRIC_COUNTER counter, uint64_t n = 1) {
+        std::atomic<uint64_t>& value = local().counters[counter];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void record(METRIC_HISTOGRAM hist, uint64_t value_ns) {
+        shard& s = local();
+        std::atomic<uint64_t>& bucket = s.buckets[hist][hdr_histogram::index_of(value_ns)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        s.sums[hist].store(s.sums[hist].load(std::memory_order_relaxed) + value_ns, std::memory_order_relaxed);
+    }
+
+    static uint64_t now_ns();
+
+    /**
+     * @brief 注册抓取时才读取的指标
+     * @param type "gauge" 或 "counter"
+     */
+    void add_collector(const std::string& name, const std::string& help, const std::string& type, collect_fn fn);
+    void clear_collectors();
+
+    /**
+     * @brief 汇总所有分片，输出Prometheus text format(0.0.4)
+     */
+    std::string render();
+
+    /**
+     * @brief 分段输出: 0 计数器, 1 直方图, 2 collector，用于边生成边发送
+     * @return 是否还有后续分段
+     */
+    bool render_part(int part, std::string& out);
+
+    uint64_t counter(METRIC_COUNTER counter);
+    hdr_histogram histogram(METRIC_HISTOGRAM hist);
+
+private:
+    metrics() = default;
+    ~metrics() = default;
+    metrics(const metrics&) = delete;
+    metrics& operator=(const metrics&) = delete;
+
+    static const size_t CACHE_LINE = 64;
+    static const int RENDER_PARTS = 3;
+
+    struct shard {
+        char pad0[CACHE_LINE];
+        std::atomic<uint64_t> counters[METRIC_COUNTER_NUM];
+        std::atomic<uint64_t> sums[METRIC_HISTOGRAM_NUM];
+        std::atomic<uint64_t> buckets[METRIC_HISTOGRAM_NUM][hdr_histogram::BUCKET_NUM];
+        char pad1[CACHE_LINE];
+
+        shard();
+    };
+
+    struct collector {
+        std::string name;
+        std::string help;
+        std::string type;
+        collect_fn fn;
+    };
+
+    static shard& local();
+    shard* register_shard();
+    void render_counters(std::ostream& out);
+    void render_histograms(std::ostream& out);
+    void render_collectors(std::ostream& out);
+    void merge_histogram(METRIC_HISTOGRAM hist, std::vector<uint64_t>& buckets, uint64_t& sum);
+
+private:
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<shard>> shards;
+    std::vector<collector> collectors;
+};
+
+#endif
\ No newline at end of file
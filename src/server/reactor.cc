@@ -0,0 +1,472 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <algorithm>
+
+#include "reactor.h"
+#include "metrics.h"
+#include "http/date_header.h"
+
+/* 连接数超过上限时在reactor中直接写出并关闭，不分配session */
+static const char BUSY_RESPONSE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Connection: close\r\n"
+    "Retry-After: 1\r\n"
+    "Content-type: text/html\r\n"
+    "Content-length: 103\r\n\r\n"
+    "<html><title>Error</title><body>503 : Service Unavailable<hr><em>simplest web server</em></body></html>";
+
+reactor::reactor(int id, const socket_options& opt, uint32_t listen_ev, uint32_t conn_ev,
+                 int idle_time_ms, thread_pool* pool, tls_context* tls):
+    reactor_id(id), sock_fd(-1), tls_sock_fd(-1), running(false), max_rdwd_idle_time(idle_time_ms), options(opt),
+    max_conn(std::max<size_t>(1, opt.max_connections / std::max(1, opt.reactor_num))),
+    idle_fd(open("/dev/null", O_RDONLY | O_CLOEXEC)), rejected(0),
+    listen_event(listen_ev), conn_event(conn_ev), threadpool_(pool), tls_(tls),
+    timer_(new timing_wheel()), epler_(make_poller(opt.poller_type, 1024)), slots_(1024), conn_num(0),
+    completion_io_(epler_->completion_io()) {
+
+    /* 所有连接共用同一个超时回调，add时不再为每个连接构造std::function；
+     * 关闭连接时定时器节点同步删除，回调时连接一定还在，这里只做廉价的防御检查 */
+    timer_->set_expire_handler([this](int fd) {
+        if(static_cast<size_t>(fd) < slots_.size() && slots_[fd].session) {
+            metrics::add(METRIC_TIMER_EXPIRED);
+            deal_close(fd);
+        }
+    });
+    init_socket();
+    epler_->add_fd(completions_.fd(), EPOLLIN, make_token(completions_.fd(), 0));
+    LOG_INFO("reactor(%d) init finish, listen fd: %d, tls listen fd: %d, poller: %s%s",
+             reactor_id, sock_fd, tls_sock_fd, epler_->name(), completion_io_ ? " (completion)" : "");
+}
+
+reactor::~reactor() {
+    running = false;
+    if(sock_fd >= 0) {
+        close(sock_fd);
+    }
+    if(tls_sock_fd >= 0) {
+        close(tls_sock_fd);
+    }
+    if(idle_fd >= 0) {
+        close(idle_fd);
+    }
+}
+
+void reactor::loop() {
+    running = true;
+    while(running) {
+        /* 先处理超时连接，再以最近的超时时间作为epoll等待时长 */
+        int time_ms = static_cast<int>(timer_->get_next_tick());
+        int epl_num = epler_->wait(time_ms);
+        /* 本轮生成的响应共用同一秒的Date头 */
+        date_header::refresh();
+        for(int i = 0; i < epl_num; ++i) {
+            uint64_t token = epler_->get_event_data(i);
+            int fd = static_cast<int>(token & 0xffffffff);
+            uint32_t event = epler_->get_event(i);
+            POLLER_OP op = epler_->get_op(i);
+            if(op == OP_ACCEPT) {
+                deal_accept(fd, epler_->get_result(i));
+                continue;
+            }
+            if(fd == sock_fd || fd == tls_sock_fd) {
+                deal_listen(fd);
+                continue;
+            }
+            if(fd == completions_.fd()) {
+                deal_completions();
+                continue;
+            }
+            /* 已关闭的连接也要处理: 发送完成后才能close(fd) */
+            if(op == OP_SEND) {
+                deal_sent(fd, token, epler_->get_result(i));
+                continue;
+            }
+            /* 同一批事件中连接可能已被关闭、fd又被新accept的连接复用，代数不符的事件属于旧连接 */
+            if(!is_live(fd, token)) {
+                metrics::add(METRIC_STALE_EVENTS);
+                continue;
+            }
+            if(op == OP_RECV) {
+                deal_recv(fd, epler_->get_result(i), epler_->get_buffer(i));
+                continue;
+            }
+            if(event & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                deal_close(fd);
+            } else if(event & EPOLLIN) {
+                deal_read(fd);
+            } else if(event & EPOLLOUT) {
+                deal_write(fd);
+            } else {
+                LOG_ERROR("reactor(%d) unexpected event!!!", reactor_id);
+            }
+        }
+    }
+}
+
+void reactor::stop() {
+    running = false;
+}
+
+void reactor::init_socket() {
+    sock_fd = listen_on(options.port);
+    if(tls_) {
+        tls_sock_fd = listen_on(options.tls_port);
+    }
+}
+
+int reactor::listen_on(int port) {
+    assert(port < 65535 && port > 1024);
+    int listen_fd = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    assert(listen_fd >= 0);
+
+    // set socket options
+    if(options.opt_linger) {
+        /* 优雅关闭: 直到所剩数据发送完毕或超时 */
+        struct linger lg;
+        bzero(&lg, sizeof(lg));
+        lg.l_linger = 1;
+        lg.l_onoff = 1;
+        int ret = setsockopt(listen_fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        assert(ret == 0);
+    }
+
+    if(options.opt_reuseaddr) {
+        /* 端口复用 */
+        int val = 1;
+        int ret = setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, (const void*)&val, sizeof(int));
+        assert(ret == 0);
+    }
+
+    if(options.opt_reuseport) {
+        /* 多个reactor绑定同一端口，由内核按连接做负载均衡 */
+        int val = 1;
+        int ret = setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, (const void*)&val, sizeof(int));
+        assert(ret == 0);
+    }
+
+    struct sockaddr_in address;
+    bzero(&address, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    int ret = 0;
+    ret = bind(listen_fd, (struct sockaddr *)&address, sizeof(address));
+    assert(ret >= 0);
+
+    ret = listen(listen_fd, SOMAXCONN);   // SOMAXCONN: 监听队列最多容纳数量
+    assert(ret >= 0);
+
+    /* epoll多路复用；完成模式下提交一次multishot accept，每个新连接一个完成事件 */
+    if(completion_io_) {
+        epler_->accept_multishot(listen_fd, make_token(listen_fd, 0));
+    } else {
+        epler_->add_fd(listen_fd, listen_event | EPOLLIN, make_token(listen_fd, 0));
+    }
+    return listen_fd;
+}
+
+void reactor::deal_listen(int fd) {
+    /* 每次唤醒批量accept: ET模式取到EAGAIN为止，LT模式最多ACCEPT_BATCH个，避免饿死已有连接 */
+    for(int i = 0; (listen_event & EPOLLET) || i < ACCEPT_BATCH; ++i) {
+        /* accept4直接得到非阻塞fd，省去add_fd中的两次fcntl */
+        int conn_fd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (conn_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                deal_emfile(fd);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("reactor(%d) accept error: %d", reactor_id, errno);
+            }
+            return;
+        }
+        add_conn(conn_fd, fd == tls_sock_fd);
+    }
+}
+
+/**
+ * @brief multishot accept的完成事件，res为新连接的fd或-errno
+ */
+void reactor::deal_accept(int fd, int res) {
+    if(res >= 0) {
+        add_conn(res, fd == tls_sock_fd);
+        return;
+    }
+    if(res == -EMFILE || res == -ENFILE) {
+        deal_emfile(fd);
+    } else if(res != -EINTR && res != -ECONNABORTED && res != -EAGAIN) {
+        LOG_ERROR("reactor(%d) accept error: %d", reactor_id, -res);
+    }
+}
+
+void reactor::add_conn(int conn_fd, bool tls) {
+    if (conn_num >= max_conn) {
+        reject(conn_fd, tls);
+        return;
+    }
+    if (static_cast<size_t>(conn_fd) >= slots_.size()) {
+        slots_.resize(std::max(static_cast<size_t>(conn_fd) + 1, slots_.size() * 2));
+    }
+    conn_slot& slot = slots_[conn_fd];
+    uint64_t token = make_token(conn_fd, ++slot.generation);
+    /* 从池中复用session，不再为每个连接分配并清零20KB的读缓冲区 */
+    session_ptr session = sessions_.acquire(conn_fd, conn_event, epler_, token);
+    if (tls && !session->start_tls(tls_)) {
+        close(conn_fd);
+        return;
+    }
+    slot.session = std::move(session);
+    slot.busy = false;
+    slot.inbox.clear();
+    conn_num++;
+    metrics::add(METRIC_ACCEPTED);
+    if(max_rdwd_idle_time > 0) {
+        timer_->add(conn_fd, max_rdwd_idle_time);
+    }
+    if(completion_io_ && !tls) {
+        /* 数据到达时随完成事件交给reactor，省去EPOLLIN之后的recv；TLS由SSL自己读socket，仍使用就绪通知 */
+        slot.session->use_completion_io();
+        epler_->recv_multishot(conn_fd, token);
+    } else {
+        epler_->add_fd(conn_fd, conn_event | EPOLLIN, token);
+    }
+}
+
+void reactor::deal_read(int fd) {
+    http_session::READ_RESULT res = slots_[fd].session->read_buf();
+    if(res == http_session::READ_DATA) {
+        deal_request(fd);
+    } else if(res == http_session::READ_WAIT) {
+        /* TLS握手进行中，session已重新注册事件 */
+        if(max_rdwd_idle_time > 0) {
+            timer_->update(fd, max_rdwd_idle_time);
+        }
+    } else {
+        deal_close(fd);
+    }
+}
+
+/**
+ * @brief 完成模式下multishot recv的完成事件，data只在本轮事件循环中有效
+ */
+void reactor::deal_recv(int fd, int res, const char* data) {
+    if(res <= 0) {
+        deal_close(fd);     // 对端关闭或出错
+        return;
+    }
+    conn_slot& slot = slots_[fd];
+    if(max_rdwd_idle_time > 0) {
+        timer_->update(fd, max_rdwd_idle_time);
+    }
+    if(slot.busy) {
+        /* worker交还session后再追加；超过单个请求的上限说明对端不等响应持续发送 */
+        if(slot.inbox.size() + res > MAX_REQUEST_SIZE) {
+            deal_close(fd);
+            return;
+        }
+        slot.inbox.append(data, res);
+        return;
+    }
+    slot.session->feed(data, res);
+    /* 响应未发送完时请求留在读缓冲区中，发送完后由deal_write处理 */
+    if(!slot.session->write_pending()) {
+        deal_request(fd);
+    }
+}
+
+/**
+ * @brief 完成模式下sendmsg的完成事件: 继续发送剩余部分，已关闭的连接在这里才close(fd)
+ */
+void reactor::deal_sent(int fd, uint64_t token, int res) {
+    if(!owns(fd, token)) {
+        metrics::add(METRIC_STALE_EVENTS);
+        return;
+    }
+    conn_slot& slot = slots_[fd];
+    if(!slot.session->send_done(res) || slot.closing) {
+        deal_close(fd);
+        return;
+    }
+    deal_write(fd);
+}
+
+/**
+ * @brief 读缓冲区中有新数据
+ */
+void reactor::deal_request(int fd) {
+    /* 引用槽中的session，只有提交任务时才复制(增加一次引用计数) */
+    const session_ptr& session = slots_[fd].session;
+    if(options.inline_static && session->inline_ready()) {
+        /* 处理只需查缓存和拼接响应，省去线程池的排队、跨线程唤醒和完成队列，一次循环内完成读写 */
+        metrics::add(METRIC_DISPATCH_INLINE);
+        if(session->process()) {
+            deal_write(fd);
+            return;
+        }
+        /* 只有不完整的请求，继续等待可读 */
+        wait_readable(fd);
+        if(max_rdwd_idle_time > 0) {
+            timer_->update(fd, max_rdwd_idle_time);
+        }
+    } else {
+        submit_process(fd);
+    }
+}
+
+/**
+ * @brief 请求不完整时等待更多数据；完成模式下multishot recv一直有效，无需重新注册
+ */
+void reactor::wait_readable(int fd) {
+    if(!slots_[fd].session->completion_io()) {
+        epler_->mod_fd(fd, conn_event | EPOLLIN, make_token(fd, slots_[fd].generation));
+    }
+}
+
+void reactor::deal_write(int fd) {
+    const session_ptr& session = slots_[fd].session;
+    http_session::WRITE_RESULT res = session->write_buf();
+    /* 发送完后缓冲区中还有流水线请求: 与deal_read相同，只有命中缓存的简单GET在reactor线程处理 */
+    while(res == http_session::WRITE_PENDING && options.inline_static && session->inline_ready()) {
+        metrics::add(METRIC_DISPATCH_INLINE);
+        if(!session->process()) {
+            wait_readable(fd);
+            res = http_session::WRITE_DONE;
+            break;
+        }
+        res = session->write_buf();
+    }
+    if(res == http_session::WRITE_CLOSE) {
+        deal_close(fd);
+        return;
+    }
+    if(res == http_session::WRITE_PENDING) {
+        submit_process(fd);
+    } else if(max_rdwd_idle_time > 0) {
+        timer_->update(fd, max_rdwd_idle_time);
+    }
+}
+
+/**
+ * @brief 交给线程池处理读缓冲区中的请求(可能阻塞: 数据库校验、打开未缓存的文件等)
+ */
+void reactor::submit_process(int fd) {
+    /* 任务持有引用，连接在处理期间被关闭时session也不会被回收复用；
+     * 处理完后连同token交还本reactor，由reactor发送并重新注册事件 */
+    session_ptr session = slots_[fd].session;
+    slots_[fd].busy = true;
+    metrics::add(METRIC_DISPATCH_POOL);
+    uint64_t submit_ns = metrics::now_ns();
+    uint64_t token = make_token(fd, slots_[fd].generation);
+    completion_queue* completions = &completions_;
+    threadpool_->submit([session, token, submit_ns, completions]() {
+        metrics::record(METRIC_POOL_WAIT, metrics::now_ns() - submit_ns);
+        bool has_response = session->process();
+        completions->push(session, token, has_response);
+    });
+    if(max_rdwd_idle_time > 0) {
+        timer_->update(fd, max_rdwd_idle_time);
+    }
+}
+
+void reactor::deal_close(int fd) {
+    if(fd < 0) {
+        LOG_ERROR("deal close, fd is less than zero, fd: %d", fd);
+        return;
+    }
+    timer_->del(fd, false);
+    epler_->del_fd(fd);
+    if(static_cast<size_t>(fd) < slots_.size() && slots_[fd].session) {
+        conn_slot& slot = slots_[fd];
+        if(slot.session->sending()) {
+            /* 内核还在读取session中的响应，发送完成(或被取消)后由deal_sent再次调用 */
+            slot.closing = true;
+            return;
+        }
+        slot.closing = false;
+        std::string().swap(slot.inbox);
+        slot.session.reset();
+        conn_num--;
+        metrics::add(METRIC_CLOSED);
+    }
+    close(fd);
+    LOG_INFO("reactor(%d) deal close, fd(%d) is closed", reactor_id, fd);
+}
+
+/**
+ * @brief 一次取出所有完成的session: 有响应时不等待EPOLLOUT直接发送，
+ * 大多数响应一次写完后只需重新注册EPOLLIN；请求不完整时只重新注册EPOLLIN
+ */
+void reactor::deal_completions() {
+    completions_.drain(completed_);
+    for(completion_queue::item& c: completed_) {
+        int fd = static_cast<int>(c.token & 0xffffffff);
+        /* 处理期间连接已超时关闭，fd可能已被新连接复用 */
+        if(!is_live(fd, c.token) || slots_[fd].session.get() != c.session.get()) {
+            metrics::add(METRIC_STALE_EVENTS);
+            continue;
+        }
+        conn_slot& slot = slots_[fd];
+        slot.busy = false;
+        /* 完成模式下处理期间到达的数据 */
+        bool fed = !slot.inbox.empty();
+        if(fed) {
+            slot.session->feed(slot.inbox.data(), slot.inbox.size());
+            slot.inbox.clear();
+        }
+        if(c.has_response) {
+            deal_write(fd);
+        } else if(fed) {
+            deal_request(fd);
+        } else {
+            wait_readable(fd);
+        }
+    }
+    /* 在reactor线程释放引用，已关闭连接的session在这里归还到池中 */
+    completed_.clear();
+}
+
+/**
+ * @brief fd耗尽时连接一直留在监听队列中，LT模式下监听socket会持续就绪导致空转；
+ * 释放预留的fd接受一个连接并返回503，然后重新预留
+ */
+void reactor::deal_emfile(int fd) {
+    if(idle_fd < 0) {
+        LOG_ERROR("reactor(%d) accept: too many open files", reactor_id);
+        return;
+    }
+    close(idle_fd);
+    int conn_fd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(conn_fd >= 0) {
+        reject(conn_fd, fd == tls_sock_fd);
+    }
+    idle_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+void reactor::reject(int conn_fd, bool tls) {
+    /* 先读掉已到达的请求，否则close时接收队列非空会发送RST，503也随之丢弃；
+     * HTTPS连接未握手无法发送响应，直接关闭 */
+    if(!tls) {
+        char discard[4096];
+        recv(conn_fd, discard, sizeof(discard), MSG_DONTWAIT);
+        send(conn_fd, BUSY_RESPONSE, sizeof(BUSY_RESPONSE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+    if(options.opt_linger) {
+        /* 从监听socket继承的SO_LINGER会让close阻塞reactor，拒绝的连接由内核在后台关闭 */
+        struct linger lg;
+        bzero(&lg, sizeof(lg));
+        setsockopt(conn_fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    }
+    close(conn_fd);
+    metrics::add(METRIC_REJECTED);
+    if(rejected++ % 1024 == 0) {
+        LOG_WARN("reactor(%d) server busy (connections: %zu, limit: %zu), %lu rejected",
+                 reactor_id, conn_num, max_conn, static_cast<unsigned long>(rejected));
+    }
+}
\ No newline at end of file
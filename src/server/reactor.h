@@ -0,0 +1,150 @@
+#ifndef _REACTOR_H
+#define _REACTOR_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../pool/thread_pool.h"
+#include "../timer/timing_wheel.h"
+#include "completion_queue.h"
+#include "epoll/poller.h"
+#include "http/session_pool.h"
+#include "http/tls_context.h"
+
+
+/**
+ * @brief socket options
+ */
+class socket_options {
+public:
+    socket_options(int p, bool linger, bool reuseaddr, int reactors = 1, POLLER_TYPE poller = POLLER_EPOLL):
+        port(p) ,opt_linger(linger), opt_reuseaddr(reuseaddr),
+        opt_reuseport(reactors > 1), reactor_num(reactors), poller_type(poller) {}
+
+    ~socket_options() = default;
+
+    int port;
+
+    bool opt_linger;
+
+    bool opt_reuseaddr;
+
+    bool opt_reuseport;    // 多reactor时每个reactor独立监听同一端口
+
+    int reactor_num;       // 事件循环个数，建议不超过cpu核数
+
+    POLLER_TYPE poller_type;   // I/O多路复用后端: epoll / io_uring
+
+    size_t cache_budget = 64 << 20;   // 静态文件缓存字节数，0表示关闭
+
+    size_t cache_max_entry = 1 << 20; // 超过该大小的文件不缓存，走sendfile
+
+    size_t max_connections = 10000;   // 连接数上限，每个reactor各分得max_connections / reactor_num，超出时返回503
+
+    int tls_port = 0;                 // HTTPS监听端口，0表示不开启
+
+    std::string tls_cert;             // PEM证书链
+
+    std::string tls_key;              // PEM私钥
+
+    bool inline_static = true;        // 命中静态缓存的简单GET直接在reactor线程处理，不经过线程池
+};
+
+
+/**
+ * @brief one loop per thread: 每个reactor独占poller、定时器、连接表以及
+ * SO_REUSEPORT监听socket，热路径上不访问任何共享状态(线程池除外)
+ * 开启HTTPS时每个reactor另有一个TLS监听socket，所有reactor共用一个tls_context(会话缓存与票据密钥)
+ * worker处理完请求后把session放入完成队列，由reactor立即尝试发送，poller的注册只由reactor修改
+ * io_uring完成模式下明文连接不再等待就绪: 监听socket使用multishot accept，连接使用multishot recv，
+ * 数据随完成事件到达，响应以sendmsg提交，发送完成后继续发送或处理流水线中的请求
+ *
+ */
+class reactor {
+public:
+    reactor(int id, const socket_options& opt, uint32_t listen_ev, uint32_t conn_ev,
+            int idle_time_ms, thread_pool* pool, tls_context* tls = nullptr);
+    reactor(const reactor&) = delete;
+    reactor& operator=(const reactor&) = delete;
+    ~reactor();
+
+    void loop();
+    void stop();
+
+private:
+    void init_socket();
+    int  listen_on(int port);
+    void deal_listen(int fd);
+    void deal_accept(int fd, int res);
+    void add_conn(int conn_fd, bool tls);
+    void deal_write(int fd);
+    void deal_read(int fd);
+    void deal_recv(int fd, int res, const char* data);
+    void deal_sent(int fd, uint64_t token, int res);
+    void deal_request(int fd);
+    void wait_readable(int fd);
+    void submit_process(int fd);
+    void deal_close(int fd);
+    void deal_completions();
+    void deal_emfile(int fd);
+    void reject(int conn_fd, bool tls);
+
+    static const int ACCEPT_BATCH = 64;    // LT模式下每次唤醒最多accept的连接数
+
+    /**
+     * @brief 连接表中的一项，以fd为下标；每次有新连接占用该fd时generation递增，
+     * 与fd一起作为poller的事件数据，旧连接残留的事件代数不符，直接丢弃
+     * 完成模式下multishot recv不会因为session交给worker而暂停，期间到达的数据先暂存在inbox中
+     */
+    struct conn_slot {
+        session_ptr session;
+        uint32_t generation = 0;
+        bool busy = false;        // session在worker中处理
+        bool closing = false;     // 已关闭，等待提交的发送完成后再close(fd)
+        std::string inbox;
+    };
+
+    static uint64_t make_token(int fd, uint32_t generation) {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    /* token对应的连接仍然占用fd: 未被新连接复用 */
+    bool owns(int fd, uint64_t token) const {
+        return static_cast<size_t>(fd) < slots_.size() && slots_[fd].session
+            && slots_[fd].generation == static_cast<uint32_t>(token >> 32);
+    }
+
+    /* token对应的连接仍然存活: fd未关闭且未被新连接复用 */
+    bool is_live(int fd, uint64_t token) const {
+        return owns(fd, token) && !slots_[fd].closing;
+    }
+
+private:
+    int reactor_id;
+    int sock_fd;
+    int tls_sock_fd;              // 未开启HTTPS时为-1
+    std::atomic<bool> running;
+    int max_rdwd_idle_time;
+    const socket_options& options;
+    size_t max_conn;
+    int idle_fd;                  // 预留的fd，fd耗尽(EMFILE)时释放出来接受并关闭连接
+    uint64_t rejected;
+
+    uint32_t listen_event;
+    uint32_t conn_event;
+
+    thread_pool* threadpool_;
+    tls_context* tls_;
+    std::unique_ptr<timing_wheel> timer_;
+    std::shared_ptr<poller> epler_;
+    session_pool sessions_;       // 需要在slots_之前构造、之后析构
+    std::vector<conn_slot> slots_;    // 下标为fd，按需扩容
+    size_t conn_num;
+    bool completion_io_;          // poller支持基于完成的I/O，明文连接使用multishot accept/recv与sendmsg
+    completion_queue completions_;    // 持有session引用，需要在sessions_之后构造、之前析构
+    std::vector<completion_queue::item> completed_;     // 一次取出的完成项，复用容量
+};
+
+#endif
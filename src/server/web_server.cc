@@ -1,150 +1,61 @@
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
 
 #include "web_server.h"
+#include "metrics.h"
 
 web_server::web_server(EPOLL_MODE mode, int idle_time_ms, socket_options& opt):
-    epoll_mode(mode), max_rdwd_idle_time(idle_time_ms), options(opt),
-    threadpool_(new thread_pool(8)), epler_(std::make_shared<epoller>(1024)), timer_(new heap_timer()) {
+    max_rdwd_idle_time(idle_time_ms), options(opt), epoll_mode(mode),
+    threadpool_(new thread_pool(8)) {
 
     init_epoll_mode();
     char* path = getcwd(nullptr, 256);
-    Log::get_instance()->init(path, 20480, LOG_LEVEL::INFO, true, 512, 2);
+    Log::get_instance()->init(path, 20480, LOG_LEVEL::INFO, true, 512, 2, OVERFLOW_DROP);
     LOG_INFO("========== log init finish ==========");
 
-    init_socket();
-    LOG_INFO("========== server init finish ==========");
-    LOG_INFO("port: %d, opt_linger: %d, opt_reuseaddr: %d", options.port, options.opt_linger, options.opt_reuseaddr);
-}
-
-web_server::~web_server() {
-    server_ready = false;
-    if(sock_fd >= 0) {
-        close(sock_fd);
-    }
-}
-
-void web_server::start() {
-    int time_ms = -1;
-    server_ready = true;
-    while(server_ready) {
-        if(time_ms > 0) {
-            time_ms = timer_->get_next_tick();
-        }
-        int epl_num = epler_->wait(time_ms);
-        for(int i = 0; i < epl_num; ++i) {
-            int fd = epler_->get_event_fd(i);
-            uint32_t event = epler_->get_event(i);
-            if(fd == sock_fd) {
-                deal_listen(fd);
-            } else if(event & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
-                assert(users_.count(fd) > 0);
-                deal_close(fd);
-            } else if(event & EPOLLIN) {
-                assert(users_.count(fd) > 0);
-                deal_read(fd);
-            } else if(event & EPOLLOUT) {
-                assert(users_.count(fd) > 0);
-                deal_write(fd);
-            } else {
-                LOG_ERROR("unexpected event!!!");
-            }
-        }
-    }
-}
-
-void web_server::init_socket() {
-    assert(options.port < 65535 && options.port > 1024);
-    sock_fd = socket(PF_INET, SOCK_STREAM, 0);
-    assert(sock_fd >= 0);
+    static_cache::get_instance()->init(options.cache_budget, options.cache_max_entry, 1000);
+    /* 启动时预先载入静态资源，可压缩的文本同时生成gzip变体 */
+    size_t preloaded = http_response::preload_static_cache();
+    static_cache::cache_stats stats = static_cache::get_instance()->stats();
+    LOG_INFO("static cache preload %zu files, %zu bytes", preloaded, stats.bytes);
 
-    // set socket options
-    if(options.opt_linger) {
-        /* 优雅关闭: 直到所剩数据发送完毕或超时 */
-        struct linger lg;
-        bzero(&lg, sizeof(lg));
-        lg.l_linger = 1;
-        lg.l_onoff = 1;
-        int ret = setsockopt(sock_fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
-        assert(ret == 0);
+    if(options.reactor_num < 1) {
+        options.reactor_num = 1;
     }
-
-    if(options.opt_reuseaddr) {
-        /* 端口复用 */
-        int val = 1;
-        int ret = setsockopt(sock_fd, SOL_SOCKET, SO_REUSEADDR, (const void*)&val, sizeof(int));
-        assert(ret == 0);
+    init_tls();
+    for(int i = 0; i < options.reactor_num; ++i) {
+        reactors_.emplace_back(new reactor(i, options, listen_event, conn_event,
+                                           max_rdwd_idle_time, threadpool_.get(), tls_.get()));
     }
-
-    struct sockaddr_in address;
-    bzero(&address, sizeof(address));
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = htonl(INADDR_ANY);
-    address.sin_port = htons(options.port);
-
-    int ret = 0;
-    ret = bind(sock_fd, (struct sockaddr *)&address, sizeof(address));
-    assert(ret >= 0);
-
-    ret = listen(sock_fd, SOMAXCONN);   // SOMAXCONN: 监听队列最多容纳数量
-    assert(ret >= 0);
-
-    /* epoll多路复用 */
-    epler_->add_fd(sock_fd, listen_event | EPOLLIN);
-}
-
-void web_server::deal_listen(int fd) {
-    struct sockaddr_in client_address; 
-    socklen_t client_addrlength = sizeof(client_address);
-    do {
-        int conn_fd = accept(fd,  (struct sockaddr *)(&client_address), &client_addrlength);
-        if (conn_fd < 0) {
-            return;
-        }
-        // TODO: server busy
-        std::shared_ptr<http_session> session = std::make_shared<http_session>(conn_fd, conn_event, epler_);
-        users_.insert(std::make_pair(conn_fd, session));
-        if(max_rdwd_idle_time > 0) {
-            timer_->add(conn_fd, max_rdwd_idle_time, std::bind(&web_server::deal_close, this, conn_fd));
-        }
-        epler_->add_fd(conn_fd, true);
-    } while(listen_event & EPOLLET);
+    init_metrics();
+    LOG_INFO("========== server init finish ==========");
+    LOG_INFO("port: %d, opt_linger: %d, opt_reuseaddr: %d, opt_reuseport: %d, reactor num: %d, cache budget: %zu, "
+             "max connections: %zu, tls port: %d",
+             options.port, options.opt_linger, options.opt_reuseaddr, options.opt_reuseport, options.reactor_num,
+             options.cache_budget, options.max_connections, tls_ ? options.tls_port : 0);
 }
 
-void web_server::deal_read(int fd) {
-    std::shared_ptr<http_session> session = users_[fd];
-    if(session->read_buf()) {
-        threadpool_->submit(std::bind(&http_session::process, session.get()));
-        if(max_rdwd_idle_time > 0) { 
-            timer_->update(fd, max_rdwd_idle_time);
-        }
-    } else {
-        timer_->del(fd, true);
+web_server::~web_server() {
+    server_ready = false;
+    for(auto& r: reactors_) {
+        r->stop();
     }
-}
-
-void web_server::deal_write(int fd) {
-    std::shared_ptr<http_session> session = users_[fd];
-    if(session->write_buf()) {
-        if(max_rdwd_idle_time > 0) { 
-            timer_->update(fd, max_rdwd_idle_time);
+    for(auto& t: reactor_threads_) {
+        if(t.joinable()) {
+            t.join();
         }
-    } else {
-        timer_->del(fd, true);
     }
+    /* 未执行的任务持有session引用，先于reactor(及其session_pool)销毁 */
+    metrics::get_instance()->clear_collectors();
+    threadpool_.reset();
 }
 
-void web_server::deal_close(int fd) {
-    if(fd < 0) {
-        LOG_ERROR("deal close, fd is less than zero, fd: %d", fd);
-        return;
+void web_server::start() {
+    server_ready = true;
+    /* reactor[0]在当前线程运行，其余reactor各占一个线程 */
+    for(size_t i = 1; i < reactors_.size(); ++i) {
+        reactor_threads_.push_back(std::thread(&reactor::loop, reactors_[i].get()));
     }
-    epler_->del_fd(fd);
-    //TODO: 是否考虑线程安全问题
-    users_.erase(fd);
-    LOG_INFO("deal close, fd(%d) is closed", fd);
+    reactors_[0]->loop();
 }
 
 void web_server::init_epoll_mode() {
@@ -165,4 +76,32 @@ void web_server::init_epoll_mode() {
         default:
             break;
     }
+}
+
+/**
+ * @brief 配置了HTTPS端口时加载证书，失败则只提供HTTP
+ */
+void web_server::init_tls() {
+    if(options.tls_port <= 0) {
+        return;
+    }
+    tls_.reset(new tls_context());
+    if(!tls_->init(options.tls_cert, options.tls_key)) {
+        LOG_ERROR("tls init failed, https port %d disabled", options.tls_port);
+        tls_.reset();
+    }
+}
+
+/**
+ * @brief 注册抓取/metrics时才读取的指标
+ */
+void web_server::init_metrics() {
+    metrics* m = metrics::get_instance();
+    thread_pool* pool = threadpool_.get();
+    m->add_collector("sws_thread_pool_queue_depth", "Tasks submitted but not yet taken by a worker.", "gauge",
+                     [pool]() { return static_cast<double>(pool->pending_tasks()); });
+    m->add_collector("sws_log_dropped_total", "Log records dropped because a per-thread ring was full.", "counter",
+                     []() { return static_cast<double>(Log::get_instance()->dropped()); });
+    m->add_collector("sws_static_cache_bytes", "Bytes held by the static cache.", "gauge",
+                     []() { return static_cast<double>(static_cache::get_instance()->stats().bytes); });
 }
\ No newline at end of file
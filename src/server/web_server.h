@@ -2,31 +2,13 @@
 #define _WEB_SERVER_H
 
 #include <memory>
-#include <unordered_map>
+#include <thread>
+#include <vector>
 
 #include "../pool/thread_pool.h"
-#include "../timer/heap_timer.h"
-#include "epoll/epoller.h"
-#include "http/http_session.h"
+#include "reactor.h"
 
 
-/**
- * @brief socket options
- */
-class socket_options {
-public:
-    socket_options(int p, bool linger, bool reuseaddr): 
-        port(p) ,opt_linger(linger), opt_reuseaddr(reuseaddr) {}
-
-    ~socket_options() = default;
-
-    int port;
-
-    bool opt_linger;
-
-    bool opt_reuseaddr;
-};
-
 /**
  * @brief web server实例
  * 
@@ -51,16 +33,11 @@ public:
     void start();
 
 private:
-    void init_socket();
-    void deal_listen(int fd);
-    void deal_write(int fd);
-    void deal_read(int fd);
-    void deal_close(int fd);
-    void check_user_exist(int fd);
     void init_epoll_mode();
+    void init_metrics();
+    void init_tls();
 
 private:
-    int sock_fd;
     bool server_ready;
     int max_rdwd_idle_time;
     socket_options options;
@@ -70,9 +47,9 @@ private:
     uint32_t conn_event;
 
     std::unique_ptr<thread_pool> threadpool_;
-    std::unique_ptr<heap_timer> timer_;
-    std::shared_ptr<epoller> epler_;
-    std::unordered_map<int, std::shared_ptr<http_session>> users_;
+    std::unique_ptr<tls_context> tls_;           // 未开启HTTPS时为空
+    std::vector<std::unique_ptr<reactor>> reactors_;
+    std::vector<std::thread> reactor_threads_;
 };
 
 #endif
\ No newline at end of file
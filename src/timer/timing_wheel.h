@@ -0,0 +1,303 @@
+#ifndef _TIMING_WHEEL_H
+#define _TIMING_WHEEL_H
+
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+
+/**
+ * @brief 分层时间轮，关闭超时的非活动连接，接口与heap_timer保持一致
+ *  1. 4层 x 64槽，tick精度默认10ms，最长约46小时
+ *  2. 节点按fd平铺在数组中，以数组下标构成侵入式双向链表：
+ *     add/update/del均为O(1)，无hash查找，也无每次更新的堆调整
+ *  3. 每个tick只处理一个槽，超时节点先整体摘下再批量回调
+ *  4. 低层转完一圈时将上层对应槽的节点下放(cascade)
+ */
+class timing_wheel {
+
+public:
+    typedef std::function<void()> timeout_callback;
+    typedef std::function<void(int)> expire_handler;
+
+    static const int WHEEL_BITS = 6;
+    static const int WHEEL_SLOTS = 1 << WHEEL_BITS;
+    static const int WHEEL_MASK = WHEEL_SLOTS - 1;
+    static const int WHEEL_LEVELS = 4;
+
+public:
+    explicit timing_wheel(int tick_ms = 10): tick_ms_(tick_ms > 0 ? tick_ms : 1), now_tick_(0), count_(0) {
+        start_ = std::chrono::steady_clock::now();
+        for(int l = 0; l < WHEEL_LEVELS; ++l) {
+            for(int s = 0; s < WHEEL_SLOTS; ++s) {
+                heads_[l][s] = NIL;
+            }
+        }
+        nodes_.reserve(1024);
+    }
+
+    ~timing_wheel() {}
+
+    timing_wheel(const timing_wheel&) = delete;
+    timing_wheel& operator=(const timing_wheel&) = delete;
+
+    /**
+     * @brief 所有未指定回调的节点超时后调用handler(fd)，避免每个连接构造一个std::function
+     */
+    void set_expire_handler(const expire_handler& handler) {
+        handler_ = handler;
+    }
+
+    void add(int fd, int time_out) {
+        assert(fd >= 0);
+        wheel_node& node = node_of(fd);
+        node.cb = nullptr;
+        schedule(fd, node, time_out);
+    }
+
+    void add(int fd, int time_out, const timeout_callback& cb) {
+        assert(fd >= 0);
+        wheel_node& node = node_of(fd);
+        node.cb = cb;
+        schedule(fd, node, time_out);
+    }
+
+    void del(int fd, bool callback) {
+        if(fd < 0 || static_cast<size_t>(fd) >= nodes_.size() || !nodes_[fd].active) {
+            return;
+        }
+        unlink(fd);
+        if(callback) {
+            fire(fd);
+        }
+    }
+
+    void update(int fd, int time_out) {
+        assert(fd >= 0 && static_cast<size_t>(fd) < nodes_.size() && nodes_[fd].active);
+        schedule(fd, nodes_[fd], time_out);
+    }
+
+    void tick() {
+        uint64_t target = current_tick();
+        if(count_ == 0) {
+            now_tick_ = target;
+            return;
+        }
+        while(now_tick_ < target && count_ > 0) {
+            advance();
+        }
+        if(count_ == 0 && now_tick_ < target) {
+            now_tick_ = target;
+        }
+    }
+
+    /**
+     * @brief 处理超时节点，返回距离下一次需要处理的毫秒数，没有定时任务时返回-1
+     */
+    size_t get_next_tick() {
+        tick();
+        if(count_ == 0) {
+            return -1;
+        }
+        /* 第0层中最近的非空槽；找不到时在第0层转完一圈时唤醒以便下放上层节点 */
+        uint64_t ticks = WHEEL_SLOTS - (now_tick_ & WHEEL_MASK);
+        for(uint64_t i = 1; i < ticks; ++i) {
+            if(heads_[0][(now_tick_ + i) & WHEEL_MASK] != NIL) {
+                ticks = i;
+                break;
+            }
+        }
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        int64_t res = static_cast<int64_t>(now_tick_ + ticks) * tick_ms_ - elapsed;
+        return res < 0 ? 0 : static_cast<size_t>(res);
+    }
+
+    void clear() {
+        for(size_t fd = 0; fd < nodes_.size(); ++fd) {
+            nodes_[fd].active = false;
+            nodes_[fd].cb = nullptr;
+        }
+        for(int l = 0; l < WHEEL_LEVELS; ++l) {
+            for(int s = 0; s < WHEEL_SLOTS; ++s) {
+                heads_[l][s] = NIL;
+            }
+        }
+        count_ = 0;
+    }
+
+    bool empty() {
+        return count_ == 0;
+    }
+
+    size_t size() const {
+        return count_;
+    }
+
+    /**
+     * @brief 输出各层非空槽详情
+     * level[0] slot[3]: fd = xxx    expire duration = xxx
+     */
+    void print() {
+        for(int l = 0; l < WHEEL_LEVELS; ++l) {
+            for(int s = 0; s < WHEEL_SLOTS; ++s) {
+                for(int fd = heads_[l][s]; fd != NIL; fd = nodes_[fd].next) {
+                    std::cout << "\tlevel[" << l << "] slot[" << s << "]: fd = " << fd;
+                    std::cout << "\texpire duration = "
+                              << (static_cast<int64_t>(nodes_[fd].expire) - static_cast<int64_t>(now_tick_)) * tick_ms_
+                              << "\n";
+                }
+            }
+        }
+        std::cout << "\n";
+    }
+
+private:
+    static const int NIL = -1;
+
+    struct wheel_node {
+        int prev = NIL;
+        int next = NIL;
+        uint64_t expire = 0;        // 超时的tick
+        uint8_t level = 0;
+        uint8_t slot = 0;
+        bool active = false;
+        timeout_callback cb;
+    };
+
+    wheel_node& node_of(int fd) {
+        if(static_cast<size_t>(fd) >= nodes_.size()) {
+            nodes_.resize(fd + 1);
+        }
+        return nodes_[fd];
+    }
+
+    uint64_t current_tick() const {
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        return static_cast<uint64_t>(elapsed / tick_ms_);
+    }
+
+    void schedule(int fd, wheel_node& node, int time_out) {
+        if(node.active) {
+            unlink(fd);
+        }
+        /* tick对齐到当前时间，至少一个tick之后才超时 */
+        if(count_ == 0) {
+            now_tick_ = current_tick();
+        }
+        uint64_t ticks = time_out <= 0 ? 1 : (static_cast<uint64_t>(time_out) + tick_ms_ - 1) / tick_ms_;
+        node.expire = now_tick_ + ticks;
+        link(fd, node);
+    }
+
+    void link(int fd, wheel_node& node) {
+        uint64_t delta = node.expire > now_tick_ ? node.expire - now_tick_ : 0;
+        uint64_t expire = node.expire;
+        int level = 0;
+        while(level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+            ++level;
+        }
+        if(level == WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * WHEEL_LEVELS))) {
+            /* 超出时间轮范围，放在最高层最远的槽 */
+            expire = now_tick_ + (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+        }
+        int slot = static_cast<int>((expire >> (WHEEL_BITS * level)) & WHEEL_MASK);
+
+        node.level = static_cast<uint8_t>(level);
+        node.slot = static_cast<uint8_t>(slot);
+        node.prev = NIL;
+        node.next = heads_[level][slot];
+        if(node.next != NIL) {
+            nodes_[node.next].prev = fd;
+        }
+        heads_[level][slot] = fd;
+        node.active = true;
+        ++count_;
+    }
+
+    void unlink(int fd) {
+        wheel_node& node = nodes_[fd];
+        if(node.prev != NIL) {
+            nodes_[node.prev].next = node.next;
+        } else {
+            heads_[node.level][node.slot] = node.next;
+        }
+        if(node.next != NIL) {
+            nodes_[node.next].prev = node.prev;
+        }
+        node.prev = node.next = NIL;
+        node.active = false;
+        --count_;
+    }
+
+    /**
+     * @brief 将某层某槽的全部节点按剩余时间重新挂到低层
+     */
+    void cascade(int level, int slot) {
+        int fd = heads_[level][slot];
+        heads_[level][slot] = NIL;
+        while(fd != NIL) {
+            int next = nodes_[fd].next;
+            nodes_[fd].active = false;
+            --count_;
+            link(fd, nodes_[fd]);
+            fd = next;
+        }
+    }
+
+    void advance() {
+        ++now_tick_;
+        /* 低层转完一圈，依次下放上层节点 */
+        for(int level = 1; level < WHEEL_LEVELS; ++level) {
+            if((now_tick_ & ((1ULL << (WHEEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(level, static_cast<int>((now_tick_ >> (WHEEL_BITS * level)) & WHEEL_MASK));
+        }
+
+        int slot = static_cast<int>(now_tick_ & WHEEL_MASK);
+        if(heads_[0][slot] == NIL) {
+            return;
+        }
+        /* 先摘下整个槽再批量回调，回调中可以安全地add/del */
+        expired_.clear();
+        for(int fd = heads_[0][slot]; fd != NIL; fd = nodes_[fd].next) {
+            expired_.push_back(fd);
+        }
+        for(size_t i = 0; i < expired_.size(); ++i) {
+            unlink(expired_[i]);
+        }
+        for(size_t i = 0; i < expired_.size(); ++i) {
+            /* 之前的回调中重新add的节点不再触发 */
+            if(!nodes_[expired_[i]].active) {
+                fire(expired_[i]);
+            }
+        }
+    }
+
+    void fire(int fd) {
+        if(nodes_[fd].cb) {
+            timeout_callback cb = nodes_[fd].cb;
+            cb();
+        } else if(handler_) {
+            handler_(fd);
+        }
+    }
+
+private:
+    int tick_ms_;
+    uint64_t now_tick_;
+    size_t count_;
+    std::chrono::steady_clock::time_point start_;
+
+    int heads_[WHEEL_LEVELS][WHEEL_SLOTS];
+    std::vector<wheel_node> nodes_;
+    std::vector<int> expired_;
+    expire_handler handler_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef _GZIP_CODEC_H
+#define _GZIP_CODEC_H
+
+#include <string>
+#include <cstring>
+#include <zlib.h>
+
+/**
+ * @brief 用zlib将data压缩为gzip格式(带gzip头尾)，静态资源只在加载时压缩一次，默认使用最高压缩级别
+ */
+inline bool gzip_compress(const char* data, size_t len, std::string& out, int level = Z_BEST_COMPRESSION) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    /* windowBits + 16: 输出gzip格式而不是zlib格式 */
+    if(deflateInit2(&zs, level, Z_DEFLATED, MAX_WBITS + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out.resize(deflateBound(&zs, len) + 32);
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zs.avail_in = static_cast<uInt>(len);
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    int ret = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
+
+#endif
\ No newline at end of file
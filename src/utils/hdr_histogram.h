@@ -0,0 +1,141 @@
+#ifndef _HDR_HISTOGRAM_H
+#define _HDR_HISTOGRAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 对数-线性分桶的高动态范围直方图(HDR)，用于记录延迟
+ *  1. 小于128的值逐个计数，之后每个2的幂区间再均分为64个桶，相对误差不超过1/64
+ *  2. 覆盖完整的uint64范围，record只做一次clz和一次数组自增
+ *  3. 非线程安全: 每个线程持有自己的实例，汇总时merge
+ */
+class hdr_histogram {
+
+public:
+    static const int SUB_BUCKET_BITS = 7;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static const int BUCKET_NUM = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+
+public:
+    hdr_histogram(): counts_(BUCKET_NUM, 0) {
+        reset();
+    }
+
+    void record(uint64_t value) {
+        record(value, 1);
+    }
+
+    void record(uint64_t value, uint64_t n) {
+        counts_[index_of(value)] += n;
+        total_ += n;
+        sum_ += value * n;
+        if(value < min_) {
+            min_ = value;
+        }
+        if(value > max_) {
+            max_ = value;
+        }
+    }
+
+    void merge(const hdr_histogram& other) {
+        for(int i = 0; i < BUCKET_NUM; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        sum_ += other.sum_;
+        if(other.min_ < min_) {
+            min_ = other.min_;
+        }
+        if(other.max_ > max_) {
+            max_ = other.max_;
+        }
+    }
+
+    void reset() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        sum_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+    }
+
+    /**
+     * @brief 第percentile(0~100)百分位的值，返回所在桶的上界(不超过max)
+     */
+    uint64_t value_at_percentile(double percentile) const {
+        if(total_ == 0) {
+            return 0;
+        }
+        if(percentile > 100.0) {
+            percentile = 100.0;
+        }
+        uint64_t target = static_cast<uint64_t>(percentile / 100.0 * total_ + 0.5);
+        if(target == 0) {
+            target = 1;
+        }
+        uint64_t seen = 0;
+        for(int i = 0; i < BUCKET_NUM; ++i) {
+            seen += counts_[i];
+            if(seen >= target) {
+                uint64_t value = highest_equivalent(i);
+                return value < max_ ? value : max_;
+            }
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t min() const { return total_ == 0 ? 0 : min_; }
+    uint64_t max() const { return max_; }
+
+    double mean() const {
+        return total_ == 0 ? 0.0 : static_cast<double>(sum_) / total_;
+    }
+
+    /**
+     * @brief 桶的个数与桶i的计数、上界，用于按桶导出(如Prometheus)
+     */
+    int bucket_num() const { return BUCKET_NUM; }
+    uint64_t bucket_count(int i) const { return counts_[i]; }
+
+    static int index_of(uint64_t value) {
+        if(value < static_cast<uint64_t>(SUB_BUCKET_COUNT)) {
+            return static_cast<int>(value);
+        }
+        /* value落在[2^msb, 2^(msb+1))，右移后保留7位有效数字，落在[64, 128) */
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - (SUB_BUCKET_BITS - 1);
+        return shift * SUB_BUCKET_HALF + static_cast<int>(value >> shift);
+    }
+
+    static uint64_t lowest_equivalent(int index) {
+        if(index < SUB_BUCKET_COUNT) {
+            return static_cast<uint64_t>(index);
+        }
+        int shift = index / SUB_BUCKET_HALF - 1;
+        uint64_t sub = static_cast<uint64_t>(index % SUB_BUCKET_HALF + SUB_BUCKET_HALF);
+        return sub << shift;
+    }
+
+    static uint64_t highest_equivalent(int index) {
+        if(index < SUB_BUCKET_COUNT) {
+            return static_cast<uint64_t>(index);
+        }
+        int shift = index / SUB_BUCKET_HALF - 1;
+        uint64_t sub = static_cast<uint64_t>(index % SUB_BUCKET_HALF + SUB_BUCKET_HALF);
+        return ((sub + 1) << shift) - 1;
+    }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+#ifndef _PERFECT_HASH_H
+#define _PERFECT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief 编译期生成的只读完美哈希表(C++11 constexpr)
+ *  1. 键集合在编译期确定，从0开始搜索一个seed使所有键落在不同的槽，找不到时valid()为false，由static_assert报错
+ *  2. 槽中存放条目下标，查找 = 长度检查 + 一次哈希 + 一次槽读取 + 一次比较，不分配内存，没有探测循环
+ *  3. 字符串键为str_view，可以直接指向请求缓冲区；也支持int键(状态码)
+ * C++11的constexpr函数只能有一条return语句，构造过程都写成递归
+ */
+namespace perfect_hash {
+
+/**
+ * @brief 不持有内存的字符串片段
+ */
+struct str_view {
+    const char* data;
+    size_t len;
+
+    std::string to_string() const { return std::string(data, len); }
+};
+
+template<size_t L>
+constexpr str_view view(const char (&s)[L]) {
+    return str_view{s, L - 1};
+}
+
+inline std::ostream& operator<<(std::ostream& os, const str_view& s) {
+    return os.write(s.data, s.len);
+}
+
+template<typename K, typename V>
+struct entry {
+    K key;
+    V value;
+};
+
+/* FNV-1a，seed混入初始值 */
+constexpr uint32_t hash_bytes(const char* s, size_t len, uint32_t h) {
+    return len == 0 ? h : hash_bytes(s + 1, len - 1, (h ^ static_cast<unsigned char>(*s)) * 16777619u);
+}
+
+constexpr uint32_t hash_key(const str_view& key, uint32_t seed) {
+    return hash_bytes(key.data, key.len, 2166136261u ^ (seed * 0x9e3779b9u));
+}
+
+constexpr uint32_t hash_key(int key, uint32_t seed) {
+    return (static_cast<uint32_t>(key) ^ (seed * 0x9e3779b9u)) * 0x85ebca6bu;
+}
+
+/* 超过表中最长键的字符串不必计算哈希 */
+constexpr size_t key_size(const str_view& key) {
+    return key.len;
+}
+
+constexpr size_t key_size(int) {
+    return 0;
+}
+
+inline bool key_equal(const str_view& a, const str_view& b) {
+    return a.len == b.len && memcmp(a.data, b.data, a.len) == 0;
+}
+
+inline bool key_equal(int a, int b) {
+    return a == b;
+}
+
+constexpr size_t slot_of(uint32_t h, size_t size) {
+    return (h ^ (h >> 16)) & (size - 1);
+}
+
+
+namespace detail {
+
+const uint32_t MAX_SEED = 256;      // 递归深度受constexpr嵌套上限(默认512)约束
+
+template<size_t... I> struct index_seq {};
+template<size_t N, size_t... I> struct make_index_seq: make_index_seq<N - 1, N - 1, I...> {};
+template<size_t... I> struct make_index_seq<0, I...> { typedef index_seq<I...> type; };
+
+template<typename E>
+constexpr size_t slot(const E* e, size_t i, uint32_t seed, size_t size) {
+    return slot_of(hash_key(e[i].key, seed), size);
+}
+
+/* e[i]与e[j..n)中的某个条目落在同一个槽 */
+template<typename E>
+constexpr bool collides(const E* e, size_t n, size_t i, size_t j, uint32_t seed, size_t size) {
+    return j < n && (slot(e, i, seed, size) == slot(e, j, seed, size) || collides(e, n, i, j + 1, seed, size));
+}
+
+template<typename E>
+constexpr bool perfect(const E* e, size_t n, size_t i, uint32_t seed, size_t size) {
+    return i >= n || (!collides(e, n, i, i + 1, seed, size) && perfect(e, n, i + 1, seed, size));
+}
+
+template<typename E>
+constexpr uint32_t find_seed(const E* e, size_t n, size_t size, uint32_t seed) {
+    return seed >= MAX_SEED || perfect(e, n, 0, seed, size) ? seed : find_seed(e, n, size, seed + 1);
+}
+
+/* 落在槽s的条目下标 + 1，空槽为0 */
+template<typename E>
+constexpr uint8_t occupant(const E* e, size_t n, size_t i, uint32_t seed, size_t size, size_t s) {
+    return i >= n ? 0 : slot(e, i, seed, size) == s ? static_cast<uint8_t>(i + 1)
+                                                    : occupant(e, n, i + 1, seed, size, s);
+}
+
+template<typename E>
+constexpr size_t max_key_size(const E* e, size_t n, size_t i, size_t res) {
+    return i >= n ? res : max_key_size(e, n, i + 1, key_size(e[i].key) > res ? key_size(e[i].key) : res);
+}
+
+}
+
+
+/**
+ * @brief 由make_table在编译期构造，条目数组须为静态存储期的constexpr数组
+ */
+template<typename K, typename V, size_t N, size_t SIZE>
+class table {
+    static_assert(N > 0 && N < 255, "table holds 1 to 254 entries");
+    static_assert(SIZE >= N && (SIZE & (SIZE - 1)) == 0, "slot count must be a power of two no less than N");
+
+public:
+    typedef entry<K, V> entry_type;
+
+    template<size_t... I>
+    constexpr table(const entry_type* e, uint32_t s, detail::index_seq<I...>):
+        entries(e), seed(s), max_size(detail::max_key_size(e, N, 0, 0)),
+        slots{ detail::occupant(e, N, 0, s, SIZE, I)... } {}
+
+    constexpr bool valid() const { return seed < detail::MAX_SEED; }
+
+    /**
+     * @return 命中的条目，没有时返回nullptr
+     */
+    const entry_type* find(const K& key) const {
+        if(key_size(key) > max_size) {
+            return nullptr;
+        }
+        uint8_t idx = slots[slot_of(hash_key(key, seed), SIZE)];
+        return idx != 0 && key_equal(entries[idx - 1].key, key) ? &entries[idx - 1] : nullptr;
+    }
+
+private:
+    const entry_type* entries;
+    uint32_t seed;
+    size_t max_size;
+    uint8_t slots[SIZE];
+};
+
+/**
+ * @tparam SIZE 槽数(2的幂)，取键数的2~4倍时很快能找到seed
+ */
+template<size_t SIZE, typename K, typename V, size_t N>
+constexpr table<K, V, N, SIZE> make_table(const entry<K, V> (&e)[N]) {
+    return table<K, V, N, SIZE>(e, detail::find_seed(e, N, SIZE, 0), typename detail::make_index_seq<SIZE>::type());
+}
+
+}
+
+#endif
\ No newline at end of file
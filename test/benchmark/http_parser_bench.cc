@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <unordered_map>
+
+#include "http_parser.h"
+#include "http_request.h"
+
+/**
+ * @brief 对比旧的逐行std::regex解析与http_parser各指令集级别的吞吐(bytes/sec)，
+ *  以及解析后填充请求对象的两种方式: 片段拷贝为std::string + map，与http_request直接保存片段
+ * ./bench_parser [iterations]
+ */
+
+namespace {
+
+const std::string REQUEST =
+    "GET /css/bootstrap.min.css HTTP/1.1\r\n"
+    "Host: 127.0.0.1:9000\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0 Safari/537.36\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Referer: http://127.0.0.1:9000/index.html\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Cache-Control: no-cache\r\n"
+    "\r\n";
+
+/* 与旧版http_session一致: 每行拷贝成std::string并现场构造std::regex */
+size_t parse_with_regex(const std::string& req) {
+    size_t fields = 0;
+    size_t start = 0;
+    bool request_line = true;
+    while(true) {
+        size_t pos = req.find("\r\n", start);
+        if(pos == std::string::npos) {
+            break;
+        }
+        std::string line = req.substr(start, pos - start);
+        start = pos + 2;
+        if(line.empty()) {
+            break;
+        }
+        std::smatch sub_match;
+        if(request_line) {
+            std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+            if(std::regex_match(line, sub_match, patten)) {
+                fields += 3;
+            }
+            request_line = false;
+        } else {
+            std::regex patten("^([^:]*): ?(.*)$");
+            if(std::regex_match(line, sub_match, patten)) {
+                fields += 2;
+            }
+        }
+    }
+    return fields;
+}
+
+size_t parse_with_parser(const std::string& req) {
+    http_request_head head;
+    size_t consumed = 0;
+    if(http_parser::parse_request(req.data(), req.size(), head, consumed) != http_parser::PARSE_OK) {
+        return 0;
+    }
+    return 3 + head.header_num * 2;
+}
+
+/* 与之前的process_read_buf一致: 请求行与每个请求头都拷贝成std::string，请求头插入map */
+size_t fill_copied(const std::string& req) {
+    static std::string method, path, version;
+    static std::unordered_map<std::string, std::string> headers;
+    http_request_head head;
+    size_t consumed = 0;
+    if(http_parser::parse_request(req.data(), req.size(), head, consumed) != http_parser::PARSE_OK) {
+        return 0;
+    }
+    headers.clear();
+    method = head.method.to_string();
+    path = head.path.to_string();
+    version = head.version.to_string();
+    for(size_t i = 0; i < head.header_num; ++i) {
+        headers[head.headers[i].name.to_string()] = head.headers[i].value.to_string();
+    }
+    return 3 + headers.size() * 2;
+}
+
+/* 当前的process_read_buf: http_request只保存指向缓冲区的片段，对象跨请求复用 */
+size_t fill_slices(const std::string& req) {
+    static http_request request;
+    http_request_head head;
+    size_t consumed = 0;
+    if(http_parser::parse_request(req.data(), req.size(), head, consumed) != http_parser::PARSE_OK) {
+        return 0;
+    }
+    request.reset();
+    request.set_request_line(head.method, head.path, head.version);
+    for(size_t i = 0; i < head.header_num; ++i) {
+        request.set_requset_header(head.headers[i].name, head.headers[i].value);
+    }
+    return 3 + head.header_num * 2 + (request.accept_gzip() ? 0 : 1);
+}
+
+template<typename Fn>
+void run(const char* name, size_t iterations, Fn fn) {
+    auto begin = std::chrono::steady_clock::now();
+    size_t fields = 0;
+    for(size_t i = 0; i < iterations; ++i) {
+        fields += fn(REQUEST);
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    double bytes = static_cast<double>(REQUEST.size()) * iterations;
+    printf("%-16s %10zu req %10.3f s %12.1f MB/s %12.0f req/s (fields %zu)\n",
+           name, iterations, sec, bytes / sec / 1e6, iterations / sec, fields);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+
+    run("regex", iterations / 100, parse_with_regex);
+
+    const char* names[] = {"parser-scalar", "parser-sse4.2", "parser-avx2"};
+    http_parser::SIMD_LEVEL levels[] = {http_parser::SIMD_SCALAR, http_parser::SIMD_SSE42, http_parser::SIMD_AVX2};
+    for(int i = 0; i < 3; ++i) {
+        if(http_parser::set_simd_level(levels[i]) != levels[i]) {
+            printf("%-16s unsupported on this cpu\n", names[i]);
+            continue;
+        }
+        run(names[i], iterations, parse_with_parser);
+    }
+
+    http_parser::set_simd_level(levels[2]);
+    run("request-copied", iterations, fill_copied);
+    run("request-slices", iterations, fill_slices);
+    return 0;
+}
\ No newline at end of file
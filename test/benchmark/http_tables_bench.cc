@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "http_tables.h"
+
+/**
+ * @brief 对比旧的unordered_map/unordered_set查找与编译期完美哈希表，每个"请求"依次做:
+ *  路由映射(请求路径 -> 资源路径)、MIME类型(资源后缀)、状态行文本
+ * ./bench_tables [iterations]
+ */
+
+namespace {
+
+/* 与旧版http_request/http_response一致的表 */
+const std::unordered_set<std::string> DEFAULT_HTML {
+    "/index", "/register", "/login", "/welcome", "/video", "/picture" };
+
+const std::unordered_map<std::string, std::string> SUFFIX_TYPE = {
+    { ".html",  "text/html" }, { ".xml", "text/xml" }, { ".xhtml", "application/xhtml+xml" },
+    { ".txt", "text/plain" }, { ".rtf", "application/rtf" }, { ".pdf", "application/pdf" },
+    { ".word", "application/nsword" }, { ".png", "image/png" }, { ".gif", "image/gif" },
+    { ".jpg", "image/jpeg" }, { ".jpeg", "image/jpeg" }, { ".au", "audio/basic" },
+    { ".mpeg", "video/mpeg" }, { ".mpg", "video/mpeg" }, { ".avi", "video/x-msvideo" },
+    { ".gz", "application/x-gzip" }, { ".tar", "application/x-tar" }, { ".css", "text/css" },
+    { ".js", "text/javascript" }, { ".svg", "image/svg+xml" }, { ".ico", "image/x-icon" },
+    { ".ttf", "font/ttf" }, { ".otf", "font/otf" }, { ".woff", "font/woff" },
+    { ".woff2", "font/woff2" }, { ".eot", "application/vnd.ms-fontobject" },
+};
+
+const std::unordered_map<int, std::string> CODE_STATUS = {
+    { 200, "OK" }, { 206, "Partial Content" }, { 304, "Not Modified" }, { 400, "Bad Request" },
+    { 403, "Forbidden" }, { 404, "Not Found" }, { 416, "Range Not Satisfiable" },
+};
+
+/* 首页及其引用的静态资源 */
+const char* const PATHS[] = {
+    "/", "/css/bootstrap.min.css", "/css/animate.css", "/css/style.css", "/js/jquery.js",
+    "/js/bootstrap.min.js", "/images/favicon.ico", "/images/profile-image.jpg", "/login", "/video",
+    "/fonts/fontawesome-webfont.woff2", "/images/instagram-image1.jpg", "/picture", "/register",
+};
+const int CODES[] = { 200, 200, 200, 304, 200, 206, 404, 200 };
+
+/* 旧流程: 逐个比较默认页面，再substr后缀查表；两种流程都生成一次资源路径(req_path) */
+size_t lookup_old(const std::string& path, int code) {
+    std::string res_path = path;
+    if(path == "/") {
+        res_path = "/index.html";
+    } else {
+        for(auto& item: DEFAULT_HTML) {
+            if(item == path) {
+                res_path += ".html";
+                break;
+            }
+        }
+    }
+    size_t n = res_path.size();
+    std::string::size_type idx = res_path.find_last_of('.');
+    std::string type = "text/plain";
+    if(idx != std::string::npos) {
+        std::string suffix = res_path.substr(idx);
+        if(SUFFIX_TYPE.count(suffix) == 1) {
+            type = SUFFIX_TYPE.find(suffix)->second;
+        }
+    }
+    std::string status = CODE_STATUS.count(code) == 1 ? CODE_STATUS.find(code)->second : CODE_STATUS.find(400)->second;
+    return n + type.size() + status.size();
+}
+
+/* 新流程: 键直接指向请求缓冲区，后缀指向资源路径，查找本身不分配内存 */
+size_t lookup_new(const std::string& buf, int code) {
+    const auto* route = http_tables::ROUTES.find(perfect_hash::str_view{ buf.data(), buf.size() });
+    std::string res_path = route ? route->value.to_string() : buf;
+    size_t n = res_path.size();
+    const http_tables::mime_type* mime = &http_tables::DEFAULT_MIME;
+    std::string::size_type idx = res_path.find_last_of('.');
+    if(idx != std::string::npos) {
+        const auto* found = http_tables::MIME_TYPES.find(perfect_hash::str_view{ res_path.data() + idx, res_path.size() - idx });
+        if(found) {
+            mime = &found->value;
+        }
+    }
+    const auto* status = http_tables::STATUS_TEXT.find(code);
+    if(status == nullptr) {
+        status = http_tables::STATUS_TEXT.find(400);
+    }
+    return n + mime->type.len + status->value.reason.len;
+}
+
+template<typename Fn>
+void run(const char* name, Fn fn, const std::vector<std::string>& bufs, size_t iterations) {
+    size_t sink = 0;
+    const size_t path_num = bufs.size();
+    const size_t code_num = sizeof(CODES) / sizeof(CODES[0]);
+    auto begin = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < iterations; ++i) {
+        sink += fn(bufs[i % path_num], CODES[i % code_num]);
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    printf("%-14s %10zu requests %8.3f s %8.1f ns/request (checksum %zu)\n",
+           name, iterations, sec, sec * 1e9 / iterations, sink);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000000;
+    /* 路径放在独立分配的缓冲区中，模拟请求缓冲区里的片段 */
+    std::vector<std::string> bufs;
+    for(const char* p: PATHS) {
+        bufs.push_back(p);
+    }
+    run("unordered_map", lookup_old, bufs, iterations);
+    run("perfect_hash", lookup_new, bufs, iterations);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,579 @@
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <errno.h>
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hdr_histogram.h"
+
+/**
+ * @brief HTTP压测客户端，每个线程一个epoll循环，驱动若干条连接
+ *  1. 闭环模式: 每条连接保持pipeline个在途请求，响应回来立即发下一个
+ *  2. 开环模式(-r): 按固定速率为每条连接排定请求的计划发送时间，
+ *     延迟从计划时间开始计算，服务端变慢时排队时间也计入，避免coordinated omission
+ *  3. 慢客户端模式(-S): 每隔interval只写/读slow_bytes字节，模拟慢速网络
+ *
+ * ./bench_load [-c conns] [-t threads] [-d seconds] [-r total_rps] [-p pipeline]
+ *              [-k 0|1] [-S interval_ms] [-b slow_bytes] http://127.0.0.1:9000/index.html
+ */
+
+namespace {
+
+struct load_options {
+    std::string host = "127.0.0.1";
+    int port = 9000;
+    std::string path = "/";
+    int conns = 64;
+    int threads = 4;
+    int duration = 10;
+    double rate = 0;            // 总请求速率，0为闭环
+    int pipeline = 1;
+    bool keepalive = true;
+    int slow_interval_ms = 0;   // 0为正常客户端
+    int slow_bytes = 1;
+};
+
+struct load_stats {
+    uint64_t completed = 0;
+    uint64_t non_2xx = 0;
+    uint64_t errors = 0;
+    uint64_t reconnects = 0;
+    uint64_t bytes_read = 0;
+    hdr_histogram latency;      // 纳秒
+};
+
+enum RESPONSE_STATE {
+    RESPONSE_HEADER = 0,
+    RESPONSE_BODY
+};
+
+struct load_conn {
+    int fd = -1;
+    bool connecting = false;
+    bool readable = false;
+    bool writable = false;
+
+    std::string out;            // 待发送的请求字节
+    size_t out_off = 0;
+    std::deque<uint64_t> queued;    // 开环模式下已到计划时间、尚未发出的请求
+    std::deque<uint64_t> inflight;  // 已发出请求的起始时间
+    uint64_t next_send_ns = 0;
+    uint64_t next_slow_ns = 0;
+
+    RESPONSE_STATE state = RESPONSE_HEADER;
+    std::string header;
+    uint64_t body_remain = 0;
+    bool server_close = false;
+};
+
+std::atomic<bool> g_running(true);
+
+uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+void on_signal(int) {
+    g_running.store(false);
+}
+
+bool parse_url(const std::string& url, load_options& opt) {
+    std::string rest = url;
+    const std::string scheme = "http://";
+    if(rest.compare(0, scheme.size(), scheme) == 0) {
+        rest = rest.substr(scheme.size());
+    }
+    size_t slash = rest.find('/');
+    std::string host_port = rest.substr(0, slash);
+    opt.path = slash == std::string::npos ? "/" : rest.substr(slash);
+    size_t colon = host_port.find(':');
+    opt.host = host_port.substr(0, colon);
+    if(colon != std::string::npos) {
+        opt.port = atoi(host_port.c_str() + colon + 1);
+    } else {
+        opt.port = 80;
+    }
+    return !opt.host.empty() && opt.port > 0;
+}
+
+bool header_equals(const char* a, const char* b, size_t n) {
+    return strncasecmp(a, b, n) == 0;
+}
+
+/**
+ * @brief 从响应头中取状态码、Content-Length和Connection: close
+ */
+bool parse_header(const std::string& header, int& code, uint64_t& content_len, bool& close) {
+    if(header.size() < 12 || header.compare(0, 5, "HTTP/") != 0) {
+        return false;
+    }
+    code = atoi(header.c_str() + 9);
+    content_len = 0;
+    close = header.compare(0, 8, "HTTP/1.0") == 0;
+    bool has_len = false;
+    size_t pos = header.find("\r\n");
+    while(pos != std::string::npos && pos + 2 < header.size()) {
+        size_t line = pos + 2;
+        size_t end = header.find("\r\n", line);
+        if(end == std::string::npos || end == line) {
+            break;
+        }
+        const char* p = header.c_str() + line;
+        size_t n = end - line;
+        if(n > 15 && header_equals(p, "content-length:", 15)) {
+            content_len = strtoull(p + 15, nullptr, 10);
+            has_len = true;
+        } else if(n > 11 && header_equals(p, "connection:", 11)) {
+            std::string value(p + 11, n - 11);
+            close = value.find("close") != std::string::npos || value.find("Close") != std::string::npos;
+        }
+        pos = end;
+    }
+    return has_len;
+}
+
+class load_worker {
+
+public:
+    load_worker(const load_options& opt, const struct in_addr& addr, int conns, double rate):
+        opt_(opt), addr_(addr), conns_(conns), epfd_(-1), has_pwait2_(true) {
+        interval_ns_ = rate > 0 ? static_cast<uint64_t>(1e9 * conns / rate) : 0;
+        /* 与wrk等客户端一致: HTTP/1.1默认为持久连接，只在关闭时带Connection请求头 */
+        request_ = "GET " + opt.path + " HTTP/1.1\r\nHost: " + opt.host + ":" + std::to_string(opt.port) +
+                   "\r\nUser-Agent: bench_load\r\n" + (opt.keepalive ? "" : "Connection: close\r\n") + "\r\n";
+        pipeline_ = opt.keepalive ? opt.pipeline : 1;
+    }
+
+    ~load_worker() {
+        for(size_t i = 0; i < conns_.size(); ++i) {
+            if(conns_[i].fd >= 0) {
+                close(conns_[i].fd);
+            }
+        }
+        if(epfd_ >= 0) {
+            close(epfd_);
+        }
+    }
+
+    void run(uint64_t start_ns, uint64_t end_ns) {
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        for(size_t i = 0; i < conns_.size(); ++i) {
+            /* 开环模式下各连接的发送时间错开，避免同一时刻集中发送 */
+            conns_[i].next_send_ns = start_ns + interval_ns_ * i / conns_.size();
+            connect_conn(i);
+        }
+
+        std::vector<struct epoll_event> events(256);
+        while(g_running.load(std::memory_order_relaxed)) {
+            uint64_t now = now_ns();
+            if(now >= end_ns) {
+                break;
+            }
+            uint64_t next_due = end_ns;
+            for(size_t i = 0; i < conns_.size(); ++i) {
+                service(i, now, next_due);
+            }
+            now = now_ns();
+            int n = wait_events(events, next_due > now ? next_due - now : 0);
+            for(int i = 0; i < n; ++i) {
+                load_conn& c = conns_[events[i].data.u32];
+                if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    c.readable = true;
+                }
+                if(events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+                    c.writable = true;
+                }
+            }
+        }
+    }
+
+    const load_stats& stats() const {
+        return stats_;
+    }
+
+private:
+    /**
+     * @brief 开环模式的发送间隔常小于1ms，优先使用纳秒精度的epoll_pwait2，不支持时退化为epoll_wait
+     */
+    int wait_events(std::vector<struct epoll_event>& events, uint64_t timeout_ns) {
+        const uint64_t max_wait = 10000000ULL;
+        timeout_ns = timeout_ns > max_wait ? max_wait : timeout_ns;
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 35)
+        if(has_pwait2_) {
+            struct timespec ts;
+            ts.tv_sec = 0;
+            ts.tv_nsec = static_cast<long>(timeout_ns);
+            int n = epoll_pwait2(epfd_, events.data(), static_cast<int>(events.size()), &ts, nullptr);
+            if(n >= 0 || errno != ENOSYS) {
+                return n;
+            }
+            has_pwait2_ = false;
+        }
+#endif
+        return epoll_wait(epfd_, events.data(), static_cast<int>(events.size()),
+                          static_cast<int>((timeout_ns + 999999) / 1000000));
+    }
+
+    void connect_conn(size_t idx) {
+        load_conn& c = conns_[idx];
+        c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(opt_.port);
+        addr.sin_addr = addr_;
+        int ret = connect(c.fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        c.connecting = ret < 0 && errno == EINPROGRESS;
+        c.readable = false;
+        c.writable = !c.connecting;
+        c.out.clear();
+        c.out_off = 0;
+        c.inflight.clear();
+        c.state = RESPONSE_HEADER;
+        c.header.clear();
+        c.server_close = false;
+        if(ret < 0 && !c.connecting) {
+            stats_.errors++;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u32 = static_cast<uint32_t>(idx);
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    void reconnect(size_t idx, bool error) {
+        load_conn& c = conns_[idx];
+        /* 未收到响应的在途请求计为错误，开环模式下排队中的请求保留 */
+        if(error || !c.inflight.empty()) {
+            stats_.errors += c.inflight.empty() ? 1 : c.inflight.size();
+        }
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+        stats_.reconnects++;
+        if(g_running.load(std::memory_order_relaxed)) {
+            connect_conn(idx);
+        }
+    }
+
+    void service(size_t idx, uint64_t now, uint64_t& next_due) {
+        load_conn& c = conns_[idx];
+        if(c.fd < 0) {
+            return;
+        }
+        if(c.connecting) {
+            if(!c.writable) {
+                return;
+            }
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if(err != 0) {
+                reconnect(idx, true);
+                return;
+            }
+            c.connecting = false;
+        }
+
+        /* 排定请求 */
+        if(interval_ns_ > 0) {
+            while(c.next_send_ns <= now) {
+                c.queued.push_back(c.next_send_ns);
+                c.next_send_ns += interval_ns_;
+            }
+            while(!c.queued.empty() && c.inflight.size() < static_cast<size_t>(pipeline_)) {
+                c.inflight.push_back(c.queued.front());
+                c.queued.pop_front();
+                c.out += request_;
+            }
+            if(c.queued.empty() && c.next_send_ns < next_due) {
+                next_due = c.next_send_ns;
+            }
+        } else {
+            while(c.inflight.size() < static_cast<size_t>(pipeline_)) {
+                c.inflight.push_back(now);
+                c.out += request_;
+            }
+        }
+
+        bool slow = opt_.slow_interval_ms > 0;
+        if(slow) {
+            if(now < c.next_slow_ns) {
+                next_due = c.next_slow_ns < next_due ? c.next_slow_ns : next_due;
+                return;
+            }
+            c.next_slow_ns = now + static_cast<uint64_t>(opt_.slow_interval_ms) * 1000000ULL;
+            next_due = c.next_slow_ns < next_due ? c.next_slow_ns : next_due;
+        }
+        size_t io_limit = slow ? static_cast<size_t>(opt_.slow_bytes) : SIZE_MAX;
+
+        if(c.writable && c.out_off < c.out.size()) {
+            if(!flush_out(c, io_limit)) {
+                reconnect(idx, true);
+                return;
+            }
+        }
+        if(c.readable) {
+            if(!read_in(idx, io_limit)) {
+                reconnect(idx, !c.server_close || !c.inflight.empty());
+                return;
+            }
+        }
+    }
+
+    bool flush_out(load_conn& c, size_t limit) {
+        while(c.out_off < c.out.size() && limit > 0) {
+            size_t n = c.out.size() - c.out_off;
+            n = n < limit ? n : limit;
+            ssize_t ret = send(c.fd, c.out.data() + c.out_off, n, MSG_NOSIGNAL);
+            if(ret < 0) {
+                if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                    c.writable = false;
+                    return true;
+                }
+                if(errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            c.out_off += ret;
+            limit -= ret;
+        }
+        if(c.out_off == c.out.size()) {
+            c.out.clear();
+            c.out_off = 0;
+        }
+        return true;
+    }
+
+    /**
+     * @return false: 连接已关闭或出错，需要重连
+     */
+    bool read_in(size_t idx, size_t limit) {
+        load_conn& c = conns_[idx];
+        char buf[65536];
+        while(limit > 0) {
+            size_t n = limit < sizeof(buf) ? limit : sizeof(buf);
+            ssize_t ret = recv(c.fd, buf, n, 0);
+            if(ret == 0) {
+                return false;
+            }
+            if(ret < 0) {
+                if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                    c.readable = false;
+                    return true;
+                }
+                if(errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            stats_.bytes_read += ret;
+            limit -= ret;
+            if(!consume(c, buf, static_cast<size_t>(ret))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool consume(load_conn& c, const char* p, size_t n) {
+        while(n > 0) {
+            if(c.state == RESPONSE_BODY) {
+                uint64_t take = n < c.body_remain ? n : c.body_remain;
+                c.body_remain -= take;
+                p += take;
+                n -= take;
+                if(c.body_remain == 0 && !finish_response(c)) {
+                    return false;
+                }
+                continue;
+            }
+            /* 响应头可能跨多次recv，只在新数据附近查找结尾 */
+            size_t old = c.header.size();
+            c.header.append(p, n);
+            size_t from = old >= 3 ? old - 3 : 0;
+            size_t end = c.header.find("\r\n\r\n", from);
+            if(end == std::string::npos) {
+                if(c.header.size() > 65536) {
+                    return false;
+                }
+                return true;
+            }
+            size_t header_len = end + 4;
+            size_t used = header_len - old;
+            p += used;
+            n -= used;
+            c.header.resize(header_len);
+
+            int code = 0;
+            bool close = false;
+            if(!parse_header(c.header, code, c.body_remain, close)) {
+                return false;
+            }
+            if(code < 200 || code >= 300) {
+                stats_.non_2xx++;
+            }
+            c.server_close = close;
+            c.header.clear();
+            c.state = RESPONSE_BODY;
+            if(c.body_remain == 0 && !finish_response(c)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool finish_response(load_conn& c) {
+        c.state = RESPONSE_HEADER;
+        if(c.inflight.empty()) {
+            return false;           // 未请求的响应
+        }
+        uint64_t now = now_ns();
+        stats_.latency.record(now - c.inflight.front());
+        stats_.completed++;
+        c.inflight.pop_front();
+        /* 对端将关闭连接，剩余在途请求不会再有响应 */
+        return !c.server_close;
+    }
+
+private:
+    const load_options& opt_;
+    struct in_addr addr_;
+    std::vector<load_conn> conns_;
+    int epfd_;
+    bool has_pwait2_;
+    uint64_t interval_ns_;
+    int pipeline_;
+    std::string request_;
+    load_stats stats_;
+};
+
+void usage(const char* name) {
+    fprintf(stderr,
+            "usage: %s [options] http://host:port/path\n"
+            "  -c conns        connections in total (default 64)\n"
+            "  -t threads      client threads (default 4)\n"
+            "  -d seconds      test duration (default 10)\n"
+            "  -r rps          open-loop total request rate, 0 for closed loop (default 0)\n"
+            "  -p depth        pipelined requests per connection (default 1)\n"
+            "  -k 0|1          keep-alive (default 1)\n"
+            "  -S ms           slow client: move at most -b bytes per connection every ms\n"
+            "  -b bytes        slow client chunk size (default 1)\n",
+            name);
+}
+
+void print_latency(const hdr_histogram& h) {
+    const double percentiles[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+    printf("latency(us)    mean %10.1f   min %10.1f   max %10.1f\n",
+           h.mean() / 1e3, h.min() / 1e3, h.max() / 1e3);
+    for(size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i) {
+        printf("  p%-8g %12.1f\n", percentiles[i], h.value_at_percentile(percentiles[i]) / 1e3);
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    load_options opt;
+    int ch;
+    while((ch = getopt(argc, argv, "c:t:d:r:p:k:S:b:h")) != -1) {
+        switch(ch) {
+            case 'c': opt.conns = atoi(optarg); break;
+            case 't': opt.threads = atoi(optarg); break;
+            case 'd': opt.duration = atoi(optarg); break;
+            case 'r': opt.rate = atof(optarg); break;
+            case 'p': opt.pipeline = atoi(optarg); break;
+            case 'k': opt.keepalive = atoi(optarg) != 0; break;
+            case 'S': opt.slow_interval_ms = atoi(optarg); break;
+            case 'b': opt.slow_bytes = atoi(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if(optind < argc && !parse_url(argv[optind], opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if(opt.threads < 1 || opt.conns < opt.threads || opt.pipeline < 1 || opt.slow_bytes < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct in_addr addr;
+    if(inet_pton(AF_INET, opt.host.c_str(), &addr) != 1) {
+        struct hostent* he = gethostbyname(opt.host.c_str());
+        if(he == nullptr || he->h_addrtype != AF_INET) {
+            fprintf(stderr, "resolve %s failed\n", opt.host.c_str());
+            return 1;
+        }
+        memcpy(&addr, he->h_addr_list[0], sizeof(addr));
+    }
+
+    printf("bench_load http://%s:%d%s  %d threads, %d conns, pipeline %d, %s, %s\n",
+           opt.host.c_str(), opt.port, opt.path.c_str(), opt.threads, opt.conns, opt.pipeline,
+           opt.keepalive ? "keep-alive" : "close",
+           opt.rate > 0 ? ("open-loop " + std::to_string(static_cast<long>(opt.rate)) + " rps").c_str() : "closed-loop");
+    if(opt.slow_interval_ms > 0) {
+        printf("slow client: %d bytes every %d ms\n", opt.slow_bytes, opt.slow_interval_ms);
+    }
+
+    std::vector<std::unique_ptr<load_worker>> workers;
+    for(int i = 0; i < opt.threads; ++i) {
+        int conns = opt.conns / opt.threads + (i < opt.conns % opt.threads ? 1 : 0);
+        double rate = opt.rate * conns / opt.conns;
+        workers.emplace_back(new load_worker(opt, addr, conns, rate));
+    }
+
+    signal(SIGINT, on_signal);
+    uint64_t start = now_ns();
+    uint64_t end = start + static_cast<uint64_t>(opt.duration) * 1000000000ULL;
+    std::vector<std::thread> threads;
+    for(int i = 0; i < opt.threads; ++i) {
+        threads.emplace_back(&load_worker::run, workers[i].get(), start, end);
+    }
+    for(size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    double sec = (now_ns() - start) / 1e9;
+
+    load_stats total;
+    for(size_t i = 0; i < workers.size(); ++i) {
+        const load_stats& s = workers[i]->stats();
+        total.completed += s.completed;
+        total.non_2xx += s.non_2xx;
+        total.errors += s.errors;
+        total.reconnects += s.reconnects;
+        total.bytes_read += s.bytes_read;
+        total.latency.merge(s.latency);
+    }
+
+    printf("requests %llu in %.2fs, %.1f MB read\n", static_cast<unsigned long long>(total.completed), sec,
+           total.bytes_read / 1e6);
+    printf("requests/sec %12.1f   transfer/sec %8.2f MB\n", total.completed / sec, total.bytes_read / sec / 1e6);
+    printf("non-2xx %llu   errors %llu   reconnects %llu\n", static_cast<unsigned long long>(total.non_2xx),
+           static_cast<unsigned long long>(total.errors), static_cast<unsigned long long>(total.reconnects));
+    print_latency(total.latency);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "heap_timer.h"
+#include "timing_wheel.h"
+
+/**
+ * @brief 对比heap_timer与timing_wheel在大量空闲连接下的add/update/del开销
+ *  模拟每个连接收到请求后刷新超时时间，最后全部关闭
+ * ./bench_timer [connections] [updates]
+ */
+
+namespace {
+
+const int IDLE_TIMEOUT_MS = 30000;
+
+void noop() {}
+
+double elapsed_sec(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void report(const char* name, const char* op, size_t n, double sec) {
+    printf("%-14s %-8s %10zu ops %10.3f s %12.1f ns/op\n", name, op, n, sec, sec * 1e9 / n);
+}
+
+template<typename Timer, typename Add>
+void run(const char* name, Timer& timer, Add add, int conns, size_t updates, const std::vector<int>& order) {
+    auto begin = std::chrono::steady_clock::now();
+    for(int fd = 0; fd < conns; ++fd) {
+        add(timer, fd);
+    }
+    report(name, "add", conns, elapsed_sec(begin));
+
+    begin = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < updates; ++i) {
+        timer.update(order[i % order.size()], IDLE_TIMEOUT_MS);
+        if((i & 1023) == 0) {
+            timer.get_next_tick();
+        }
+    }
+    report(name, "update", updates, elapsed_sec(begin));
+
+    begin = std::chrono::steady_clock::now();
+    for(int fd = 0; fd < conns; ++fd) {
+        timer.del(order[fd], false);
+    }
+    report(name, "del", conns, elapsed_sec(begin));
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int conns = argc > 1 ? atoi(argv[1]) : 100000;
+    size_t updates = argc > 2 ? strtoul(argv[2], nullptr, 10) : 2000000;
+
+    /* 固定种子的随机访问顺序，两种实现使用同一序列 */
+    std::vector<int> order(conns);
+    for(int i = 0; i < conns; ++i) {
+        order[i] = i;
+    }
+    srand(2023);
+    for(int i = conns - 1; i > 0; --i) {
+        std::swap(order[i], order[rand() % (i + 1)]);
+    }
+
+    heap_timer heap;
+    run("heap_timer", heap, [](heap_timer& t, int fd) { t.add(fd, IDLE_TIMEOUT_MS, noop); },
+        conns, updates, order);
+
+    timing_wheel wheel;
+    wheel.set_expire_handler([](int) {});
+    run("timing_wheel", wheel, [](timing_wheel& t, int fd) { t.add(fd, IDLE_TIMEOUT_MS); },
+        conns, updates, order);
+    return 0;
+}
\ No newline at end of file
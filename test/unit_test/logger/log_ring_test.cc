@@ -0,0 +1,62 @@
+#include "gtest/gtest.h"
+#include "log_ring.h"
+#include <string>
+#include <thread>
+
+TEST(test_log_ring, push_pop_wrap) {
+    log_ring ring(64);
+    char out[64];
+    std::string line(20, 'a');
+
+    /* 反复写入读出，使记录跨越环尾 */
+    for(int i = 0; i < 10; ++i) {
+        line[0] = static_cast<char>('a' + i);
+        ASSERT_TRUE(ring.push(line.data(), line.size()));
+        ASSERT_EQ(ring.pop(out, sizeof(out)), static_cast<int>(line.size()));
+        EXPECT_EQ(std::string(out, line.size()), line);
+    }
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.pop(out, sizeof(out)), 0);
+}
+
+TEST(test_log_ring, full_and_small_out) {
+    log_ring ring(64);
+    char out[64];
+    std::string line(28, 'x');
+    EXPECT_TRUE(ring.push(line.data(), line.size()));
+    EXPECT_TRUE(ring.push(line.data(), line.size()));
+    EXPECT_FALSE(ring.push("y", 1));
+
+    /* 空间不足时不取出 */
+    EXPECT_EQ(ring.pop(out, 10), -1);
+    EXPECT_EQ(ring.pop(out, sizeof(out)), 28);
+    EXPECT_TRUE(ring.push("y", 1));
+}
+
+TEST(test_log_ring, spsc) {
+    log_ring ring(256);
+    const int total = 100000;
+    std::thread producer([&ring]() {
+        for(int i = 0; i < total; ++i) {
+            std::string s = std::to_string(i);
+            while(!ring.push(s.data(), s.size())) {
+                std::this_thread::yield();
+            }
+        }
+        ring.close();
+    });
+
+    char out[32];
+    int expect = 0;
+    while(expect < total) {
+        int len = ring.pop(out, sizeof(out));
+        if(len <= 0) {
+            continue;
+        }
+        ASSERT_EQ(std::string(out, len), std::to_string(expect));
+        ++expect;
+    }
+    producer.join();
+    EXPECT_TRUE(ring.is_closed());
+    EXPECT_TRUE(ring.empty());
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 #include "thread_pool.h"
+#include <chrono>
 
 TEST(test_threadsafe_queue, push) {
     threadsafe_queue<int> tp;
@@ -7,4 +8,48 @@ TEST(test_threadsafe_queue, push) {
     int result = 0;
     tp.pop(result);
     EXPECT_EQ(result, 1);
+}
+
+TEST(test_lockfree_ring, push_pop) {
+    lockfree_ring<int> ring(4);
+    for(int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.push(i));
+    }
+    int full = 4;
+    EXPECT_FALSE(ring.push(full));
+
+    int result = -1;
+    for(int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.pop(result));
+        EXPECT_EQ(result, i);
+    }
+    EXPECT_FALSE(ring.pop(result));
+}
+
+TEST(test_thread_pool, submit) {
+    unsigned capacity = std::min(4u, std::thread::hardware_concurrency());
+    std::atomic<int> counter(0);
+    {
+        thread_pool pool(capacity);
+        /* 超过本地队列容量，覆盖overflow队列 */
+        for(int i = 0; i < 5000; ++i) {
+            pool.submit([&counter]{ counter.fetch_add(1); });
+        }
+        for(int i = 0; i < 500 && counter.load() < 5000; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    EXPECT_EQ(counter.load(), 5000);
+}
+
+TEST(test_thread_pool, wakeup_after_park) {
+    std::atomic<int> counter(0);
+    thread_pool pool(1);
+    /* 等待worker进入休眠后再投递 */
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    pool.submit([&counter]{ counter.fetch_add(1); });
+    for(int i = 0; i < 100 && counter.load() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(counter.load(), 1);
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include "chain_buffer.h"
+
+#include <string>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+namespace {
+
+std::string make_payload(size_t len) {
+    std::string s(len, '\0');
+    for(size_t i = 0; i < len; ++i) {
+        s[i] = static_cast<char>('a' + i % 26);
+    }
+    return s;
+}
+
+}
+
+TEST(test_chain_buffer, read_fd_large_request) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+    /* 超过原来20KB固定数组的请求 */
+    std::string payload = make_payload(50000);
+    ASSERT_EQ(write(fds[0], payload.data(), payload.size()), static_cast<ssize_t>(payload.size()));
+
+    chain_buffer buf(1 << 20);
+    int err = 0;
+    while(buf.read_fd(fds[1], err) > 0) {}
+    EXPECT_EQ(err, EAGAIN);
+    ASSERT_EQ(buf.size(), payload.size());
+    EXPECT_GT(buf.segment_count(), 1u);
+
+    const char* data = buf.pullup(buf.size());
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(std::string(data, buf.size()), payload);
+    EXPECT_EQ(buf.segment_count(), 1u);
+
+    buf.consume(buf.size());
+    EXPECT_TRUE(buf.empty());
+    EXPECT_EQ(buf.segment_count(), 0u);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(test_chain_buffer, pullup_and_consume) {
+    chain_buffer buf(1 << 20);
+    std::string payload = make_payload(chain_buffer::BLOCK_SIZE + 100);
+    ASSERT_TRUE(buf.append(payload.data(), payload.size()));
+    EXPECT_EQ(buf.segment_count(), 2u);
+
+    /* 位于首段内时直接返回，不合并 */
+    const char* head = buf.pullup(10);
+    EXPECT_EQ(std::string(head, 10), payload.substr(0, 10));
+    EXPECT_EQ(buf.segment_count(), 2u);
+
+    buf.consume(chain_buffer::BLOCK_SIZE - 50);
+    const char* rest = buf.pullup(150);
+    EXPECT_EQ(std::string(rest, 150), payload.substr(chain_buffer::BLOCK_SIZE - 50));
+    EXPECT_EQ(buf.size(), 150u);
+
+    buf.consume(150);
+    EXPECT_EQ(buf.segment_count(), 0u);
+}
+
+TEST(test_chain_buffer, limit) {
+    chain_buffer buf(100);
+    std::string payload = make_payload(80);
+    EXPECT_TRUE(buf.append(payload.data(), payload.size()));
+    EXPECT_FALSE(buf.append(payload.data(), payload.size()));
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ASSERT_EQ(write(fds[0], payload.data(), payload.size()), 80);
+    int err = 0;
+    EXPECT_EQ(buf.read_fd(fds[1], err), 20);
+    EXPECT_TRUE(buf.full());
+    EXPECT_EQ(buf.read_fd(fds[1], err), -1);
+    EXPECT_EQ(err, ENOBUFS);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(test_chain_buffer, prepare_and_commit) {
+    chain_buffer buf(6000);
+    size_t len = 0;
+    char* p = buf.prepare(len);
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(len, static_cast<size_t>(chain_buffer::BLOCK_SIZE));
+    /* 没有写入时不占用块 */
+    buf.commit(0);
+    EXPECT_EQ(buf.segment_count(), 0u);
+
+    std::string payload = make_payload(6000);
+    size_t written = 0;
+    while((p = buf.prepare(len)) != nullptr) {
+        memcpy(p, payload.data() + written, len);
+        buf.commit(len);
+        written += len;
+    }
+    EXPECT_EQ(written, payload.size());
+    EXPECT_TRUE(buf.full());
+    EXPECT_EQ(std::string(buf.pullup(buf.size()), buf.size()), payload);
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include "http_chunked.h"
+#include "http_parser.h"
+
+#include <cstring>
+#include <string>
+
+
+TEST(test_chunked, decode_incremental) {
+    const std::string body = "4\r\nWiki\r\n5;name=value\r\npedia\r\nE\r\n in\r\n\r\nchunks.\r\n0\r\nExpires: never\r\n\r\n";
+    const std::string next = "GET / HTTP/1.1\r\n\r\n";
+    const std::string wire = body + next;
+
+    /* 一次性到达 */
+    chunked_decoder decoder;
+    size_t consumed = 0;
+    std::string out;
+    ASSERT_EQ(decoder.decode(wire.data(), wire.size(), consumed, out), chunked_decoder::DECODE_DONE);
+    EXPECT_EQ(out, "Wikipedia in\r\n\r\nchunks.");
+    EXPECT_EQ(consumed, body.size());
+
+    /* 逐字节到达: 每次只传入未消费的部分，结果与一次性解码相同 */
+    decoder.reset();
+    consumed = 0;
+    out.clear();
+    chunked_decoder::DECODE_RESULT res = chunked_decoder::DECODE_AGAIN;
+    for(size_t avail = 0; avail <= wire.size() && res == chunked_decoder::DECODE_AGAIN; ++avail) {
+        res = decoder.decode(wire.data() + consumed, avail - consumed, consumed, out);
+        ASSERT_LE(consumed, avail);
+    }
+    ASSERT_EQ(res, chunked_decoder::DECODE_DONE);
+    EXPECT_EQ(out, "Wikipedia in\r\n\r\nchunks.");
+    EXPECT_EQ(consumed, body.size());
+}
+
+TEST(test_chunked, decode_error) {
+    const char* bad[] = {
+        "x\r\nabc\r\n0\r\n\r\n",            // 非十六进制长度
+        "\r\n",                               // 空长度
+        "3\r\nabcd\r\n0\r\n\r\n",           // 内容后不是CRLF
+        "3\nabc\r\n0\r\n\r\n",              // 长度行只有LF
+        "1000000000000000\r\n",             // 16位十六进制，溢出
+        "3 x\r\nabc\r\n0\r\n\r\n",          // 长度后不是扩展
+    };
+    for(const char* wire: bad) {
+        chunked_decoder decoder;
+        size_t consumed = 0;
+        std::string out;
+        EXPECT_EQ(decoder.decode(wire, strlen(wire), consumed, out), chunked_decoder::DECODE_ERROR) << wire;
+    }
+
+    /* 长度行过长时不会无限等待 */
+    std::string line(chunked_decoder::MAX_LINE + 1, '0');
+    chunked_decoder decoder;
+    size_t consumed = 0;
+    std::string out;
+    EXPECT_EQ(decoder.decode(line.data(), line.size(), consumed, out), chunked_decoder::DECODE_ERROR);
+}
+
+TEST(test_chunked, encode_round_trip) {
+    std::string wire;
+    chunked_encoder::append_chunk(wire, "hello ", 6);
+    chunked_encoder::append_chunk(wire, "", 0);
+    std::string big(300, 'x');
+    chunked_encoder::append_chunk(wire, big.data(), big.size());
+    chunked_encoder::append_last(wire);
+    EXPECT_EQ(wire.substr(0, 11), "6\r\nhello \r\n");
+    EXPECT_EQ(wire.substr(11, 5), "12c\r\n");
+
+    chunked_decoder decoder;
+    size_t consumed = 0;
+    std::string out;
+    ASSERT_EQ(decoder.decode(wire.data(), wire.size(), consumed, out), chunked_decoder::DECODE_DONE);
+    EXPECT_EQ(out, "hello " + big);
+    EXPECT_EQ(consumed, wire.size());
+}
+
+TEST(test_chunked, transfer_encoding_header) {
+    struct {
+        const char* headers;
+        bool ok;
+        bool chunked;
+    } cases[] = {
+        { "", true, false },
+        { "Content-Length: 3\r\n", true, false },
+        { "Transfer-Encoding: chunked\r\n", true, true },
+        { "transfer-encoding:  Chunked \r\n", true, true },
+        { "Transfer-Encoding: gzip, chunked\r\n", false, false },
+        { "Transfer-Encoding: chunked\r\nTransfer-Encoding: chunked\r\n", false, false },
+        { "Transfer-Encoding: chunked\r\nContent-Length: 3\r\n", false, false },
+        { "transfer-ENCODING: chunked\r\ncontent-LENGTH: 3\r\n", false, false },
+        { "CONTENT-LENGTH: 3\r\nTRANSFER-ENCODING: chunked\r\n", false, false },
+    };
+    for(const auto& c: cases) {
+        std::string req = std::string("POST / HTTP/1.1\r\n") + c.headers + "\r\n";
+        http_request_head head;
+        size_t consumed = 0;
+        ASSERT_EQ(http_parser::parse_request(req.data(), req.size(), head, consumed), http_parser::PARSE_OK);
+        bool chunked = false;
+        EXPECT_EQ(http_parser::transfer_chunked(head, chunked), c.ok) << c.headers;
+        if(c.ok) {
+            EXPECT_EQ(chunked, c.chunked) << c.headers;
+        }
+    }
+}
+
+/* 以下请求的body边界不可信，必须拒绝而不是按Content-Length处理 */
+TEST(test_chunked, transfer_encoding_smuggling) {
+    http_request_head head;
+    size_t consumed = 0;
+    bool chunked = false;
+
+    /* 冒号前有空白的请求头名: 解析阶段即失败 */
+    std::string req = "POST / HTTP/1.1\r\nTransfer-Encoding : chunked\r\nContent-Length: 3\r\n\r\n";
+    EXPECT_EQ(http_parser::parse_request(req.data(), req.size(), head, consumed), http_parser::PARSE_ERROR);
+
+    /* HTTP/1.0请求不允许Transfer-Encoding */
+    req = "POST / HTTP/1.0\r\nTransfer-Encoding: chunked\r\n\r\n";
+    ASSERT_EQ(http_parser::parse_request(req.data(), req.size(), head, consumed), http_parser::PARSE_OK);
+    EXPECT_FALSE(http_parser::transfer_chunked(head, chunked));
+
+    req = "POST / HTTP/1.0\r\nContent-Length: 3\r\n\r\n";
+    ASSERT_EQ(http_parser::parse_request(req.data(), req.size(), head, consumed), http_parser::PARSE_OK);
+    EXPECT_TRUE(http_parser::transfer_chunked(head, chunked));
+    EXPECT_FALSE(chunked);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+#include "http_response.h"
+
+#include <cstring>
+#include <string>
+
+
+TEST(test_conditional, etag_and_date) {
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_size = 3148;
+    st.st_mtim.tv_sec = 1677470619;
+    EXPECT_EQ(http_response::make_etag(st), "\"63fc2b9b-0-c4c\"");
+
+    /* 内容或修改时间变化后ETag不同 */
+    struct stat changed = st;
+    changed.st_mtim.tv_nsec = 1;
+    EXPECT_NE(http_response::make_etag(changed), http_response::make_etag(st));
+
+    std::string date = http_response::http_date(st.st_mtim.tv_sec);
+    EXPECT_EQ(date, "Mon, 27 Feb 2023 04:03:39 GMT");
+    time_t t = 0;
+    ASSERT_TRUE(http_response::parse_http_date(date, t));
+    EXPECT_EQ(t, st.st_mtim.tv_sec);
+    EXPECT_FALSE(http_response::parse_http_date("yesterday", t));
+    EXPECT_FALSE(http_response::parse_http_date(date + " trailing", t));
+}
+
+TEST(test_conditional, if_none_match) {
+    const std::string etag = "\"63fc2b9b-0-c4c\"";
+    bool gzip = false;
+    EXPECT_TRUE(http_response::etag_match(etag, etag, gzip));
+    EXPECT_FALSE(gzip);
+    EXPECT_TRUE(http_response::etag_match("\"a\", W/\"63fc2b9b-0-c4c\"", etag, gzip));
+    EXPECT_TRUE(http_response::etag_match("*", etag, gzip));
+
+    /* gzip变体的ETag同样视为未修改 */
+    EXPECT_TRUE(http_response::etag_match("\"63fc2b9b-0-c4c-gz\"", etag, gzip));
+    EXPECT_TRUE(gzip);
+
+    EXPECT_FALSE(http_response::etag_match("\"63fc2b9b-0-c4d\"", etag, gzip));
+    EXPECT_FALSE(http_response::etag_match("63fc2b9b-0-c4c", etag, gzip));
+    EXPECT_FALSE(http_response::etag_match("", etag, gzip));
+    EXPECT_FALSE(http_response::etag_match("*", "", gzip));
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+#include "date_header.h"
+#include "http_response.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(test_date_header, format_and_refresh) {
+    /* 没有reactor刷新时第一次读取自行初始化 */
+    std::string out = "HTTP/1.1 200 OK\r\n";
+    date_header::append(out);
+    ASSERT_EQ(out.size(), 17 + date_header::LENGTH);
+    std::string line = out.substr(17);
+    EXPECT_EQ(line.compare(0, 6, "Date: "), 0);
+    EXPECT_EQ(line.compare(line.size() - 2, 2, "\r\n"), 0);
+
+    time_t t = 0;
+    std::string value = date_header::value();
+    EXPECT_EQ(value, line.substr(6, line.size() - 8));
+    ASSERT_TRUE(http_response::parse_http_date(value, t));
+    EXPECT_LE(std::abs(static_cast<long>(time(nullptr) - t)), 2);
+
+    /* 同一秒内refresh不改变内容 */
+    date_header::refresh();
+    std::string again = date_header::value();
+    time_t t2 = 0;
+    ASSERT_TRUE(http_response::parse_http_date(again, t2));
+    EXPECT_GE(t2, t);
+}
+
+TEST(test_date_header, concurrent_readers) {
+    std::atomic<bool> stop(false);
+    std::atomic<int> bad(0);
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            std::string out;
+            time_t t;
+            while(!stop.load()) {
+                out.clear();
+                date_header::append(out);
+                /* seqlock保证不会读到写入中途的内容 */
+                if(out.size() != date_header::LENGTH
+                   || !http_response::parse_http_date(out.substr(6, date_header::LENGTH - 8), t)) {
+                    bad++;
+                }
+            }
+        });
+    }
+    /* 跨过至少一次秒数变化 */
+    time_t begin = time(nullptr);
+    while(time(nullptr) < begin + 2) {
+        date_header::refresh();
+    }
+    stop = true;
+    for(std::thread& t: readers) {
+        t.join();
+    }
+    EXPECT_EQ(bad.load(), 0);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "gtest/gtest.h"
+#include "gzip_codec.h"
+#include "http_request.h"
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+std::string gunzip(const std::string& in) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    inflateInit2(&zs, MAX_WBITS + 16);
+    std::string out(1 << 20, '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = in.size();
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = out.size();
+    int ret = inflate(&zs, Z_FINISH);
+    out.resize(ret == Z_STREAM_END ? zs.total_out : 0);
+    inflateEnd(&zs);
+    return out;
+}
+
+http_slice slice(const char* s) {
+    http_slice res = { s, strlen(s) };
+    return res;
+}
+
+bool accept_gzip(const char* key, const char* value) {
+    http_request request;
+    request.set_request_line(slice("GET"), slice("/index.html"), slice("1.1"));
+    request.set_requset_header(slice(key), slice(value));
+    return request.accept_gzip();
+}
+
+}
+
+TEST(test_gzip, compress_round_trip) {
+    std::string text;
+    for(int i = 0; i < 1000; ++i) {
+        text += ".navbar-brand { font-size: 18px; line-height: 20px; }\n";
+    }
+    std::string gz;
+    ASSERT_TRUE(gzip_compress(text.data(), text.size(), gz));
+    EXPECT_LT(gz.size(), text.size() / 10);
+    /* gzip魔数 */
+    EXPECT_EQ(static_cast<unsigned char>(gz[0]), 0x1f);
+    EXPECT_EQ(static_cast<unsigned char>(gz[1]), 0x8b);
+    EXPECT_EQ(gunzip(gz), text);
+}
+
+TEST(test_gzip, accept_encoding) {
+    EXPECT_TRUE(accept_gzip("Accept-Encoding", "gzip, deflate, br"));
+    EXPECT_TRUE(accept_gzip("accept-encoding", "br;q=1.0, GZIP;q=0.5"));
+    EXPECT_TRUE(accept_gzip("Accept-Encoding", "*"));
+    EXPECT_TRUE(accept_gzip("Accept-Encoding", "x-gzip"));
+    EXPECT_FALSE(accept_gzip("Accept-Encoding", "deflate, br"));
+    EXPECT_FALSE(accept_gzip("Accept-Encoding", "gzip;q=0, *"));
+    EXPECT_FALSE(accept_gzip("Accept-Encoding", "identity"));
+    EXPECT_FALSE(accept_gzip("Accept-Encodings", "gzip"));
+}
\ No newline at end of file
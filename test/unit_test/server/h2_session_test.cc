@@ -0,0 +1,209 @@
+#include "gtest/gtest.h"
+#include "h2_session.h"
+#include "http_session.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+struct frame {
+    uint8_t type;
+    uint8_t flags;
+    uint32_t stream_id;
+    std::string payload;
+};
+
+void append_frame(std::string& out, uint8_t type, uint8_t flags, uint32_t stream_id, const std::string& payload) {
+    size_t len = payload.size();
+    out.push_back(static_cast<char>(len >> 16));
+    out.push_back(static_cast<char>(len >> 8));
+    out.push_back(static_cast<char>(len));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    for(int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>(stream_id >> shift));
+    }
+    out.append(payload);
+}
+
+std::string u32(uint32_t value) {
+    std::string res;
+    for(int shift = 24; shift >= 0; shift -= 8) {
+        res.push_back(static_cast<char>(value >> shift));
+    }
+    return res;
+}
+
+void feed(h2_session& session, const std::string& data) {
+    size_t used = 0;
+    session.process(data.data(), data.size(), used);
+    EXPECT_EQ(used, data.size());
+}
+
+/* 把schedule排入的发送队列拼接后拆成帧(测试只涉及内存内容) */
+std::vector<frame> drain(h2_session& session) {
+    std::vector<pending_response> out;
+    session.schedule(out);
+    std::string wire;
+    for(const pending_response& rsp: out) {
+        wire += rsp.cached_head ? *rsp.cached_head : rsp.head;
+        wire.append(rsp.body, rsp.body_len);
+        EXPECT_EQ(rsp.file_fd, -1);
+    }
+    std::vector<frame> frames;
+    size_t pos = 0;
+    while(wire.size() - pos >= h2_session::FRAME_HEADER_LEN) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(wire.data() + pos);
+        size_t len = (p[0] << 16) | (p[1] << 8) | p[2];
+        frame f;
+        f.type = p[3];
+        f.flags = p[4];
+        f.stream_id = ((p[5] & 0x7f) << 24) | (p[6] << 16) | (p[7] << 8) | p[8];
+        f.payload = wire.substr(pos + h2_session::FRAME_HEADER_LEN, len);
+        EXPECT_EQ(f.payload.size(), len);
+        frames.push_back(f);
+        pos += h2_session::FRAME_HEADER_LEN + len;
+    }
+    EXPECT_EQ(pos, wire.size());
+    return frames;
+}
+
+std::string client_start(uint32_t initial_window) {
+    std::string data(H2_PREFACE, H2_PREFACE_LEN);
+    std::string settings;
+    settings.push_back(0);
+    settings.push_back(h2_session::SETTINGS_INITIAL_WINDOW_SIZE);
+    settings += u32(initial_window);
+    append_frame(data, h2_session::FRAME_SETTINGS, 0, 0, settings);
+    return data;
+}
+
+}
+
+
+/* 对端初始窗口为100字节: 先只发送100字节，WINDOW_UPDATE后继续直到END_STREAM */
+TEST(test_h2_session, stream_flow_control) {
+    h2_session session;
+    std::string data = client_start(100);
+    /* :method GET, :scheme http, :path /metrics(静态表索引4的字面量) */
+    std::string block = "\x82\x86\x44\x08/metrics";
+    append_frame(data, h2_session::FRAME_HEADERS, h2_session::FLAG_END_HEADERS | h2_session::FLAG_END_STREAM, 1, block);
+    feed(session, data);
+
+    std::vector<frame> frames = drain(session);
+    size_t body = 0;
+    bool headers = false;
+    bool settings_ack = false;
+    for(const frame& f: frames) {
+        if(f.type == h2_session::FRAME_SETTINGS && (f.flags & h2_session::FLAG_ACK)) {
+            settings_ack = true;
+        } else if(f.type == h2_session::FRAME_HEADERS) {
+            EXPECT_EQ(f.stream_id, 1u);
+            EXPECT_EQ(f.payload[0], '\x88');       // :status 200
+            EXPECT_FALSE(f.flags & h2_session::FLAG_END_STREAM);
+            headers = true;
+        } else if(f.type == h2_session::FRAME_DATA) {
+            EXPECT_FALSE(f.flags & h2_session::FLAG_END_STREAM);
+            body += f.payload.size();
+        }
+    }
+    EXPECT_TRUE(settings_ack);
+    EXPECT_TRUE(headers);
+    EXPECT_EQ(body, 100u);
+
+    /* 窗口耗尽，没有新的帧 */
+    EXPECT_TRUE(drain(session).empty());
+
+    std::string update;
+    append_frame(update, h2_session::FRAME_WINDOW_UPDATE, 0, 1, u32(1 << 20));
+    feed(session, update);
+    bool end_stream = false;
+    for(int round = 0; round < 16 && !end_stream; ++round) {
+        for(const frame& f: drain(session)) {
+            ASSERT_EQ(f.type, h2_session::FRAME_DATA);
+            body += f.payload.size();
+            end_stream = f.flags & h2_session::FLAG_END_STREAM;
+        }
+    }
+    EXPECT_TRUE(end_stream);
+    EXPECT_GT(body, 100u);
+}
+
+/* 因窗口耗尽等待的流被对端重置: 流在下一轮schedule中释放，不能再被访问 */
+TEST(test_h2_session, reset_window_blocked_stream) {
+    h2_session session;
+    std::string data = client_start(100);
+    std::string block = "\x82\x86\x44\x08/metrics";
+    append_frame(data, h2_session::FRAME_HEADERS, h2_session::FLAG_END_HEADERS | h2_session::FLAG_END_STREAM, 1, block);
+    feed(session, data);
+    ASSERT_FALSE(drain(session).empty());
+    EXPECT_TRUE(drain(session).empty());
+
+    std::string rst;
+    append_frame(rst, h2_session::FRAME_RST_STREAM, 0, 1, u32(h2_session::H2_CANCEL));
+    feed(session, rst);
+    EXPECT_TRUE(drain(session).empty());
+
+    /* 已重置的流上的WINDOW_UPDATE被忽略，连接仍可处理新的流 */
+    std::string next;
+    append_frame(next, h2_session::FRAME_WINDOW_UPDATE, 0, 1, u32(1000));
+    append_frame(next, h2_session::FRAME_HEADERS, h2_session::FLAG_END_HEADERS | h2_session::FLAG_END_STREAM, 3, block);
+    feed(session, next);
+    bool headers = false;
+    for(const frame& f: drain(session)) {
+        EXPECT_NE(f.stream_id, 1u);
+        if(f.type == h2_session::FRAME_HEADERS) {
+            EXPECT_EQ(f.stream_id, 3u);
+            headers = true;
+        }
+    }
+    EXPECT_TRUE(headers);
+}
+
+TEST(test_h2_session, protocol_errors) {
+    /* 前言后第一帧不是SETTINGS */
+    {
+        h2_session session;
+        std::string data(H2_PREFACE, H2_PREFACE_LEN);
+        append_frame(data, h2_session::FRAME_PING, 0, 0, std::string(8, '\0'));
+        size_t used = 0;
+        session.process(data.data(), data.size(), used);
+        std::vector<frame> frames = drain(session);
+        ASSERT_FALSE(frames.empty());
+        EXPECT_EQ(frames.back().type, h2_session::FRAME_GOAWAY);
+        EXPECT_EQ(frames.back().payload.substr(4), u32(h2_session::H2_PROTOCOL_ERROR));
+    }
+    /* PING得到ACK，流0上的DATA是连接错误 */
+    {
+        h2_session session;
+        std::string data = client_start(65535);
+        append_frame(data, h2_session::FRAME_PING, 0, 0, "12345678");
+        append_frame(data, h2_session::FRAME_DATA, 0, 0, "x");
+        size_t used = 0;
+        session.process(data.data(), data.size(), used);
+        bool pong = false;
+        std::vector<frame> frames = drain(session);
+        for(const frame& f: frames) {
+            if(f.type == h2_session::FRAME_PING) {
+                EXPECT_TRUE(f.flags & h2_session::FLAG_ACK);
+                EXPECT_EQ(f.payload, "12345678");
+                pong = true;
+            }
+        }
+        EXPECT_TRUE(pong);
+        ASSERT_FALSE(frames.empty());
+        EXPECT_EQ(frames.back().type, h2_session::FRAME_GOAWAY);
+    }
+    /* 截断的帧等待更多数据，不消费 */
+    {
+        h2_session session;
+        std::string data = client_start(65535);
+        std::string partial;
+        append_frame(partial, h2_session::FRAME_PING, 0, 0, "12345678");
+        data.append(partial, 0, 12);
+        size_t used = 0;
+        session.process(data.data(), data.size(), used);
+        EXPECT_EQ(used, data.size() - 12);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "hpack.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string from_hex(const std::string& hex) {
+    std::string res;
+    for(size_t i = 0; i + 1 < hex.size(); i += 2) {
+        res.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    }
+    return res;
+}
+
+std::vector<hpack_header> decode(hpack_decoder& decoder, const std::string& hex) {
+    std::string block = from_hex(hex);
+    std::vector<hpack_header> headers;
+    EXPECT_TRUE(decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), headers)) << hex;
+    return headers;
+}
+
+void expect_headers(const std::vector<hpack_header>& headers,
+                    const std::vector<std::pair<std::string, std::string>>& expected) {
+    ASSERT_EQ(headers.size(), expected.size());
+    for(size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(headers[i].name, expected[i].first);
+        EXPECT_EQ(headers[i].value, expected[i].second);
+    }
+}
+
+}
+
+
+/* RFC 7541 C.3/C.4: 同一连接上的三个请求，分别不使用和使用Huffman编码 */
+TEST(test_hpack, rfc_request_examples) {
+    const char* blocks[2][3] = {
+        { "828684410f7777772e6578616d706c652e636f6d",
+          "828684be58086e6f2d6361636865",
+          "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565" },
+        { "828684418cf1e3c2e5f23a6ba0ab90f4ff",
+          "828684be5886a8eb10649cbf",
+          "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf" },
+    };
+    for(int huffman = 0; huffman < 2; ++huffman) {
+        hpack_decoder decoder;
+        expect_headers(decode(decoder, blocks[huffman][0]),
+                       { { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" },
+                         { ":authority", "www.example.com" } });
+        EXPECT_EQ(decoder.table_size(), 57u);
+        expect_headers(decode(decoder, blocks[huffman][1]),
+                       { { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" },
+                         { ":authority", "www.example.com" }, { "cache-control", "no-cache" } });
+        EXPECT_EQ(decoder.table_size(), 110u);
+        expect_headers(decode(decoder, blocks[huffman][2]),
+                       { { ":method", "GET" }, { ":scheme", "https" }, { ":path", "/index.html" },
+                         { ":authority", "www.example.com" }, { "custom-key", "custom-value" } });
+        EXPECT_EQ(decoder.table_size(), 164u);
+    }
+}
+
+/* RFC 7541 C.6: 动态表上限256字节，插入时淘汰最早的条目 */
+TEST(test_hpack, rfc_response_eviction) {
+    hpack_decoder decoder(256);
+    expect_headers(decode(decoder, "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff"
+                                   "6e919d29ad171863c78f0b97c8e9ae82ae43d3"),
+                   { { ":status", "302" }, { "cache-control", "private" },
+                     { "date", "Mon, 21 Oct 2013 20:13:21 GMT" }, { "location", "https://www.example.com" } });
+    EXPECT_EQ(decoder.table_size(), 222u);
+    expect_headers(decode(decoder, "4883640effc1c0bf"),
+                   { { ":status", "307" }, { "cache-control", "private" },
+                     { "date", "Mon, 21 Oct 2013 20:13:21 GMT" }, { "location", "https://www.example.com" } });
+    EXPECT_EQ(decoder.table_size(), 222u);
+}
+
+TEST(test_hpack, errors_and_round_trip) {
+    hpack_decoder decoder;
+    std::vector<hpack_header> headers;
+    const char* bad[] = {
+        "80",               // 索引0
+        "be",               // 动态表为空时的索引62
+        "0f",               // 整数不完整
+        "0081ff",           // Huffman填充超过7位
+        "820020",           // 大小更新不在块开头
+        "3fe21f",           // 大小更新超过SETTINGS上限
+    };
+    for(const char* hex: bad) {
+        std::string block = from_hex(hex);
+        headers.clear();
+        EXPECT_FALSE(decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), headers)) << hex;
+    }
+
+    std::string all;
+    for(int c = 0; c < 256; ++c) {
+        all.push_back(static_cast<char>(c));
+    }
+    std::string encoded;
+    std::string decoded;
+    hpack::huffman_encode(all, encoded);
+    ASSERT_TRUE(hpack::huffman_decode(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(), decoded));
+    EXPECT_EQ(decoded, all);
+
+    /* 编码的响应头可以被解码器还原，常见状态码只占一个字节 */
+    std::string block;
+    hpack_encoder::encode_status(200, block);
+    EXPECT_EQ(block.size(), 1u);
+    hpack_encoder::encode_status(503, block);
+    hpack_encoder::encode_header("content-type", "text/html", block);
+    hpack_encoder::encode_header("x-custom", std::string(200, 'v'), block);
+    headers.clear();
+    hpack_decoder fresh;
+    ASSERT_TRUE(fresh.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), headers));
+    expect_headers(headers, { { ":status", "200" }, { ":status", "503" }, { "content-type", "text/html" },
+                              { "x-custom", std::string(200, 'v') } });
+    EXPECT_EQ(fresh.table_size(), 0u);
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "gtest/gtest.h"
+#include "http_parser.h"
+#include <cstring>
+#include <string>
+
+namespace {
+
+const http_parser::SIMD_LEVEL ALL_LEVELS[] = {
+    http_parser::SIMD_SCALAR, http_parser::SIMD_SSE42, http_parser::SIMD_AVX2
+};
+
+std::string header_value(const http_request_head& head, const std::string& name) {
+    for(size_t i = 0; i < head.header_num; ++i) {
+        if(head.headers[i].name.to_string() == name) {
+            return head.headers[i].value.to_string();
+        }
+    }
+    return "<none>";
+}
+
+class parser_level_guard {
+public:
+    parser_level_guard(): level(http_parser::simd_level()) {}
+    ~parser_level_guard() { http_parser::set_simd_level(level); }
+private:
+    http_parser::SIMD_LEVEL level;
+};
+
+}
+
+TEST(test_http_parser, find_char) {
+    parser_level_guard guard;
+    std::string text(200, 'a');
+    for(http_parser::SIMD_LEVEL level: ALL_LEVELS) {
+        http_parser::set_simd_level(level);
+        for(size_t pos = 0; pos < text.size(); ++pos) {
+            std::string s = text;
+            s[pos] = '\r';
+            const char* found = http_parser::find_char(s.data(), s.data() + s.size(), '\r');
+            ASSERT_EQ(found, s.data() + pos) << "level " << level << " pos " << pos;
+        }
+        EXPECT_EQ(http_parser::find_char(text.data(), text.data() + text.size(), '\r'), nullptr);
+    }
+}
+
+TEST(test_http_parser, request_line_and_headers) {
+    parser_level_guard guard;
+    std::string req = "GET /index.html HTTP/1.1\r\n"
+                      "Host: 127.0.0.1:9000\r\n"
+                      "Connection:keep-alive\r\n"
+                      "Accept:   */*  \r\n"
+                      "\r\n"
+                      "body";
+    for(http_parser::SIMD_LEVEL level: ALL_LEVELS) {
+        http_parser::set_simd_level(level);
+        http_request_head head;
+        size_t consumed = 0;
+        ASSERT_EQ(http_parser::parse_request(req.data(), req.size(), head, consumed), http_parser::PARSE_OK);
+        EXPECT_EQ(head.method.to_string(), "GET");
+        EXPECT_EQ(head.path.to_string(), "/index.html");
+        EXPECT_EQ(head.version.to_string(), "1.1");
+        EXPECT_EQ(head.header_num, 3u);
+        EXPECT_EQ(header_value(head, "Host"), "127.0.0.1:9000");
+        EXPECT_EQ(header_value(head, "Connection"), "keep-alive");
+        EXPECT_EQ(header_value(head, "Accept"), "*/*");
+        EXPECT_EQ(req.substr(consumed), "body");
+        /* 片段直接指向输入缓冲区 */
+        EXPECT_EQ(head.method.data, req.data());
+    }
+}
+
+TEST(test_http_parser, incomplete) {
+    std::string req = "POST /login HTTP/1.1\r\nContent-Type: application/x-www-form-urlencoded\r\n\r\n";
+    http_request_head head;
+    size_t consumed = 0;
+    for(size_t len = 0; len < req.size(); ++len) {
+        EXPECT_EQ(http_parser::parse_request(req.data(), len, head, consumed), http_parser::PARSE_AGAIN) << len;
+    }
+    EXPECT_EQ(http_parser::parse_request(req.data(), req.size(), head, consumed), http_parser::PARSE_OK);
+    EXPECT_EQ(consumed, req.size());
+}
+
+TEST(test_http_parser, malformed) {
+    const char* bad[] = {
+        "GET\r\n\r\n",
+        "GET /index.html\r\n\r\n",
+        "GET /index.html FTP/1.1\r\n\r\n",
+        "GET  HTTP/1.1\r\n\r\n",
+        "GET / HTTP/1.1\r\nno-colon-header\r\n\r\n",
+        "GET / HTTP/1.1\rX\n\r\n",
+        "GET / HTTP/1.1\r\nHost: a\r\n\rX",
+    };
+    for(const char* req: bad) {
+        http_request_head head;
+        size_t consumed = 0;
+        EXPECT_EQ(http_parser::parse_request(req, strlen(req), head, consumed), http_parser::PARSE_ERROR) << req;
+    }
+}
+
+TEST(test_http_parser, invalid_header_name) {
+    parser_level_guard guard;
+    const char* bad[] = {
+        "GET / HTTP/1.1\r\n: empty\r\n\r\n",
+        "GET / HTTP/1.1\r\nTransfer-Encoding : chunked\r\n\r\n",
+        "GET / HTTP/1.1\r\nTransfer-Encoding\t: chunked\r\n\r\n",
+        "GET / HTTP/1.1\r\nX Test: 1\r\n\r\n",
+        "GET / HTTP/1.1\r\nX-Test\x01: 1\r\n\r\n",
+        "GET / HTTP/1.1\r\nX-Test\x7f: 1\r\n\r\n",
+        "GET / HTTP/1.1\r\nX-\xe4\xbd\xa0: 1\r\n\r\n",
+        "GET / HTTP/1.1\r\n Host: a\r\n\r\n",
+        /* obs-fold续行 */
+        "GET / HTTP/1.1\r\nX-Test: a\r\n b\r\n\r\n",
+        "GET / HTTP/1.1\r\nX-Test: a\r\n\tb\r\n\r\n",
+    };
+    for(http_parser::SIMD_LEVEL level: ALL_LEVELS) {
+        http_parser::set_simd_level(level);
+        for(const char* req: bad) {
+            http_request_head head;
+            size_t consumed = 0;
+            EXPECT_EQ(http_parser::parse_request(req, strlen(req), head, consumed), http_parser::PARSE_ERROR) << req;
+        }
+    }
+
+    /* tchar中的符号都可以出现在请求头名中 */
+    std::string req = "GET / HTTP/1.1\r\nX!#$%&'*+-.^_`|~09: 1\r\n\r\n";
+    http_request_head head;
+    size_t consumed = 0;
+    ASSERT_EQ(http_parser::parse_request(req.data(), req.size(), head, consumed), http_parser::PARSE_OK);
+    EXPECT_EQ(header_value(head, "X!#$%&'*+-.^_`|~09"), "1");
+}
+
+TEST(test_http_parser, too_many_headers) {
+    std::string req = "GET / HTTP/1.1\r\n";
+    for(size_t i = 0; i <= http_request_head::MAX_HEADERS; ++i) {
+        req += "X-Test: 1\r\n";
+    }
+    req += "\r\n";
+    http_request_head head;
+    size_t consumed = 0;
+    EXPECT_EQ(http_parser::parse_request(req.data(), req.size(), head, consumed), http_parser::PARSE_ERROR);
+}
+
+TEST(test_http_parser, pipelined_content_length) {
+    /* 两个流水线请求: 第一个带body，以Content-Length确定第二个请求的起点 */
+    std::string req = "POST /login HTTP/1.1\r\ncontent-length: 5\r\n\r\nhelloGET /b HTTP/1.1\r\n\r\n";
+    http_request_head head;
+    size_t consumed = 0;
+    size_t body_len = 0;
+    ASSERT_EQ(http_parser::parse_request(req.data(), req.size(), head, consumed), http_parser::PARSE_OK);
+    ASSERT_TRUE(http_parser::content_length(head, body_len));
+    EXPECT_EQ(body_len, 5u);
+    EXPECT_EQ(req.substr(consumed, body_len), "hello");
+
+    size_t offset = consumed + body_len;
+    ASSERT_EQ(http_parser::parse_request(req.data() + offset, req.size() - offset, head, consumed), http_parser::PARSE_OK);
+    EXPECT_TRUE(head.path.equals("/b", 2));
+    ASSERT_TRUE(http_parser::content_length(head, body_len));
+    EXPECT_EQ(body_len, 0u);
+    EXPECT_EQ(offset + consumed, req.size());
+
+    const char* bad[] = {
+        "GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+        "GET / HTTP/1.1\r\nContent-Length: \r\n\r\n",
+        "GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n",
+        "GET / HTTP/1.1\r\nContent-Length: 99999999999999999999\r\n\r\n",
+    };
+    for(const char* r: bad) {
+        ASSERT_EQ(http_parser::parse_request(r, strlen(r), head, consumed), http_parser::PARSE_OK) << r;
+        EXPECT_FALSE(http_parser::content_length(head, body_len)) << r;
+    }
+}
\ No newline at end of file
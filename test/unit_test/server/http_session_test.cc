@@ -0,0 +1,333 @@
+#include "gtest/gtest.h"
+#include "http_session.h"
+#include "http_chunked.h"
+#include "static_cache.h"
+#include "../metrics.h"
+
+#include <cerrno>
+#include <string>
+#include <unistd.h>
+#include <sys/socket.h>
+
+namespace {
+
+size_t count(const std::string& s, const std::string& needle) {
+    size_t n = 0;
+    for(size_t pos = s.find(needle); pos != std::string::npos; pos = s.find(needle, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+/**
+ * @brief socketpair两端: 服务端为被测的http_session(注册在epoll上，rearm可以正常调用)，客户端直接读写
+ */
+struct session_pair {
+    int fds[2];
+    std::shared_ptr<poller> epl;
+    std::unique_ptr<http_session> session;
+
+    session_pair() {
+        EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+        epl = make_poller(POLLER_EPOLL, 16);
+        epl->add_fd(fds[0], EPOLLIN | EPOLLONESHOT, 0);
+        session.reset(new http_session(fds[0], EPOLLIN | EPOLLONESHOT, epl, 0));
+    }
+
+    ~session_pair() {
+        session.reset();
+        epl->del_fd(fds[0]);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    /* 发送请求并交给session处理，交替发送与读取直到连接关闭或轮数用完 */
+    std::string exchange(const std::string& req, bool& open) {
+        EXPECT_EQ(write(fds[1], req.data(), req.size()), static_cast<ssize_t>(req.size()));
+        EXPECT_EQ(session->read_buf(), http_session::READ_DATA);
+        EXPECT_TRUE(session->process());
+        std::string res;
+        open = true;
+        char buf[16384];
+        for(int round = 0; round < 1000 && open; ++round) {
+            http_session::WRITE_RESULT ret = session->write_buf();
+            open = ret != http_session::WRITE_CLOSE;
+            /* 缓冲区中剩余的请求由reactor分派，这里直接处理 */
+            if(ret == http_session::WRITE_PENDING) {
+                EXPECT_TRUE(session->process());
+            }
+            ssize_t n;
+            while((n = read(fds[1], buf, sizeof(buf))) > 0) {
+                res.append(buf, n);
+            }
+        }
+        return res;
+    }
+};
+
+}
+
+
+/* 流式响应的后续段只包含生成的内容，响应头只在第一段发送一次 */
+TEST(test_http_session, stream_response_chunked) {
+    session_pair pair;
+    bool open = false;
+    std::string res = pair.exchange("GET /metrics HTTP/1.1\r\nConnection: keep-alive\r\n\r\n"
+                                    "GET /metrics HTTP/1.1\r\nConnection: keep-alive\r\n\r\n", open);
+    EXPECT_TRUE(open);
+    EXPECT_EQ(count(res, "HTTP/1.1 200 OK\r\n"), 2u);
+
+    size_t pos = 0;
+    for(int i = 0; i < 2; ++i) {
+        size_t header_end = res.find("\r\n\r\n", pos);
+        ASSERT_NE(header_end, std::string::npos);
+        std::string head = res.substr(pos, header_end + 4 - pos);
+        EXPECT_EQ(head.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+        EXPECT_NE(head.find("Transfer-Encoding: chunked\r\n"), std::string::npos);
+        EXPECT_EQ(count(head, "Date: "), 1u);
+
+        chunked_decoder decoder;
+        size_t consumed = 0;
+        std::string body;
+        ASSERT_EQ(decoder.decode(res.data() + header_end + 4, res.size() - header_end - 4, consumed, body),
+                  chunked_decoder::DECODE_DONE);
+        EXPECT_NE(body.find("sws_http_requests_total"), std::string::npos);
+        EXPECT_EQ(body.find("HTTP/1.1"), std::string::npos);
+        pos = header_end + 4 + consumed;
+    }
+    EXPECT_EQ(pos, res.size());
+}
+
+/* HTTP/1.1默认为持久连接: 不带Connection请求头的流水线请求全部得到响应 */
+TEST(test_http_session, pipeline_default_keepalive) {
+    session_pair pair;
+    bool open = false;
+    std::string req;
+    for(int i = 0; i < 4; ++i) {
+        req += "GET /metrics HTTP/1.1\r\nHost: a\r\n\r\n";
+    }
+    std::string res = pair.exchange(req, open);
+    EXPECT_TRUE(open);
+    EXPECT_EQ(count(res, "HTTP/1.1 200 OK\r\n"), 4u);
+    EXPECT_EQ(count(res, "Connection: keep-alive\r\n"), 4u);
+    EXPECT_EQ(count(res, "Connection: close\r\n"), 0u);
+
+    /* Connection中的close(不区分大小写、可与其它选项并列)在响应后关闭连接，之后的请求被丢弃 */
+    res = pair.exchange("GET /metrics HTTP/1.1\r\nConnection: TE, Close\r\n\r\n"
+                        "GET /metrics HTTP/1.1\r\n\r\n", open);
+    EXPECT_FALSE(open);
+    EXPECT_EQ(count(res, "HTTP/1.1 200 OK\r\n"), 1u);
+    EXPECT_EQ(count(res, "Connection: close\r\n"), 1u);
+}
+
+/* HTTP/1.0需要显式的keep-alive才保持连接 */
+TEST(test_http_session, http10_keepalive_opt_in) {
+    session_pair pair;
+    bool open = false;
+    /* 流式响应在HTTP/1.0下以关闭连接结束，这里使用有长度的404响应 */
+    std::string res = pair.exchange("GET /no-such-file HTTP/1.0\r\nconnection: Keep-Alive\r\n\r\n"
+                                    "GET /no-such-file HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", open);
+    EXPECT_TRUE(open);
+    EXPECT_EQ(count(res, "HTTP/1.1 404"), 2u);
+    EXPECT_EQ(count(res, "Connection: keep-alive\r\n"), 2u);
+
+    res = pair.exchange("GET /no-such-file HTTP/1.0\r\n\r\n", open);
+    EXPECT_FALSE(open);
+    EXPECT_EQ(count(res, "HTTP/1.1 404"), 1u);
+}
+
+/* HTTP/1.0: 不使用chunked，内容直接跟在响应头之后，发送完后关闭连接 */
+TEST(test_http_session, stream_response_close_delimited) {
+    session_pair pair;
+    bool open = true;
+    std::string res = pair.exchange("GET /metrics HTTP/1.0\r\n\r\n", open);
+    EXPECT_FALSE(open);
+    size_t header_end = res.find("\r\n\r\n");
+    ASSERT_NE(header_end, std::string::npos);
+    EXPECT_EQ(res.compare(0, 17, "HTTP/1.1 200 OK\r\n"), 0);
+    EXPECT_NE(res.find("Connection: close\r\n"), std::string::npos);
+    std::string body = res.substr(header_end + 4);
+    EXPECT_EQ(body.find("HTTP/1.1"), std::string::npos);
+    EXPECT_EQ(body.find("Transfer-Encoding"), std::string::npos);
+    EXPECT_NE(body.find("sws_http_requests_total"), std::string::npos);
+}
+
+/* 超过单批上限的流水线请求: write_buf发送完这一批后交还reactor，不在发送路径上直接处理 */
+TEST(test_http_session, leftover_requests_returned_to_reactor) {
+    session_pair pair;
+    std::string req;
+    for(size_t i = 0; i <= MAX_PIPELINE; ++i) {
+        req += "GET /metrics HTTP/1.1\r\nConnection: keep-alive\r\n\r\n";
+    }
+    ASSERT_EQ(write(pair.fds[1], req.data(), req.size()), static_cast<ssize_t>(req.size()));
+    ASSERT_EQ(pair.session->read_buf(), http_session::READ_DATA);
+    ASSERT_TRUE(pair.session->process());
+
+    std::string res;
+    char buf[16384];
+    http_session::WRITE_RESULT ret = http_session::WRITE_DONE;
+    for(int round = 0; round < 10000; ++round) {
+        ret = pair.session->write_buf();
+        ssize_t n;
+        while((n = read(pair.fds[1], buf, sizeof(buf))) > 0) {
+            res.append(buf, n);
+        }
+        if(ret != http_session::WRITE_DONE) {
+            break;
+        }
+    }
+    ASSERT_EQ(ret, http_session::WRITE_PENDING);
+    EXPECT_EQ(count(res, "HTTP/1.1 200 OK\r\n"), MAX_PIPELINE);
+
+    /* 剩余的一个请求由调用方处理后继续发送 */
+    ASSERT_TRUE(pair.session->process());
+    EXPECT_EQ(pair.session->write_buf(), http_session::WRITE_DONE);
+    ssize_t n;
+    while((n = read(pair.fds[1], buf, sizeof(buf))) > 0) {
+        res.append(buf, n);
+    }
+    EXPECT_EQ(count(res, "HTTP/1.1 200 OK\r\n"), MAX_PIPELINE + 1);
+}
+
+/* 无法确定body边界的请求返回400并关闭连接 */
+TEST(test_http_session, ambiguous_framing_rejected) {
+    const char* bad[] = {
+        "POST / HTTP/1.1\r\nTransfer-Encoding : chunked\r\nContent-Length: 3\r\n\r\n0\r\n\r\n",
+        "POST / HTTP/1.1\r\ntransfer-ENCODING: chunked\r\ncontent-LENGTH: 3\r\n\r\n0\r\n\r\n",
+        "POST / HTTP/1.0\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n",
+    };
+    for(const char* req: bad) {
+        session_pair pair;
+        bool open = true;
+        std::string res = pair.exchange(req, open);
+        EXPECT_FALSE(open) << req;
+        EXPECT_EQ(res.compare(0, 24, "HTTP/1.1 400 Bad Request"), 0) << req << res;
+        EXPECT_EQ(count(res, "HTTP/1.1"), 1u) << req;
+    }
+}
+
+
+/* inline_ready分类后的process直接使用分类结果: 不再解析请求头，也不再查找缓存 */
+TEST(test_http_session, inline_reuses_classification) {
+    static_cache* cache = static_cache::get_instance();
+    cache->init(16 * 1024, 1024, 1000);
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_size = 5;
+    cache->insert("/inline_hint.html", 200, "hello", "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: close\r\n",
+                  "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: keep-alive\r\n", st);
+
+    session_pair pair;
+    std::string req;
+    for(int i = 0; i < 3; ++i) {
+        req += "GET /inline_hint.html HTTP/1.1\r\nHost: a\r\n\r\n";
+    }
+    req += "GET /inline_hint.html HTTP/1.1\r\nHo";      // 不完整的请求留到下一次读取
+    ASSERT_EQ(write(pair.fds[1], req.data(), req.size()), static_cast<ssize_t>(req.size()));
+    ASSERT_EQ(pair.session->read_buf(), http_session::READ_DATA);
+
+    metrics* m = metrics::get_instance();
+    uint64_t parsed = m->histogram(METRIC_PARSE_TIME).count();
+    static_cache::cache_stats before = cache->stats();
+    ASSERT_TRUE(pair.session->inline_ready());
+    ASSERT_TRUE(pair.session->process());
+    /* 只有末尾不完整的请求被重新解析 */
+    EXPECT_EQ(m->histogram(METRIC_PARSE_TIME).count() - parsed, 1u);
+    static_cache::cache_stats after = cache->stats();
+    EXPECT_EQ(after.hits - before.hits, 3u);
+    EXPECT_EQ(after.misses - before.misses, 0u);
+
+    /* 缓冲区中还有不完整的请求，交回reactor */
+    EXPECT_EQ(pair.session->write_buf(), http_session::WRITE_PENDING);
+    std::string res;
+    char buf[4096];
+    ssize_t n;
+    while((n = read(pair.fds[1], buf, sizeof(buf))) > 0) {
+        res.append(buf, n);
+    }
+    EXPECT_EQ(count(res, "HTTP/1.1 200 OK\r\n"), 3u);
+    EXPECT_EQ(count(res, "\r\n\r\nhello"), 3u);
+
+    /* 分类之后缓冲区有变化(又读到数据)时重新解析，结果不受影响 */
+    std::string rest = "st: a\r\n\r\nGET /inline_hint.html HTTP/1.1\r\n\r\n";
+    ASSERT_EQ(write(pair.fds[1], rest.data(), rest.size()), static_cast<ssize_t>(rest.size()));
+    ASSERT_EQ(pair.session->read_buf(), http_session::READ_DATA);
+    ASSERT_TRUE(pair.session->inline_ready());
+    std::string last = "GET /inline_hint.html HTTP/1.1\r\n\r\n";
+    ASSERT_EQ(write(pair.fds[1], last.data(), last.size()), static_cast<ssize_t>(last.size()));
+    ASSERT_EQ(pair.session->read_buf(), http_session::READ_DATA);
+    parsed = m->histogram(METRIC_PARSE_TIME).count();
+    ASSERT_TRUE(pair.session->process());
+    EXPECT_EQ(m->histogram(METRIC_PARSE_TIME).count() - parsed, 3u);
+    EXPECT_EQ(pair.session->write_buf(), http_session::WRITE_DONE);
+    res.clear();
+    while((n = read(pair.fds[1], buf, sizeof(buf))) > 0) {
+        res.append(buf, n);
+    }
+    EXPECT_EQ(count(res, "\r\n\r\nhello"), 3u);
+    cache->init(0, 0, 1000);
+}
+
+/* 完成模式: 数据经feed交给session，write_buf只提交sendmsg，发送完成事件经send_done后再由write_buf继续，
+ * 发送期间到达的请求留在读缓冲区中，发送完后返回WRITE_PENDING */
+TEST(test_http_session, completion_io_send) {
+    std::shared_ptr<poller> ring = make_poller(POLLER_IO_URING, 16);
+    if(!ring->completion_io()) {
+        GTEST_SKIP() << "io_uring completion unavailable";
+    }
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    http_session session(fds[0], EPOLLIN | EPOLLONESHOT, ring, 7);
+    session.use_completion_io();
+    ring->recv_multishot(fds[0], 7);
+
+    std::string req = "GET /metrics HTTP/1.1\r\nHost: a\r\n\r\n";
+    ASSERT_EQ(write(fds[1], req.data(), req.size()), static_cast<ssize_t>(req.size()));
+    std::string res;
+    char buf[16384];
+    int sends = 0;
+    bool more = false;
+    for(int round = 0; round < 1000 && count(res, "0\r\n\r\n") < 3; ++round) {
+        int num = ring->wait(10);
+        for(int i = 0; i < num; ++i) {
+            ASSERT_EQ(ring->get_event_data(i), 7u);
+            http_session::WRITE_RESULT ret = http_session::WRITE_DONE;
+            if(ring->get_op(i) == OP_RECV) {
+                ASSERT_GT(ring->get_result(i), 0);
+                session.feed(ring->get_buffer(i), ring->get_result(i));
+                if(session.write_pending()) {
+                    continue;
+                }
+                ASSERT_TRUE(session.process());
+                ret = session.write_buf();
+            } else {
+                ASSERT_EQ(ring->get_op(i), OP_SEND);
+                ++sends;
+                ASSERT_TRUE(session.send_done(ring->get_result(i)));
+                ret = session.write_buf();
+            }
+            if(ret == http_session::WRITE_PENDING) {
+                ASSERT_TRUE(session.process());
+                ret = session.write_buf();
+            }
+            ASSERT_EQ(ret, http_session::WRITE_DONE);
+        }
+        /* 第一个响应发送期间再发两个请求 */
+        if(!more && sends == 0 && session.sending()) {
+            more = true;
+            req += req;
+            ASSERT_EQ(write(fds[1], req.data(), req.size()), static_cast<ssize_t>(req.size()));
+        }
+        ssize_t n;
+        while((n = read(fds[1], buf, sizeof(buf))) > 0) {
+            res.append(buf, n);
+        }
+    }
+    EXPECT_GT(sends, 0);
+    EXPECT_FALSE(session.sending());
+    EXPECT_EQ(count(res, "HTTP/1.1 200 OK\r\n"), 3u);
+    EXPECT_EQ(count(res, "Transfer-Encoding: chunked\r\n"), 3u);
+    ring->del_fd(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+#include "metrics.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+
+TEST(test_metrics, per_thread_counters) {
+    metrics* m = metrics::get_instance();
+    uint64_t before = m->counter(METRIC_RESPONSE_BYTES);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread([]() {
+            for(int i = 0; i < 10000; ++i) {
+                metrics::add(METRIC_RESPONSE_BYTES, 3);
+            }
+        }));
+    }
+    for(std::thread& t: threads) {
+        t.join();
+    }
+    /* 线程退出后分片保留，累计值不减少 */
+    EXPECT_EQ(m->counter(METRIC_RESPONSE_BYTES) - before, 4u * 10000 * 3);
+}
+
+TEST(test_metrics, histogram_and_render) {
+    metrics* m = metrics::get_instance();
+    uint64_t before = m->histogram(METRIC_POOL_WAIT).count();
+    std::thread worker([]() {
+        for(int i = 0; i < 100; ++i) {
+            metrics::record(METRIC_POOL_WAIT, 2000);       // 2us
+        }
+        metrics::record(METRIC_POOL_WAIT, 2000000000);     // 2s，超过最大的导出桶
+    });
+    worker.join();
+    EXPECT_EQ(m->histogram(METRIC_POOL_WAIT).count() - before, 101u);
+
+    m->add_collector("sws_test_gauge", "Test gauge.", "gauge", []() { return 42.0; });
+    std::string text = m->render();
+    m->clear_collectors();
+
+    EXPECT_NE(text.find("# TYPE sws_connections_accepted_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("sws_http_responses_total{code=\"2xx\"} "), std::string::npos);
+    EXPECT_EQ(text.find("# TYPE sws_http_responses_total counter"), text.rfind("# TYPE sws_http_responses_total counter"));
+    EXPECT_NE(text.find("# TYPE sws_thread_pool_wait_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(text.find("sws_test_gauge 42\n"), std::string::npos);
+
+    /* 2us的记录落在le=2.5e-06及之后的桶，2s的只在+Inf中 */
+    std::string prefix = "sws_thread_pool_wait_seconds_bucket{le=\"";
+    auto bucket = [&](const std::string& le) {
+        size_t pos = text.find(prefix + le + "\"} ");
+        EXPECT_NE(pos, std::string::npos) << le;
+        return std::stoull(text.substr(pos + prefix.size() + le.size() + 3));
+    };
+    uint64_t inf = bucket("+Inf");
+    EXPECT_EQ(bucket("2.5e-06") + 1, bucket("1") + 1);
+    EXPECT_EQ(bucket("1") + 1, inf);
+    EXPECT_GE(bucket("2.5e-06") - bucket("1e-06"), 100u);
+}
\ No newline at end of file
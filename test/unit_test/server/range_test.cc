@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+#include "http_response.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+http_response::RANGE_RESULT parse(const char* spec, off_t size, std::vector<byte_range>& ranges) {
+    return http_response::parse_range(spec, size, ranges);
+}
+
+}
+
+
+TEST(test_range, single_and_suffix) {
+    std::vector<byte_range> ranges;
+    ASSERT_EQ(parse("bytes=100-199", 1000, ranges), http_response::RANGE_OK);
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].offset, 100);
+    EXPECT_EQ(ranges[0].len, 100u);
+
+    /* 结束位置超出文件时截断 */
+    ASSERT_EQ(parse("bytes=900-5000", 1000, ranges), http_response::RANGE_OK);
+    EXPECT_EQ(ranges[0].offset, 900);
+    EXPECT_EQ(ranges[0].len, 100u);
+
+    ASSERT_EQ(parse("bytes=990-", 1000, ranges), http_response::RANGE_OK);
+    EXPECT_EQ(ranges[0].offset, 990);
+    EXPECT_EQ(ranges[0].len, 10u);
+
+    ASSERT_EQ(parse("bytes=-300", 1000, ranges), http_response::RANGE_OK);
+    EXPECT_EQ(ranges[0].offset, 700);
+    EXPECT_EQ(ranges[0].len, 300u);
+
+    ASSERT_EQ(parse("bytes=-5000", 1000, ranges), http_response::RANGE_OK);
+    EXPECT_EQ(ranges[0].offset, 0);
+    EXPECT_EQ(ranges[0].len, 1000u);
+}
+
+TEST(test_range, multi_range) {
+    std::vector<byte_range> ranges;
+    ASSERT_EQ(parse("Bytes=0-9, 50-59 ,-10", 1000, ranges), http_response::RANGE_OK);
+    ASSERT_EQ(ranges.size(), 3u);
+    EXPECT_EQ(ranges[0].offset, 0);
+    EXPECT_EQ(ranges[1].offset, 50);
+    EXPECT_EQ(ranges[2].offset, 990);
+    EXPECT_EQ(ranges[2].len, 10u);
+
+    /* 无法满足的段被跳过 */
+    ASSERT_EQ(parse("bytes=0-9,2000-2100", 1000, ranges), http_response::RANGE_OK);
+    EXPECT_EQ(ranges.size(), 1u);
+}
+
+TEST(test_range, unsatisfiable_and_ignored) {
+    std::vector<byte_range> ranges;
+    EXPECT_EQ(parse("bytes=1000-", 1000, ranges), http_response::RANGE_UNSATISFIABLE);
+    EXPECT_EQ(parse("bytes=-0", 1000, ranges), http_response::RANGE_UNSATISFIABLE);
+    EXPECT_EQ(parse("bytes=0-", 0, ranges), http_response::RANGE_UNSATISFIABLE);
+
+    const char* ignored[] = {
+        "",
+        "items=0-9",
+        "bytes=",
+        "bytes=abc",
+        "bytes=9-0",
+        "bytes=-",
+        "bytes=1-2-3",
+        "bytes=0-,0-",          // 重叠请求总长超过文件大小
+    };
+    for(const char* spec: ignored) {
+        EXPECT_EQ(parse(spec, 1000, ranges), http_response::RANGE_IGNORE) << spec;
+        EXPECT_TRUE(ranges.empty()) << spec;
+    }
+
+    std::string many = "bytes=0-0";
+    for(size_t i = 1; i <= http_response::MAX_RANGES; ++i) {
+        many += "," + std::to_string(i * 10) + "-" + std::to_string(i * 10);
+    }
+    EXPECT_EQ(parse(many.c_str(), 1000, ranges), http_response::RANGE_IGNORE);
+}
\ No newline at end of file
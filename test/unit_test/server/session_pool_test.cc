@@ -0,0 +1,37 @@
+#include "gtest/gtest.h"
+#include "session_pool.h"
+
+#include <thread>
+
+TEST(test_session_pool, reuse_after_last_ref) {
+    session_pool pool(4);
+    std::shared_ptr<poller> epl;
+
+    session_ptr s1 = pool.acquire(10, 0, epl, 0);
+    http_session* raw = s1.get();
+    {
+        /* 任务持有的引用未释放前不能回收 */
+        session_ptr task_ref = s1;
+        s1.reset();
+        session_ptr s2 = pool.acquire(11, 0, epl, 0);
+        EXPECT_NE(s2.get(), raw);
+    }
+
+    session_ptr s3 = pool.acquire(12, 0, epl, 0);
+    EXPECT_TRUE(s3);
+    EXPECT_EQ(pool.stats().created, 2u);
+    EXPECT_EQ(pool.stats().reused, 1u);
+}
+
+TEST(test_session_pool, release_from_other_thread) {
+    session_pool pool(64);
+    std::shared_ptr<poller> epl;
+    for(int round = 0; round < 100; ++round) {
+        session_ptr s = pool.acquire(round, 0, epl, 0);
+        std::thread worker([s]() mutable { s.reset(); });
+        s.reset();
+        worker.join();
+    }
+    EXPECT_EQ(pool.stats().created + pool.stats().reused, 100u);
+    EXPECT_LE(pool.stats().created, 2u);
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include "static_cache.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+struct stat make_stat(off_t size) {
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_size = size;
+    return st;
+}
+
+}
+
+TEST(test_static_cache, hit_and_miss) {
+    static_cache* cache = static_cache::get_instance();
+    cache->init(16 * 1024, 1024, 1000);
+    static_cache::cache_stats before = cache->stats();
+
+    bool need_revalidate = false;
+    EXPECT_EQ(cache->lookup("/hit_and_miss.html", need_revalidate), nullptr);
+
+    std::string body(100, 'x');
+    cache->insert("/hit_and_miss.html", 200, body, "close-head", "keepalive-head", make_stat(100));
+    static_cache::entry_ptr entry = cache->lookup("/hit_and_miss.html", need_revalidate);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_FALSE(need_revalidate);
+    EXPECT_EQ(entry->body, body);
+    EXPECT_EQ(entry->headers[0], "close-head");
+    EXPECT_EQ(entry->headers[1], "keepalive-head");
+
+    static_cache::cache_stats after = cache->stats();
+    EXPECT_EQ(after.hits - before.hits, 1u);
+    EXPECT_EQ(after.misses - before.misses, 1u);
+
+    cache->erase("/hit_and_miss.html");
+    EXPECT_EQ(cache->lookup("/hit_and_miss.html", need_revalidate), nullptr);
+}
+
+TEST(test_static_cache, budget) {
+    static_cache* cache = static_cache::get_instance();
+    /* 16个分片，每个分片1KB */
+    cache->init(16 * 1024, 1024, 1000);
+    EXPECT_TRUE(cache->cacheable(1000));
+    EXPECT_FALSE(cache->cacheable(2000));
+
+    for(int i = 0; i < 200; ++i) {
+        std::string path = "/budget_" + std::to_string(i);
+        cache->insert(path, 200, std::string(500, 'b'), "", "", make_stat(500));
+    }
+    static_cache::cache_stats st = cache->stats();
+    EXPECT_LE(st.bytes, 16u * 1024);
+    EXPECT_GT(st.evictions, 0u);
+
+    /* 被淘汰的条目仍由持有者引用，不会提前释放 */
+    static_cache::entry_ptr held = cache->insert("/budget_held", 200, std::string(900, 'h'), "", "", make_stat(900));
+    for(int i = 0; i < 200; ++i) {
+        std::string path = "/budget_more_" + std::to_string(i);
+        cache->insert(path, 200, std::string(500, 'b'), "", "", make_stat(500));
+    }
+    EXPECT_EQ(held->body.size(), 900u);
+
+    cache->init(0, 0, 1000);
+    bool need_revalidate = false;
+    EXPECT_EQ(cache->lookup("/budget_held", need_revalidate), nullptr);
+}
+
+TEST(test_static_cache, fresh) {
+    static_cache* cache = static_cache::get_instance();
+    cache->init(16 * 1024, 1024, 50);
+    EXPECT_FALSE(cache->fresh("/fresh.html"));
+
+    cache->insert("/fresh.html", 200, std::string(100, 'f'), "", "", make_stat(100));
+    cache->insert("/fresh_404.html", 404, std::string(100, 'n'), "", "", make_stat(100));
+    static_cache::cache_stats before = cache->stats();
+    static_cache::entry_ptr entry = cache->fresh("/fresh.html");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->body, std::string(100, 'f'));
+    EXPECT_FALSE(cache->fresh("/fresh_404.html"));
+    /* 只是探测，不计入命中统计 */
+    EXPECT_EQ(cache->stats().hits, before.hits);
+
+    /* 超过校验间隔后需要由调用方stat确认 */
+    usleep(80 * 1000);
+    EXPECT_FALSE(cache->fresh("/fresh.html"));
+
+    cache->init(0, 0, 1000);
+    EXPECT_FALSE(cache->fresh("/fresh.html"));
+}
+
+TEST(test_static_cache, approximate_lru) {
+    static_cache* cache = static_cache::get_instance();
+    /* 每个分片1KB，最多两个400B的条目 */
+    cache->init(16 * 1024, 1024, 1000);
+    cache->insert("/lru_hot.html", 200, std::string(400, 'h'), "", "", make_stat(400));
+    bool need_revalidate = false;
+    for(int i = 0; i < 64; ++i) {
+        usleep(1100);
+        ASSERT_NE(cache->lookup("/lru_hot.html", need_revalidate), nullptr) << i;
+        usleep(1100);
+        cache->insert("/lru_cold_" + std::to_string(i), 200, std::string(400, 'c'), "", "", make_stat(400));
+    }
+    /* 一直被访问的条目不会被淘汰，淘汰的是更早插入且未再访问的条目 */
+    EXPECT_NE(cache->lookup("/lru_hot.html", need_revalidate), nullptr);
+    EXPECT_GT(cache->stats().evictions, 0u);
+    cache->init(0, 0, 1000);
+}
+
+TEST(test_static_cache, concurrent_readers) {
+    static_cache* cache = static_cache::get_instance();
+    cache->init(16 * 1024, 1024, 1000);
+    const int path_num = 64;
+    std::atomic<bool> stop(false);
+    std::atomic<int> bad(0);
+    std::vector<std::thread> readers;
+    for(int t = 0; t < 4; ++t) {
+        readers.emplace_back([&]() {
+            bool need_revalidate = false;
+            for(int i = 0; !stop.load(); i = (i + 1) % path_num) {
+                static_cache::entry_ptr entry = cache->lookup("/concurrent_" + std::to_string(i), need_revalidate);
+                /* 条目被替换或淘汰后，已取得的引用仍然完整 */
+                if(entry && entry->body != std::string(entry->body.size(), 'a' + i % 26)) {
+                    bad++;
+                }
+                cache->fresh("/concurrent_" + std::to_string(i));
+            }
+        });
+    }
+    for(int round = 0; round < 200; ++round) {
+        for(int i = 0; i < path_num; ++i) {
+            std::string path = "/concurrent_" + std::to_string(i);
+            if((round + i) % 7 == 0) {
+                cache->erase(path);
+            } else {
+                cache->insert(path, 200, std::string(300 + round, 'a' + i % 26), "", "", make_stat(300 + round));
+            }
+        }
+    }
+    stop = true;
+    for(std::thread& t: readers) {
+        t.join();
+    }
+    EXPECT_EQ(bad.load(), 0);
+    EXPECT_LE(cache->stats().bytes, 16u * 1024);
+    cache->init(0, 0, 1000);
+}
\ No newline at end of file
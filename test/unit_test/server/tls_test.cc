@@ -0,0 +1,200 @@
+#include "gtest/gtest.h"
+#include "tls_context.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+namespace {
+
+const char CERT_FILE[] = "/tmp/sws_tls_test_cert.pem";
+const char KEY_FILE[] = "/tmp/sws_tls_test_key.pem";
+
+/* 生成自签名的P-256证书，测试不依赖仓库中的证书文件 */
+bool write_self_signed() {
+    EVP_PKEY* pkey = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    if(pkey == nullptr || cert == nullptr) {
+        return false;
+    }
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, pkey);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, pkey, EVP_sha256());
+
+    FILE* f = fopen(CERT_FILE, "w");
+    bool ok = f && PEM_write_X509(f, cert) == 1;
+    if(f) {
+        fclose(f);
+    }
+    f = fopen(KEY_FILE, "w");
+    ok = ok && f && PEM_write_PrivateKey(f, pkey, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    if(f) {
+        fclose(f);
+    }
+    X509_free(cert);
+    EVP_PKEY_free(pkey);
+    return ok;
+}
+
+/**
+ * @brief socketpair两端: 服务端为被测的tls_connection，客户端为非阻塞的SSL
+ */
+struct tls_pair {
+    int fds[2];
+    tls_connection server;
+    SSL* client;
+
+    tls_pair(tls_context& ctx, SSL_CTX* client_ctx, SSL_SESSION* session = nullptr): client(nullptr) {
+        EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        for(int fd: fds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+        EXPECT_TRUE(server.attach(&ctx, fds[0]));
+        client = SSL_new(client_ctx);
+        SSL_set_fd(client, fds[1]);
+        SSL_set_connect_state(client);
+        if(session) {
+            SSL_set_session(client, session);
+        }
+    }
+
+    ~tls_pair() {
+        server.detach();
+        /* 客户端正常发送close_notify，否则OpenSSL会把客户端持有的会话标记为不可恢复 */
+        SSL_shutdown(client);
+        SSL_free(client);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    /* 双方交替推进，直到两端都完成握手 */
+    bool handshake() {
+        for(int i = 0; i < 100; ++i) {
+            int ret = SSL_do_handshake(client);
+            tls_connection::TLS_RESULT res = server.handshake_done() ? tls_connection::TLS_OK : server.handshake();
+            if(res == tls_connection::TLS_ERROR) {
+                return false;
+            }
+            if(ret == 1 && res == tls_connection::TLS_OK) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* 客户端读取len字节明文，TLS 1.3的会话票据也在这时被处理 */
+    std::string client_read(size_t len) {
+        std::string res;
+        char buf[4096];
+        for(int i = 0; i < 1000 && res.size() < len; ++i) {
+            int n = SSL_read(client, buf, sizeof(buf));
+            if(n > 0) {
+                res.append(buf, n);
+            }
+        }
+        return res;
+    }
+};
+
+class test_tls : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        ASSERT_TRUE(write_self_signed());
+    }
+
+    void SetUp() override {
+        ASSERT_TRUE(ctx.init(CERT_FILE, KEY_FILE));
+        client_ctx = SSL_CTX_new(TLS_client_method());
+    }
+
+    void TearDown() override {
+        SSL_CTX_free(client_ctx);
+    }
+
+    tls_context ctx;
+    SSL_CTX* client_ctx;
+};
+
+}
+
+
+TEST_F(test_tls, read_write_and_sendfile) {
+    tls_pair pair(ctx, client_ctx);
+    ASSERT_TRUE(pair.handshake());
+    EXPECT_FALSE(pair.server.resumed());
+
+    /* 读: 没有数据时返回EAGAIN */
+    char buf[64];
+    int err = 0;
+    EXPECT_EQ(pair.server.read(buf, sizeof(buf), err), -1);
+    EXPECT_EQ(err, EAGAIN);
+    ASSERT_EQ(SSL_write(pair.client, "GET / HTTP/1.1\r\n\r\n", 18), 18);
+    ASSERT_EQ(pair.server.read(buf, sizeof(buf), err), 18);
+    EXPECT_EQ(std::string(buf, 18), "GET / HTTP/1.1\r\n\r\n");
+
+    /* 写: 多段合并为一条记录 */
+    std::string head = "HTTP/1.1 200 OK\r\n\r\n";
+    std::string body(100, 'b');
+    struct iovec iov[2] = { { &head[0], head.size() }, { &body[0], body.size() } };
+    ASSERT_EQ(pair.server.writev(iov, 2), static_cast<ssize_t>(head.size() + body.size()));
+    EXPECT_EQ(pair.client_read(head.size() + body.size()), head + body);
+
+    /* sendfile: 未开启kTLS时读出文件窗口后加密发送，offset随之推进 */
+    char path[] = "/tmp/sws_tls_test_XXXXXX";
+    int file_fd = mkstemp(path);
+    ASSERT_GE(file_fd, 0);
+    unlink(path);
+    std::string content(40000, '\0');
+    for(size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>('a' + i % 26);
+    }
+    ASSERT_EQ(write(file_fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+    off_t offset = 1000;
+    size_t remain = 30000;
+    std::string received;
+    while(remain > 0) {
+        ssize_t n = pair.server.sendfile(file_fd, &offset, remain);
+        ASSERT_GT(n, 0);
+        remain -= n;
+        received += pair.client_read(n);
+    }
+    EXPECT_EQ(offset, 31000);
+    EXPECT_EQ(received, content.substr(1000, 30000));
+    close(file_fd);
+}
+
+TEST_F(test_tls, session_resumption) {
+    const int versions[] = { TLS1_2_VERSION, TLS1_3_VERSION };
+    for(int version: versions) {
+        SSL_CTX_set_min_proto_version(client_ctx, version);
+        SSL_CTX_set_max_proto_version(client_ctx, version);
+        SSL_SESSION* session = nullptr;
+        {
+            tls_pair pair(ctx, client_ctx);
+            ASSERT_TRUE(pair.handshake());
+            EXPECT_FALSE(pair.server.resumed());
+            struct iovec iov = { const_cast<char*>("ok"), 2 };
+            ASSERT_EQ(pair.server.writev(&iov, 1), 2);
+            EXPECT_EQ(pair.client_read(2), "ok");
+            session = SSL_get1_session(pair.client);
+            ASSERT_NE(session, nullptr);
+        }
+        /* 连接关闭(未发送close_notify)后会话仍可恢复 */
+        tls_pair resumed(ctx, client_ctx, session);
+        ASSERT_TRUE(resumed.handshake());
+        EXPECT_TRUE(resumed.server.resumed()) << version;
+        SSL_SESSION_free(session);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include "gtest/gtest.h"
+#include "epoll/uring_poller.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+namespace {
+
+/* 取出一次wait返回的所有事件的data */
+std::vector<uint64_t> wait_data(poller& p, int timeout_ms) {
+    std::vector<uint64_t> res;
+    int num = p.wait(timeout_ms);
+    for(int i = 0; i < num; ++i) {
+        res.push_back(p.get_event_data(i));
+    }
+    return res;
+}
+
+void signal(int efd) {
+    uint64_t one = 1;
+    ASSERT_EQ(write(efd, &one, sizeof(one)), static_cast<ssize_t>(sizeof(one)));
+}
+
+void clear(int efd) {
+    uint64_t cnt;
+    ssize_t ret = read(efd, &cnt, sizeof(cnt));
+    (void)ret;
+}
+
+/* 当前线程的io_uring_setup返回ENOSYS，模拟被seccomp禁用 */
+bool block_io_uring_setup() {
+    struct sock_filter filter[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_io_uring_setup, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | ENOSYS),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+    };
+    struct sock_fprog prog = { static_cast<unsigned short>(sizeof(filter) / sizeof(filter[0])), filter };
+    return prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == 0 && prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) == 0;
+}
+
+/* 监听127.0.0.1的随机端口，port返回实际端口 */
+int listen_loopback(int& port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if(fd < 0 || bind(fd, reinterpret_cast<struct sockaddr*>(&addr), len) < 0 || listen(fd, 16) < 0
+       || getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len) < 0) {
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+int connect_loopback(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if(connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+class test_uring_poller : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ring.reset(new uring_poller(64));
+        if(!ring->valid()) {
+            GTEST_SKIP() << "io_uring unavailable";
+        }
+    }
+
+    std::unique_ptr<uring_poller> ring;
+};
+
+}
+
+
+TEST_F(test_uring_poller, add_mod_del) {
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ASSERT_GE(efd, 0);
+    ring->add_fd(efd, EPOLLIN | EPOLLONESHOT, 1);
+    EXPECT_TRUE(wait_data(*ring, 0).empty());
+
+    signal(efd);
+    std::vector<uint64_t> data = wait_data(*ring, 1000);
+    ASSERT_EQ(data.size(), 1u);
+    EXPECT_EQ(data[0], 1u);
+    EXPECT_TRUE(ring->get_event(0) & EPOLLIN);
+    /* oneshot: 触发后不再上报，直到mod_fd重新注册 */
+    EXPECT_TRUE(wait_data(*ring, 0).empty());
+
+    ring->mod_fd(efd, EPOLLIN | EPOLLONESHOT, 2);
+    data = wait_data(*ring, 1000);
+    ASSERT_EQ(data.size(), 1u);
+    EXPECT_EQ(data[0], 2u);
+
+    /* 删除后即使可读也没有事件 */
+    ring->mod_fd(efd, EPOLLIN | EPOLLONESHOT, 3);
+    ring->del_fd(efd);
+    EXPECT_TRUE(wait_data(*ring, 50).empty());
+    close(efd);
+}
+
+/* fd被关闭后复用: 旧注册的完成事件(包括已在CQ中的)按序号丢弃，只上报新注册的data */
+TEST_F(test_uring_poller, drop_stale_completions) {
+    int pipe_fds[2];
+    ASSERT_EQ(pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC), 0);
+    int fd = pipe_fds[0];
+    ring->add_fd(fd, EPOLLIN, 1);
+    EXPECT_TRUE(wait_data(*ring, 0).empty());
+    /* 可读事件在下一次wait之前进入CQ */
+    ASSERT_EQ(write(pipe_fds[1], "x", 1), 1);
+
+    ring->del_fd(fd);
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ASSERT_GE(efd, 0);
+    ASSERT_EQ(dup2(efd, fd), fd);
+    close(efd);
+    ring->add_fd(fd, EPOLLIN | EPOLLONESHOT, 2);
+    /* 新的fd未就绪，此时上报的只可能是旧注册的事件 */
+    EXPECT_TRUE(wait_data(*ring, 50).empty());
+
+    signal(fd);
+    std::vector<uint64_t> data = wait_data(*ring, 1000);
+    ASSERT_EQ(data.size(), 1u);
+    EXPECT_EQ(data[0], 2u);
+    close(fd);
+    close(pipe_fds[1]);
+}
+
+/* 非oneshot的fd使用multishot poll: 每次就绪都上报，被内核终止(CQ溢出)后自动重新注册 */
+TEST_F(test_uring_poller, multishot_rearm) {
+    const int fd_num = 600;        // 超过CQ容量(2 * 256)，部分multishot请求被终止
+    std::unique_ptr<uring_poller> small(new uring_poller(1));
+    ASSERT_TRUE(small->valid());
+    std::vector<int> fds;
+    for(int i = 0; i < fd_num; ++i) {
+        int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ASSERT_GE(efd, 0);
+        fds.push_back(efd);
+        small->add_fd(efd, EPOLLIN, i);
+    }
+    EXPECT_TRUE(wait_data(*small, 0).empty());
+
+    for(int round = 0; round < 2; ++round) {
+        for(int efd: fds) {
+            signal(efd);
+        }
+        std::set<uint64_t> seen;
+        for(int idle = 0; idle < 3 && static_cast<int>(seen.size()) < fd_num;) {
+            std::vector<uint64_t> data = wait_data(*small, 20);
+            idle = data.empty() ? idle + 1 : 0;
+            seen.insert(data.begin(), data.end());
+        }
+        EXPECT_EQ(static_cast<int>(seen.size()), fd_num) << "round " << round;
+        for(int efd: fds) {
+            clear(efd);
+        }
+        /* 清空本轮剩余的事件 */
+        while(!wait_data(*small, 0).empty()) {}
+    }
+    for(int efd: fds) {
+        small->del_fd(efd);
+        close(efd);
+    }
+}
+
+/* 一次multishot accept得到所有新连接；multishot recv的数据在poller的缓冲区中，对端关闭时结果为0 */
+TEST_F(test_uring_poller, multishot_accept_recv) {
+    if(!ring->completion_io()) {
+        GTEST_SKIP() << "multishot recv unsupported";
+    }
+    int port = 0;
+    int listen_fd = listen_loopback(port);
+    ASSERT_GE(listen_fd, 0);
+    ring->accept_multishot(listen_fd, 100);
+
+    std::vector<int> clients;
+    for(int i = 0; i < 3; ++i) {
+        clients.push_back(connect_loopback(port));
+        ASSERT_GE(clients.back(), 0);
+    }
+    std::vector<int> accepted;
+    for(int idle = 0; idle < 3 && accepted.size() < clients.size();) {
+        int num = ring->wait(100);
+        idle = num > 0 ? 0 : idle + 1;
+        for(int i = 0; i < num; ++i) {
+            EXPECT_EQ(ring->get_op(i), OP_ACCEPT);
+            EXPECT_EQ(ring->get_event_data(i), 100u);
+            ASSERT_GE(ring->get_result(i), 0);
+            accepted.push_back(ring->get_result(i));
+        }
+    }
+    ASSERT_EQ(accepted.size(), clients.size());
+    /* 新连接已是非阻塞的 */
+    EXPECT_TRUE(fcntl(accepted[0], F_GETFL) & O_NONBLOCK);
+
+    ring->recv_multishot(accepted[0], 200);
+    EXPECT_EQ(ring->wait(0), 0);
+    std::string received;
+    for(const char* msg: {"GET / HTTP/1.1\r\n", "Host: a\r\n\r\n"}) {
+        ASSERT_EQ(write(clients[0], msg, strlen(msg)), static_cast<ssize_t>(strlen(msg)));
+        int num = ring->wait(1000);
+        ASSERT_EQ(num, 1);
+        EXPECT_EQ(ring->get_op(0), OP_RECV);
+        EXPECT_EQ(ring->get_event_data(0), 200u);
+        ASSERT_GT(ring->get_result(0), 0);
+        received.append(ring->get_buffer(0), ring->get_result(0));
+    }
+    EXPECT_EQ(received, "GET / HTTP/1.1\r\nHost: a\r\n\r\n");
+
+    close(clients[0]);
+    ASSERT_EQ(ring->wait(1000), 1);
+    EXPECT_EQ(ring->get_op(0), OP_RECV);
+    EXPECT_EQ(ring->get_result(0), 0);
+
+    ring->del_fd(listen_fd);
+    close(listen_fd);
+    for(size_t i = 0; i < accepted.size(); ++i) {
+        ring->del_fd(accepted[i]);
+        close(accepted[i]);
+        if(i > 0) {
+            close(clients[i]);
+        }
+    }
+}
+
+/* 接收的数据总量远超缓冲区环容量: 缓冲区在下一次wait时归还，耗尽后multishot recv自动重新提交，数据不丢失、不乱序 */
+TEST_F(test_uring_poller, recv_buffers_recycled) {
+    if(!ring->completion_io()) {
+        GTEST_SKIP() << "multishot recv unsupported";
+    }
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    ring->recv_multishot(fds[0], 1);
+
+    const size_t total = 4 * uring_poller::RECV_BUF_NUM * uring_poller::RECV_BUF_SIZE;
+    std::string sent(total, '\0');
+    for(size_t i = 0; i < total; ++i) {
+        sent[i] = static_cast<char>(i * 131 + (i >> 12));
+    }
+    std::thread writer([&sent, &fds]() {
+        size_t off = 0;
+        /* 接收方出错停止读取时最多等待5s */
+        for(int stall = 0; off < sent.size() && stall < 50000;) {
+            ssize_t n = write(fds[1], sent.data() + off, sent.size() - off);
+            if(n > 0) {
+                off += n;
+                stall = 0;
+            } else {
+                usleep(100);
+                ++stall;
+            }
+        }
+    });
+    std::string received;
+    for(int idle = 0; idle < 20 && received.size() < total;) {
+        int num = ring->wait(100);
+        idle = num > 0 ? 0 : idle + 1;
+        for(int i = 0; i < num; ++i) {
+            ASSERT_EQ(ring->get_op(i), OP_RECV);
+            ASSERT_GT(ring->get_result(i), 0);
+            received.append(ring->get_buffer(i), ring->get_result(i));
+        }
+    }
+    writer.join();
+    EXPECT_EQ(received.size(), total);
+    EXPECT_TRUE(received == sent);
+    ring->del_fd(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/* send_msg的完成事件带发送的字节数；del_fd取消阻塞中的发送后完成事件仍然上报，调用方据此释放数据 */
+TEST_F(test_uring_poller, send_completion_after_del) {
+    if(!ring->completion_io()) {
+        GTEST_SKIP() << "multishot recv unsupported";
+    }
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+    std::string data = "HTTP/1.1 200 OK\r\n\r\n";
+    struct iovec iov = { &data[0], data.size() };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    ASSERT_TRUE(ring->send_msg(fds[0], &msg, MSG_NOSIGNAL, 5));
+    ASSERT_EQ(ring->wait(1000), 1);
+    EXPECT_EQ(ring->get_op(0), OP_SEND);
+    EXPECT_EQ(ring->get_event_data(0), 5u);
+    EXPECT_EQ(ring->get_result(0), static_cast<int>(data.size()));
+    char buf[64];
+    EXPECT_EQ(read(fds[1], buf, sizeof(buf)), static_cast<ssize_t>(data.size()));
+
+    /* 对端不读且发送缓冲区已满，发送在内核中等待可写 */
+    while(write(fds[0], buf, sizeof(buf)) > 0) {}
+    ASSERT_TRUE(ring->send_msg(fds[0], &msg, MSG_NOSIGNAL, 6));
+    EXPECT_EQ(ring->wait(50), 0);
+    ring->del_fd(fds[0]);
+    ASSERT_EQ(ring->wait(1000), 1);
+    EXPECT_EQ(ring->get_op(0), OP_SEND);
+    EXPECT_EQ(ring->get_event_data(0), 6u);
+    EXPECT_EQ(ring->get_result(0), -ECANCELED);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/* io_uring_setup被禁用时make_poller回退到epoll */
+TEST(test_make_poller, fallback_to_epoll) {
+    std::string name;
+    std::thread t([&name]() {
+        if(!block_io_uring_setup()) {
+            return;
+        }
+        name = make_poller(POLLER_IO_URING, 64)->name();
+    });
+    t.join();
+    if(name.empty()) {
+        GTEST_SKIP() << "seccomp unavailable";
+    }
+    EXPECT_EQ(name, "epoll");
+}
\ No newline at end of file
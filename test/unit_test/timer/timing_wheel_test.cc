@@ -0,0 +1,96 @@
+#include "gtest/gtest.h"
+#include "timing_wheel.h"
+#include <thread>
+#include <vector>
+
+TEST(test_timing_wheel, add_del_update) {
+    timing_wheel wheel;
+    int fired = 0;
+    wheel.add(1, 10, [&fired]() { ++fired; });
+    wheel.add(2, 100, [&fired]() { ++fired; });
+    wheel.add(3, 200, [&fired]() { ++fired; });
+    EXPECT_EQ(wheel.size(), 3u);
+
+    wheel.update(3, 300);
+    EXPECT_EQ(wheel.size(), 3u);
+
+    wheel.del(3, false);
+    EXPECT_EQ(wheel.size(), 2u);
+    wheel.del(2, true);
+    EXPECT_EQ(wheel.size(), 1u);
+    EXPECT_EQ(fired, 1);
+
+    /* 重复删除不影响 */
+    wheel.del(2, true);
+    EXPECT_EQ(fired, 1);
+    wheel.print();
+}
+
+TEST(test_timing_wheel, tick) {
+    timing_wheel wheel(1);
+    std::vector<int> expired;
+    wheel.set_expire_handler([&expired](int fd) { expired.push_back(fd); });
+
+    wheel.add(1, 10);
+    wheel.add(2, 100);
+    wheel.add(3, 200);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    wheel.tick();
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0], 1);
+
+    /* 刷新后的连接不应在原来的时间点超时 */
+    wheel.update(2, 300);
+    std::this_thread::sleep_for(std::chrono::milliseconds(220));
+    wheel.tick();
+    ASSERT_EQ(expired.size(), 2u);
+    EXPECT_EQ(expired[1], 3);
+    EXPECT_FALSE(wheel.empty());
+}
+
+TEST(test_timing_wheel, cascade) {
+    /* 1ms一个tick，超时超过64个tick时节点挂在上层，需要下放后才会触发 */
+    timing_wheel wheel(1);
+    std::vector<int> expired;
+    wheel.set_expire_handler([&expired](int fd) { expired.push_back(fd); });
+    wheel.add(5, 150);
+    wheel.add(6, 5000);
+
+    size_t next = wheel.get_next_tick();
+    EXPECT_LE(next, static_cast<size_t>(timing_wheel::WHEEL_SLOTS));
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    wheel.tick();
+    EXPECT_TRUE(expired.empty());
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    wheel.tick();
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0], 5);
+    EXPECT_EQ(wheel.size(), 1u);
+}
+
+TEST(test_timing_wheel, callback_reenter) {
+    /* 超时回调中删除/重新添加其他节点 */
+    timing_wheel wheel(1);
+    int fired = 0;
+    wheel.set_expire_handler([&](int fd) {
+        ++fired;
+        wheel.del(fd == 1 ? 2 : 1, false);
+        wheel.add(fd + 10, 1000);
+    });
+    wheel.add(1, 5);
+    wheel.add(2, 5);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    wheel.tick();
+    EXPECT_EQ(fired, 2);
+    EXPECT_EQ(wheel.size(), 2u);
+}
+
+TEST(test_timing_wheel, clear) {
+    timing_wheel wheel;
+    EXPECT_EQ(wheel.get_next_tick(), static_cast<size_t>(-1));
+    wheel.add(1, 10);
+    EXPECT_FALSE(wheel.empty());
+
+    wheel.clear();
+    EXPECT_TRUE(wheel.empty());
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+#include "hdr_histogram.h"
+
+TEST(test_hdr_histogram, index_round_trip) {
+    /* 每个值都落在所在桶的[lowest, highest]内，且相对误差不超过1/64 */
+    const int bucket_num = hdr_histogram::BUCKET_NUM;
+    const uint64_t values[] = {0, 1, 127, 128, 129, 255, 256, 1000, 123456, 1ULL << 40, UINT64_MAX};
+    for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        int idx = hdr_histogram::index_of(values[i]);
+        ASSERT_LT(idx, bucket_num);
+        uint64_t low = hdr_histogram::lowest_equivalent(idx);
+        uint64_t high = hdr_histogram::highest_equivalent(idx);
+        EXPECT_LE(low, values[i]);
+        EXPECT_GE(high, values[i]);
+        EXPECT_LE(static_cast<double>(high - low), static_cast<double>(low) / 64.0 + 1);
+    }
+}
+
+TEST(test_hdr_histogram, percentile) {
+    hdr_histogram h;
+    for(uint64_t v = 1; v <= 10000; ++v) {
+        h.record(v);
+    }
+    EXPECT_EQ(h.count(), 10000u);
+    EXPECT_EQ(h.min(), 1u);
+    EXPECT_EQ(h.max(), 10000u);
+    EXPECT_NEAR(h.value_at_percentile(50), 5000, 5000 / 64);
+    EXPECT_NEAR(h.value_at_percentile(99), 9900, 9900 / 64);
+    EXPECT_EQ(h.value_at_percentile(100), 10000u);
+    EXPECT_DOUBLE_EQ(h.mean(), 5000.5);
+}
+
+TEST(test_hdr_histogram, merge_and_reset) {
+    hdr_histogram a, b;
+    a.record(10, 3);
+    b.record(1000000);
+    a.merge(b);
+    EXPECT_EQ(a.count(), 4u);
+    EXPECT_EQ(a.max(), 1000000u);
+    EXPECT_EQ(a.value_at_percentile(50), 10u);
+
+    a.reset();
+    EXPECT_EQ(a.count(), 0u);
+    EXPECT_EQ(a.value_at_percentile(99), 0u);
+}
\ No newline at end of file
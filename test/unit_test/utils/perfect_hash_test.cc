@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "perfect_hash.h"
+#include "http_tables.h"
+
+#include <string>
+
+using perfect_hash::str_view;
+
+namespace {
+
+str_view sv(const std::string& s) {
+    return str_view{s.data(), s.size()};
+}
+
+constexpr perfect_hash::entry<str_view, int> WORD_ENTRIES[] = {
+    { perfect_hash::view("a"), 1 },
+    { perfect_hash::view("ab"), 2 },
+    { perfect_hash::view("abc"), 3 },
+    { perfect_hash::view("b"), 4 },
+};
+
+/* 槽数等于键数时同样要求没有冲突 */
+constexpr auto WORDS = perfect_hash::make_table<4>(WORD_ENTRIES);
+static_assert(WORDS.valid(), "seed for a full table");
+
+}
+
+TEST(test_perfect_hash, find_every_key) {
+    for(const auto& e: WORD_ENTRIES) {
+        const auto* found = WORDS.find(e.key);
+        ASSERT_NE(found, nullptr);
+        EXPECT_EQ(found->value, e.value);
+    }
+    for(const auto& e: http_tables::MIME_ENTRIES) {
+        /* 键来自其它内存(如请求缓冲区)时按内容比较 */
+        std::string copy = e.key.to_string();
+        const auto* found = http_tables::MIME_TYPES.find(sv(copy));
+        ASSERT_NE(found, nullptr) << copy;
+        EXPECT_EQ(found->value.type.to_string(), e.value.type.to_string());
+    }
+    for(const auto& e: http_tables::STATUS_ENTRIES) {
+        ASSERT_NE(http_tables::STATUS_TEXT.find(e.key), nullptr);
+        EXPECT_EQ(http_tables::STATUS_TEXT.find(e.key)->value.reason.to_string(), e.value.reason.to_string());
+        /* 预格式化的状态行与状态码、原因短语一致 */
+        EXPECT_EQ(e.value.line.to_string(),
+                  "HTTP/1.1 " + std::to_string(e.key) + " " + e.value.reason.to_string() + "\r\n");
+    }
+    EXPECT_EQ(http_tables::ROUTES.find(sv("/"))->value.to_string(), "/index.html");
+    EXPECT_EQ(http_tables::ROUTES.find(sv("/login"))->value.to_string(), "/login.html");
+    EXPECT_EQ(http_tables::FORMS.find(sv("/register.html"))->value, 0);
+    EXPECT_EQ(http_tables::ERROR_PAGES.find(404)->value.to_string(), "/404.html");
+}
+
+TEST(test_perfect_hash, reject_other_keys) {
+    EXPECT_EQ(WORDS.find(sv("")), nullptr);
+    EXPECT_EQ(WORDS.find(sv("abcd")), nullptr);
+    EXPECT_EQ(WORDS.find(sv("c")), nullptr);
+    EXPECT_EQ(http_tables::MIME_TYPES.find(sv(".HTML")), nullptr);
+    EXPECT_EQ(http_tables::MIME_TYPES.find(sv(".htm")), nullptr);
+    EXPECT_EQ(http_tables::ROUTES.find(sv("/index.html")), nullptr);
+    EXPECT_EQ(http_tables::ROUTES.find(sv(std::string(1 << 20, '/'))), nullptr);
+    EXPECT_EQ(http_tables::STATUS_TEXT.find(500), nullptr);
+    EXPECT_EQ(http_tables::STATUS_TEXT.find(-200), nullptr);
+    EXPECT_EQ(http_tables::ERROR_PAGES.find(200), nullptr);
+}
\ No newline at end of file